@@ -26,7 +26,9 @@ public class CompositionUtils : ModuleRules
                 "Renderer",
                 "RHI",
                 "RHICore",
+                "Media",
                 "MediaAssets",
+                "MediaUtils",
                 "CinematicCamera"
             }
 			);
@@ -4,3 +4,8 @@ bool ICompUtilsCameraInterface::GetCameraIntrinsicData(FCompUtilsCameraIntrinsic
 {
 	return false;
 }
+
+bool ICompUtilsCameraInterface::GetCameraIntrinsicsHash(uint32& OutHash)
+{
+	return false;
+}
@@ -0,0 +1,225 @@
+#include "CompUtilsExtrinsicRefinement.h"
+
+#include "Async/ParallelFor.h"
+#include "RHIGPUReadback.h"
+
+
+FCompUtilsExtrinsicRefinementState::FCompUtilsExtrinsicRefinementState()
+	: PointReadback(MakeUnique<FRHIGPUBufferReadback>(TEXT("CompUtils.ExtrinsicRefinement.PointReadback")))
+{
+}
+
+FCompUtilsExtrinsicRefinementState::~FCompUtilsExtrinsicRefinementState() = default;
+
+
+namespace
+{
+	// Normal equations (J^T J) x = -J^T r for the 6 DOF update [rotation, translation]
+	struct FNormalEquations
+	{
+		double JtJ[6][6];
+		double Jtr[6];
+		double ErrorSum;
+		int32 NumInliers;
+
+		FNormalEquations()
+		{
+			FMemory::Memzero(*this);
+		}
+
+		void Accumulate(const FNormalEquations& Other)
+		{
+			for (int32 i = 0; i < 6; i++)
+			{
+				for (int32 j = 0; j < 6; j++)
+				{
+					JtJ[i][j] += Other.JtJ[i][j];
+				}
+				Jtr[i] += Other.Jtr[i];
+			}
+			ErrorSum += Other.ErrorSum;
+			NumInliers += Other.NumInliers;
+		}
+	};
+
+	// Solves the symmetric positive definite 6x6 system A x = b by Cholesky decomposition
+	bool SolveCholesky6(const double A[6][6], const double b[6], double x[6])
+	{
+		double L[6][6] = {};
+		for (int32 i = 0; i < 6; i++)
+		{
+			for (int32 j = 0; j <= i; j++)
+			{
+				double Sum = A[i][j];
+				for (int32 k = 0; k < j; k++)
+				{
+					Sum -= L[i][k] * L[j][k];
+				}
+
+				if (i == j)
+				{
+					if (Sum <= 0.0)
+					{
+						return false;
+					}
+					L[i][i] = FMath::Sqrt(Sum);
+				}
+				else
+				{
+					L[i][j] = Sum / L[j][j];
+				}
+			}
+		}
+
+		// Forward substitution L y = b
+		double y[6];
+		for (int32 i = 0; i < 6; i++)
+		{
+			double Sum = b[i];
+			for (int32 k = 0; k < i; k++)
+			{
+				Sum -= L[i][k] * y[k];
+			}
+			y[i] = Sum / L[i][i];
+		}
+
+		// Back substitution L^T x = y
+		for (int32 i = 5; i >= 0; i--)
+		{
+			double Sum = y[i];
+			for (int32 k = i + 1; k < 6; k++)
+			{
+				Sum -= L[k][i] * x[k];
+			}
+			x[i] = Sum / L[i][i];
+		}
+
+		return true;
+	}
+}
+
+
+FCompUtilsExtrinsicRefinementResult CompositionUtils::RefineTransformPointToPlane(
+	TConstArrayView<FVector3f> Points,
+	TConstArrayView<FPlane> TargetPlanes,
+	const FTransform& InitialTransform,
+	const FCompUtilsExtrinsicRefinementSettings& Settings)
+{
+	FCompUtilsExtrinsicRefinementResult Result;
+	Result.Transform = InitialTransform;
+	Result.NumPoints = Points.Num();
+
+	if (Points.Num() < 6 || TargetPlanes.IsEmpty())
+	{
+		return Result;
+	}
+
+	const double StartTime = FPlatformTime::Seconds();
+
+	constexpr int32 PointsPerChunk = 256;
+	const int32 NumChunks = FMath::DivideAndRoundUp(Points.Num(), PointsPerChunk);
+	TArray<FNormalEquations> ChunkEquations;
+	ChunkEquations.SetNum(NumChunks);
+
+	FTransform Current = InitialTransform;
+
+	for (int32 Iteration = 0; Iteration < Settings.MaxIterations; Iteration++)
+	{
+		ParallelFor(NumChunks, [&](int32 ChunkIndex)
+		{
+			FNormalEquations& Equations = ChunkEquations[ChunkIndex];
+			Equations = FNormalEquations();
+
+			const int32 Begin = ChunkIndex * PointsPerChunk;
+			const int32 End = FMath::Min(Begin + PointsPerChunk, Points.Num());
+			for (int32 PointIndex = Begin; PointIndex < End; PointIndex++)
+			{
+				const FVector Q = Current.TransformPosition(FVector(Points[PointIndex]));
+
+				// Correspondence is the closest reference plane
+				const FPlane* ClosestPlane = nullptr;
+				double Residual = TNumericLimits<double>::Max();
+				for (const FPlane& Plane : TargetPlanes)
+				{
+					const double Distance = Plane.PlaneDot(Q);
+					if (FMath::Abs(Distance) < FMath::Abs(Residual))
+					{
+						Residual = Distance;
+						ClosestPlane = &Plane;
+					}
+				}
+
+				if (!ClosestPlane || FMath::Abs(Residual) > Settings.MaxCorrespondenceDistance)
+				{
+					continue;
+				}
+
+				// Linearize about the current estimate: r' = r + (q x n) . w + n . v
+				const FVector Normal = ClosestPlane->GetNormal();
+				const FVector QCrossN = Q ^ Normal;
+				const double J[6] = { QCrossN.X, QCrossN.Y, QCrossN.Z, Normal.X, Normal.Y, Normal.Z };
+
+				for (int32 i = 0; i < 6; i++)
+				{
+					for (int32 j = 0; j < 6; j++)
+					{
+						Equations.JtJ[i][j] += J[i] * J[j];
+					}
+					Equations.Jtr[i] += J[i] * Residual;
+				}
+				Equations.ErrorSum += Residual * Residual;
+				Equations.NumInliers++;
+			}
+		});
+
+		FNormalEquations Total;
+		for (const FNormalEquations& Equations : ChunkEquations)
+		{
+			Total.Accumulate(Equations);
+		}
+
+		Result.NumIterations = Iteration + 1;
+		Result.NumInliers = Total.NumInliers;
+		Result.RMSError = Total.NumInliers > 0 ? FMath::Sqrt(Total.ErrorSum / Total.NumInliers) : 0.0;
+
+		if (Total.NumInliers < 6)
+		{
+			break;
+		}
+
+		double MinusJtr[6];
+		for (int32 i = 0; i < 6; i++)
+		{
+			Total.JtJ[i][i] += Settings.Damping * Total.NumInliers;
+			MinusJtr[i] = -Total.Jtr[i];
+		}
+
+		double Update[6];
+		if (!SolveCholesky6(Total.JtJ, MinusJtr, Update))
+		{
+			break;
+		}
+
+		// Apply the update on top of the current transform
+		const FVector Omega{ Update[0], Update[1], Update[2] };
+		const FVector Translation{ Update[3], Update[4], Update[5] };
+
+		const double Angle = Omega.Size();
+		const FQuat DeltaRotation = Angle > UE_SMALL_NUMBER ? FQuat(Omega / Angle, Angle) : FQuat::Identity;
+		Current = Current * FTransform(DeltaRotation, Translation);
+
+		Result.bSuccess = true;
+
+		if (Angle < Settings.ConvergenceThreshold && Translation.Size() < Settings.ConvergenceThreshold)
+		{
+			Result.bConverged = true;
+			break;
+		}
+	}
+
+	Result.Transform = Current;
+	Result.TotalTimeMs = (FPlatformTime::Seconds() - StartTime) * 1000.0;
+	Result.AvgIterationTimeMs = Result.NumIterations > 0 ? Result.TotalTimeMs / Result.NumIterations : 0.0;
+
+	return Result;
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+
+class FRHIGPUBufferReadback;
+
+
+struct FCompUtilsExtrinsicRefinementSettings
+{
+	int32 MaxIterations = 20;
+
+	// Iteration stops once the update to the transform is smaller than this (in cm / radians)
+	float ConvergenceThreshold = 1e-3f;
+
+	// Points further than this from every reference plane are treated as outliers (in cm)
+	float MaxCorrespondenceDistance = 10.0f;
+
+	// Damping applied to the normal equations
+	// Required as a single plane leaves 3 degrees of freedom unconstrained, which should remain untouched
+	float Damping = 1e-2f;
+};
+
+struct FCompUtilsExtrinsicRefinementResult
+{
+	bool bSuccess = false;
+	bool bConverged = false;
+
+	int32 NumIterations = 0;
+	int32 NumPoints = 0;
+	int32 NumInliers = 0;
+
+	double TotalTimeMs = 0.0;
+	double AvgIterationTimeMs = 0.0;
+
+	// Root-mean-square point-to-plane distance after refinement (in cm)
+	double RMSError = 0.0;
+
+	FTransform Transform = FTransform::Identity;
+};
+
+/**
+ * State shared between the game thread, render thread and the background solve for live extrinsic refinement
+ * Owned by a shared pointer so that in-flight work can never outlive the data it operates on
+ */
+struct FCompUtilsExtrinsicRefinementState
+{
+	FCompUtilsExtrinsicRefinementState();
+	~FCompUtilsExtrinsicRefinementState();
+
+	// Only access on render thread
+	TUniquePtr<FRHIGPUBufferReadback> PointReadback;
+	uint32 NumPointsRequested = 0;
+
+	// Snapshot of the request that is in flight
+	// Written on render thread when the readback is enqueued, read by the background solve
+	TArray<FPlane> ReferencePlanes;
+	FTransform InitialTransform = FTransform::Identity;
+	FCompUtilsExtrinsicRefinementSettings Settings;
+
+	// Game thread only
+	double LastRequestTime = 0.0;
+
+	// Set when a readback is requested, cleared once the solve for that readback has been published
+	FThreadSafeBool bBusy = false;
+	// Set on the render thread once the readback has been enqueued, so that it can be polled
+	FThreadSafeBool bReadbackPending = false;
+};
+
+
+namespace CompositionUtils
+{
+	/**
+	 * Refines a transform by point-to-plane ICP, such that Transform.TransformPosition(Point) lies on the closest of TargetPlanes.
+	 * Normal equations are accumulated in parallel across worker threads.
+	 */
+	FCompUtilsExtrinsicRefinementResult RefineTransformPointToPlane(
+		TConstArrayView<FVector3f> Points,
+		TConstArrayView<FPlane> TargetPlanes,
+		const FTransform& InitialTransform,
+		const FCompUtilsExtrinsicRefinementSettings& Settings
+	);
+}
@@ -0,0 +1,122 @@
+#include "CompUtilsSampleLatency.h"
+
+#include "HAL/IConsoleManager.h"
+#include "Misc/ScopeLock.h"
+#include "ProfilingDebugging/Histogram.h"
+
+#include "CompositionUtils.h"
+
+
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Injection Latency (ms)"), STAT_CompUtilsInjectionLatencyMs, STATGROUP_CompUtils);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Injection Latency (frames)"), STAT_CompUtilsInjectionLatencyFrames, STATGROUP_CompUtils);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Composite Latency (ms)"), STAT_CompUtilsCompositeLatencyMs, STATGROUP_CompUtils);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Composite Latency (frames)"), STAT_CompUtilsCompositeLatencyFrames, STATGROUP_CompUtils);
+
+
+// Latencies of a stage since the last reset
+struct FCompUtilsLatencyHistograms
+{
+	FCompUtilsLatencyHistograms()
+	{
+		Milliseconds.InitLinear(0.0, 250.0, 5.0);
+		Frames.InitLinear(0.0, 16.0, 1.0);
+	}
+
+	void Reset()
+	{
+		Milliseconds.Reset();
+		Frames.Reset();
+	}
+
+	FHistogram Milliseconds;
+	FHistogram Frames;
+};
+
+static FCriticalSection GCompUtilsLatencyCriticalSection;
+static FCompUtilsLatencyHistograms GCompUtilsLatencyHistograms[static_cast<int32>(ECompUtilsLatencyStage::Num)];
+
+
+static const TCHAR* GetLatencyStageName(ECompUtilsLatencyStage Stage)
+{
+	switch (Stage)
+	{
+	case ECompUtilsLatencyStage::Injection:			return TEXT("Injection");
+	case ECompUtilsLatencyStage::FinalComposite:	return TEXT("FinalComposite");
+	default:										return TEXT("Unknown");
+	}
+}
+
+
+void CompositionUtils::RecordSampleLatency_RenderThread(ECompUtilsLatencyStage Stage, const FCompUtilsSampleTime& SampleTime)
+{
+	check(IsInRenderingThread());
+
+	const double Milliseconds = FMath::Max(FPlatformTime::Seconds() - SampleTime.Seconds, 0.0) * 1000.0;
+	// The render thread works on the frame the game thread has handed over to it
+	const uint64 Frames = GFrameCounterRenderThread > SampleTime.Frame ? GFrameCounterRenderThread - SampleTime.Frame : 0;
+
+	{
+		FScopeLock Lock(&GCompUtilsLatencyCriticalSection);
+		FCompUtilsLatencyHistograms& Histograms = GCompUtilsLatencyHistograms[static_cast<int32>(Stage)];
+		Histograms.Milliseconds.AddMeasurement(Milliseconds);
+		Histograms.Frames.AddMeasurement(static_cast<double>(Frames));
+	}
+
+	switch (Stage)
+	{
+	case ECompUtilsLatencyStage::Injection:
+		SET_FLOAT_STAT(STAT_CompUtilsInjectionLatencyMs, Milliseconds);
+		SET_DWORD_STAT(STAT_CompUtilsInjectionLatencyFrames, Frames);
+		CSV_CUSTOM_STAT(CompUtils, InjectionLatencyMs, Milliseconds, ECsvCustomStatOp::Max);
+		CSV_CUSTOM_STAT(CompUtils, InjectionLatencyFrames, static_cast<int32>(Frames), ECsvCustomStatOp::Max);
+		break;
+	case ECompUtilsLatencyStage::FinalComposite:
+		SET_FLOAT_STAT(STAT_CompUtilsCompositeLatencyMs, Milliseconds);
+		SET_DWORD_STAT(STAT_CompUtilsCompositeLatencyFrames, Frames);
+		CSV_CUSTOM_STAT(CompUtils, CompositeLatencyMs, Milliseconds, ECsvCustomStatOp::Max);
+		CSV_CUSTOM_STAT(CompUtils, CompositeLatencyFrames, static_cast<int32>(Frames), ECsvCustomStatOp::Max);
+		break;
+	default:
+		break;
+	}
+}
+
+
+static FAutoConsoleCommand CCmdCompUtilsDumpSampleLatency(
+	TEXT("CompUtils.DumpSampleLatency"),
+	TEXT("Logs histograms of the latency from camera samples to their injection and to the final composite, in milliseconds and frames.\n")
+	TEXT("Media textures report the arrival of their samples, other camera textures must be tagged through CompositionUtils::SetTextureSampleTime.\n")
+	TEXT("Usage: CompUtils.DumpSampleLatency [Reset]"),
+	FConsoleCommandWithArgsDelegate::CreateStatic([](const TArray<FString>& Args)
+	{
+		const bool bReset = Args.Num() > 0 && Args[0].Equals(TEXT("Reset"), ESearchCase::IgnoreCase);
+
+		FScopeLock Lock(&GCompUtilsLatencyCriticalSection);
+		for (int32 i = 0; i < static_cast<int32>(ECompUtilsLatencyStage::Num); i++)
+		{
+			FCompUtilsLatencyHistograms& Histograms = GCompUtilsLatencyHistograms[i];
+			const TCHAR* StageName = GetLatencyStageName(static_cast<ECompUtilsLatencyStage>(i));
+
+			if (Histograms.Milliseconds.GetNumMeasurements() == 0)
+			{
+				UE_LOG(LogCompositionUtils, Log, TEXT("%s latency: no samples recorded"), StageName);
+				continue;
+			}
+
+			UE_LOG(LogCompositionUtils, Log, TEXT("%s latency over %d samples: %.2f ms average, %.2f ms min, %.2f ms max, %.2f frames average"),
+				StageName,
+				Histograms.Milliseconds.GetNumMeasurements(),
+				Histograms.Milliseconds.GetAverageOfAnalyzedMeasurements(),
+				Histograms.Milliseconds.GetMinOfAnalyzedMeasurements(),
+				Histograms.Milliseconds.GetMaxOfAnalyzedMeasurements(),
+				Histograms.Frames.GetAverageOfAnalyzedMeasurements());
+
+			Histograms.Milliseconds.DumpToLog(FString::Printf(TEXT("CompUtils %s latency (ms)"), StageName));
+			Histograms.Frames.DumpToLog(FString::Printf(TEXT("CompUtils %s latency (frames)"), StageName));
+
+			if (bReset)
+			{
+				Histograms.Reset();
+			}
+		}
+	}));
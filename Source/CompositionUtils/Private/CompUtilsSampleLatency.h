@@ -0,0 +1,24 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+#include "Composure/CompUtilsTextureRevisions.h"
+
+
+// Where camera samples are consumed, on their way from the camera to the screen
+enum class ECompUtilsLatencyStage : uint8
+{
+	// Camera textures injected into the GBuffer of a CompUtils capture
+	Injection,
+	// Output of the final pass of a composite
+	FinalComposite,
+
+	Num
+};
+
+namespace CompositionUtils
+{
+	// Records the milliseconds and frames passed between a camera sample and its consumption, see CompUtils.DumpSampleLatency
+	// Must be called on the render thread
+	void RecordSampleLatency_RenderThread(ECompUtilsLatencyStage Stage, const FCompUtilsSampleTime& SampleTime);
+}
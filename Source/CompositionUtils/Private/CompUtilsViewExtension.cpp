@@ -7,6 +7,7 @@
 #include "SceneRendering.h"
 #include "Components/SceneCaptureComponent2D.h"
 #include "Pipelines/CompUtilsPipelines.h"
+#include "CompUtilsSampleLatency.h"
 
 
 class FCameraFeedInjectionPS : public FGlobalShader
@@ -17,6 +18,11 @@ class FCameraFeedInjectionPS : public FGlobalShader
 	class FAlignColor : SHADER_PERMUTATION_BOOL("ALIGN_COLOR");
 	using FPermutationDomain = TShaderPermutationDomain<FAlignColor>;
 
+	static bool ShouldCompilePermutation(const FGlobalShaderPermutationParameters& Parameters)
+	{
+		return CompositionUtils::ShouldCompileShader(Parameters);
+	}
+
 	BEGIN_SHADER_PARAMETER_STRUCT(FParameters,)
 		SHADER_PARAMETER_STRUCT_REF(FViewUniformShaderParameters, View)
 
@@ -57,10 +63,67 @@ class FCameraFeedInjectionPS : public FGlobalShader
 IMPLEMENT_GLOBAL_SHADER(FCameraFeedInjectionPS, "/Plugin/CompositionUtils/CameraFeedInjection.usf", "InjectCameraFeedPS", SF_Pixel)
 
 
-FCompUtilsViewExtension::FCompUtilsViewExtension(ACompositionUtilsCaptureBase* Owner)
+FCompUtilsViewExtension::FCompUtilsViewExtension(ACompositionUtilsCaptureBase* Owner, TSharedPtr<FVolumetricFogRequiredDataBuffer, ESPMode::ThreadSafe> InVolumetricFogData)
 	: CaptureActor(Owner)
+	, VolumetricFogData(MoveTemp(InVolumetricFogData))
 {
-	check(Owner);
+	check(Owner && VolumetricFogData.IsValid());
+}
+
+
+void FCompUtilsViewExtension::BeginRenderViewFamily(FSceneViewFamily& InViewFamily)
+{
+	check(IsInGameThread());
+
+	ACompositionUtilsCaptureBase* Capture = CaptureActor.Get();
+	if (!Capture)
+		return;
+
+	// The slot was last published for a family NumRenderStateSlots frames ago, whose frame number the render thread no longer asks for
+	FRenderStateSlot& Slot = RenderStates[InViewFamily.FrameNumber % NumRenderStateSlots];
+
+	FCompUtilsCaptureRenderState& State = Slot.State;
+	State.bInjectionMode = Capture->bInjectionMode;
+	State.bExtractVolumetricFog = !Capture->bInjectionMode || Capture->bExtractVolumetricFogInInjectionMode;
+	State.bAlignColorAndNormals = Capture->bAlignColorAndNormals;
+
+	const FCameraTexturesProxy& CameraTextures = Capture->CameraTextures;
+	State.ColorTexture = CameraTextures.ColorTexture ? CameraTextures.ColorTexture->GetResource() : nullptr;
+	State.DepthTexture = CameraTextures.DepthTexture ? CameraTextures.DepthTexture->GetResource() : nullptr;
+	State.NormalsTexture = CameraTextures.NormalsTexture ? CameraTextures.NormalsTexture->GetResource() : nullptr;
+	State.SampleTime = CameraTextures.SampleTime;
+
+	FMinimalViewInfo CameraView;
+	Capture->SceneCaptureComponent2D->GetCameraView(0.0f, CameraView);
+
+	FTransform CameraTransform;
+	CameraTransform.SetRotation(CameraView.Rotation.Quaternion());
+	CameraTransform.SetTranslation(CameraView.Location);
+	// TODO: Because the matrix has no scale - should be okay to not use inverse of transpose of transformation?
+	State.VirtualCameraLocalToWorld = static_cast<FMatrix44f>(CameraTransform.ToMatrixNoScale());
+
+	State.AlbedoMultiplier = Capture->AlbedoMultiplier;
+	State.AmbientMultiplier = Capture->AmbientMultiplier;
+	State.RoughnessOverride = Capture->RoughnessOverride;
+	State.SpecularOverride = Capture->SpecularOverride;
+
+	// The family is rendered after this returns, so both of its callbacks find the state in the slot
+	Slot.FrameNumber.store(InViewFamily.FrameNumber, std::memory_order_release);
+}
+
+const FCompUtilsCaptureRenderState* FCompUtilsViewExtension::GetRenderState_RenderThread(const FSceneView& View) const
+{
+	check(IsInRenderingThread());
+
+	// Views of families that were not set up through BeginRenderViewFamily have no state of their own
+	if (!View.Family)
+		return nullptr;
+
+	const FRenderStateSlot& Slot = RenderStates[View.Family->FrameNumber % NumRenderStateSlots];
+	if (Slot.FrameNumber.load(std::memory_order_acquire) != View.Family->FrameNumber)
+		return nullptr;
+
+	return &Slot.State;
 }
 
 
@@ -71,69 +134,64 @@ void FCompUtilsViewExtension::PostRenderBasePassDeferred_RenderThread(
 	TRDGUniformBufferRef<FSceneTextureUniformParameters> SceneTextures
 )
 {
-	check(InView.bIsSceneCapture && InView.bIsViewInfo && CaptureActor.IsValid());
+	check(InView.bIsSceneCapture && InView.bIsViewInfo);
 
-	if (CaptureActor->bInjectionMode)
+	const FCompUtilsCaptureRenderState* State = GetRenderState_RenderThread(InView);
+	if (State && State->bInjectionMode)
 	{
-		InjectCameraFeed(GraphBuilder, InView);
+		InjectCameraFeed(GraphBuilder, InView, *State);
 	}
 }
 
 void FCompUtilsViewExtension::PostRenderView_RenderThread(FRDGBuilder& GraphBuilder, FSceneView& View)
 {
-	check(View.bIsSceneCapture && View.bIsViewInfo && CaptureActor.IsValid());
+	check(View.bIsSceneCapture && View.bIsViewInfo);
 
-	if (!CaptureActor->bInjectionMode || CaptureActor->bExtractVolumetricFogInInjectionMode)
+	const FCompUtilsCaptureRenderState* State = GetRenderState_RenderThread(View);
+	if (State && State->bExtractVolumetricFog)
 	{
 		ExtractVolumetricFog(GraphBuilder, View);
 	}
 }
 
 
-void FCompUtilsViewExtension::InjectCameraFeed(FRDGBuilder& GraphBuilder, FSceneView& View) const
+void FCompUtilsViewExtension::InjectCameraFeed(FRDGBuilder& GraphBuilder, FSceneView& View, const FCompUtilsCaptureRenderState& State) const
 {
-	check(View.bIsSceneCapture && View.bIsViewInfo && CaptureActor.IsValid());
+	check(View.bIsSceneCapture && View.bIsViewInfo);
 	FViewInfo& ViewInfo = static_cast<FViewInfo&>(View);
 
 	// Get camera images and insert them into GBuffer
 	// Some of these textures may be nullptr, must check for that later
-	const FCameraTexturesProxy& CameraTextures = CaptureActor->GetCameraTextures_RenderThread();
-
-	bool bAllValid = CameraTextures.ColorTexture != nullptr
-		&& CameraTextures.DepthTexture != nullptr
-		&& CameraTextures.NormalsTexture != nullptr;
+	bool bAllValid = State.ColorTexture != nullptr
+		&& State.DepthTexture != nullptr
+		&& State.NormalsTexture != nullptr;
 
 	if (!bAllValid)
 	{
 		return;
 	}
 
+	if (State.SampleTime.IsSet())
+	{
+		CompositionUtils::RecordSampleLatency_RenderThread(ECompUtilsLatencyStage::Injection, State.SampleTime.GetValue());
+	}
+
 	{
 		FCameraFeedInjectionPS::FParameters* PassParameters = GraphBuilder.AllocParameters<FCameraFeedInjectionPS::FParameters>();
 
 		PassParameters->View = View.ViewUniformBuffer;
 
-		PassParameters->CameraColorTexture = CameraTextures.ColorTexture->GetResource()->TextureRHI;
-		PassParameters->CameraDepthTexture = CameraTextures.DepthTexture->GetResource()->TextureRHI;
-		PassParameters->CameraNormalsTexture = CameraTextures.NormalsTexture->GetResource()->TextureRHI;
-
-		// Virtual camera local to world is required to transform injected normals from local to world space
-		{
-			FMinimalViewInfo CameraView;
-			CaptureActor->SceneCaptureComponent2D->GetCameraView(0.0f, CameraView);
+		PassParameters->CameraColorTexture = State.ColorTexture->TextureRHI;
+		PassParameters->CameraDepthTexture = State.DepthTexture->TextureRHI;
+		PassParameters->CameraNormalsTexture = State.NormalsTexture->TextureRHI;
 
-			FTransform CameraTransform;
-			CameraTransform.SetRotation(CameraView.Rotation.Quaternion());
-			CameraTransform.SetTranslation(CameraView.Location);
-			// TODO: Because the matrix has no scale - should be okay to not use inverse of transpose of transformation?
-			PassParameters->VirtualCameraLocalToWorld = static_cast<FMatrix44f>(CameraTransform.ToMatrixNoScale());
-		}
+		PassParameters->VirtualCameraLocalToWorld = State.VirtualCameraLocalToWorld;
 
-		PassParameters->AmbientMultiplier = CaptureActor->AmbientMultiplier;
-		PassParameters->AlbedoMultiplier = CaptureActor->AlbedoMultiplier;
+		PassParameters->AmbientMultiplier = State.AmbientMultiplier;
+		PassParameters->AlbedoMultiplier = State.AlbedoMultiplier;
 
-		PassParameters->RoughnessOverride = CaptureActor->RoughnessOverride;
-		PassParameters->SpecularOverride = CaptureActor->SpecularOverride;
+		PassParameters->RoughnessOverride = State.RoughnessOverride;
+		PassParameters->SpecularOverride = State.SpecularOverride;
 
 		// Get GBuffer
 		const FSceneTextures& SceneTexturesData = ViewInfo.GetSceneTextures();
@@ -154,7 +212,7 @@ void FCompUtilsViewExtension::InjectCameraFeed(FRDGBuilder& GraphBuilder, FScene
 		TShaderMapRef<FScreenPassVS> VertexShader(ShaderMap);
 
 		FCameraFeedInjectionPS::FPermutationDomain Permutation;
-		Permutation.Set<FCameraFeedInjectionPS::FAlignColor>(CaptureActor->bAlignColorAndNormals);
+		Permutation.Set<FCameraFeedInjectionPS::FAlignColor>(State.bAlignColorAndNormals);
 		TShaderMapRef<FCameraFeedInjectionPS> PixelShader(ShaderMap, Permutation);
 
 		FScreenPassTextureViewport ViewPort(ViewInfo.ViewRect.Size());
@@ -2,8 +2,32 @@
 
 #include "SceneViewExtension.h"
 
+#include <atomic>
 
-class ACompositionUtilsCaptureBase;
+#include "Composure/CompUtilsCaptureBase.h"
+
+
+// Everything the render thread needs from the capture actor, published once per rendered view family
+struct FCompUtilsCaptureRenderState
+{
+	bool bInjectionMode = false;
+	bool bExtractVolumetricFog = false;
+	bool bAlignColorAndNormals = false;
+
+	// Resources of the camera textures, looked up on the game thread so that the render thread never touches the UTextures
+	FTextureResource* ColorTexture = nullptr;
+	FTextureResource* DepthTexture = nullptr;
+	FTextureResource* NormalsTexture = nullptr;
+	TOptional<FCompUtilsSampleTime> SampleTime;
+
+	// Required to transform injected normals from local to world space
+	FMatrix44f VirtualCameraLocalToWorld = FMatrix44f::Identity;
+
+	float AlbedoMultiplier = 1.0f;
+	float AmbientMultiplier = 1.0f;
+	float RoughnessOverride = 1.0f;
+	float SpecularOverride = 0.0f;
+};
 
 
 // Inherits from ISceneViewExtension instead of FSceneViewExtensionBase because
@@ -12,13 +36,15 @@ class ACompositionUtilsCaptureBase;
 class FCompUtilsViewExtension : public ISceneViewExtension
 {
 public:
-	FCompUtilsViewExtension(ACompositionUtilsCaptureBase* Owner);
+	FCompUtilsViewExtension(ACompositionUtilsCaptureBase* Owner, TSharedPtr<FVolumetricFogRequiredDataBuffer, ESPMode::ThreadSafe> InVolumetricFogData);
 
 	//~ Begin ISceneViewExtension Interface
 
 	virtual void SetupViewFamily(FSceneViewFamily& InViewFamily) override {};
 	virtual void SetupView(FSceneViewFamily& InViewFamily, FSceneView& InView) override {};
-	virtual void BeginRenderViewFamily(FSceneViewFamily& InViewFamily) override {};
+
+	// Publishes the render state of the capture actor for this view family, on the game thread
+	virtual void BeginRenderViewFamily(FSceneViewFamily& InViewFamily) override;
 
 	// Camera feed injection is performed after base pass and before lighting pass
 	virtual void PostRenderBasePassDeferred_RenderThread(
@@ -33,13 +59,33 @@ public:
 	//~ End ISceneViewExtension Interface
 
 private:
+	// Render state of a view family in flight
+	struct FRenderStateSlot
+	{
+		// FSceneViewFamily::FrameNumber of the state, stored after the state so that a partially written one is never read
+		std::atomic<uint32> FrameNumber = MAX_uint32;
+		FCompUtilsCaptureRenderState State;
+	};
+
+	// The game thread runs at most a couple of frames ahead of the render thread,
+	// so a slot isn't written again while the family it was published for is still rendering
+	static constexpr uint32 NumRenderStateSlots = 4;
 
+	// Returns the render state published for the family of the view, or nullptr if there is none
+	const FCompUtilsCaptureRenderState* GetRenderState_RenderThread(const FSceneView& View) const;
 
-	void InjectCameraFeed(FRDGBuilder& GraphBuilder, FSceneView& View) const;
+	void InjectCameraFeed(FRDGBuilder& GraphBuilder, FSceneView& View, const FCompUtilsCaptureRenderState& State) const;
 	// Implemented in CompUtilsVolumetricFogExtraction.cpp
 	void ExtractVolumetricFog(FRDGBuilder& GraphBuilder, FSceneView& View) const;
 
 private:
-	// Should always be valid through the lifetime of this object or something has gone wrong
+	// Only accessed on the game thread, the render thread reads the published RenderStates instead
 	TWeakObjectPtr<ACompositionUtilsCaptureBase> CaptureActor;
+
+	// Written by the game thread and read by the render thread without locks or render commands, indexed by frame number
+	// The extension is kept alive by the view families it is rendered for, so the slots outlive any read
+	FRenderStateSlot RenderStates[NumRenderStateSlots];
+
+	// Shared with the capture actor and the volumetrics passes reading from it, so that it outlives the actor
+	TSharedPtr<FVolumetricFogRequiredDataBuffer, ESPMode::ThreadSafe> VolumetricFogData;
 };
@@ -91,9 +91,8 @@ FIntVector CompUtils_GetVolumetricFogResourceGridSize(const FViewInfo& View, int
 
 void FCompUtilsViewExtension::ExtractVolumetricFog(FRDGBuilder& GraphBuilder, FSceneView& View) const
 {
-	check(View.bIsSceneCapture && View.bIsViewInfo && CaptureActor.IsValid());
+	check(View.bIsSceneCapture && View.bIsViewInfo);
 
-	FVolumetricFogRequiredDataProxy* VolumetricFogData = CaptureActor.Get()->GetVolumetricFogData();
 	FViewInfo& ViewInfo = static_cast<FViewInfo&>(View);
 
 	const FScene* Scene = static_cast<const FScene*>(View.Family->Scene);
@@ -103,21 +102,29 @@ void FCompUtilsViewExtension::ExtractVolumetricFog(FRDGBuilder& GraphBuilder, FS
 	}
 	const FExponentialHeightFogSceneInfo& FogInfo = Scene->ExponentialFogs[0];
 
-	// Get fog info to pass along to composure
-	if (auto Tex = ViewInfo.VolumetricFogResources.IntegratedLightScatteringTexture)
+	// Fog is only published if there is a texture to compose it from, otherwise composition keeps using the previous fog
+	FRDGTextureRef IntegratedLightScatteringTexture = ViewInfo.VolumetricFogResources.IntegratedLightScatteringTexture;
+	if (!IntegratedLightScatteringTexture)
 	{
-		GraphBuilder.QueueTextureExtraction(Tex, &VolumetricFogData->IntegratedLightScatteringTexture);
+		return;
 	}
 
+	// Get fog info to pass along to composure
+	// Written into the slot that composition isn't reading from, see FVolumetricFogRequiredDataBuffer
+	FVolumetricFogRequiredDataProxy& FogData = VolumetricFogData->BeginExtraction();
+	GraphBuilder.QueueTextureExtraction(IntegratedLightScatteringTexture, &FogData.IntegratedLightScatteringTexture);
+
 	// Get the properties required to be able to evaluate the volumetric fog in a composure pass
 	int32 VolumetricFogGridPixelSize;
 	const FIntVector VolumetricFogResourceGridSize = CompUtils_GetVolumetricFogResourceGridSize(ViewInfo, VolumetricFogGridPixelSize);
 
-	VolumetricFogData->VolumetricFogStartDistance = ViewInfo.VolumetricFogStartDistance;
-	VolumetricFogData->VolumetricFogInvGridSize = FVector3f::OneVector / static_cast<FVector3f>(VolumetricFogResourceGridSize);
+	FogData.VolumetricFogStartDistance = ViewInfo.VolumetricFogStartDistance;
+	FogData.VolumetricFogInvGridSize = FVector3f::OneVector / static_cast<FVector3f>(VolumetricFogResourceGridSize);
 	FVector ZParams = CompUtils_GetVolumetricFogGridZParams(ViewInfo.VolumetricFogStartDistance, ViewInfo.NearClippingDistance, FogInfo.VolumetricFogDistance, VolumetricFogResourceGridSize.Z);
-	VolumetricFogData->VolumetricFogGridZParams = static_cast<FVector3f>(ZParams);
-	VolumetricFogData->VolumetricFogSVPosToVolumeUV = FVector2f::UnitVector / (FVector2f(VolumetricFogResourceGridSize.X, VolumetricFogResourceGridSize.Y) * VolumetricFogGridPixelSize);
-	VolumetricFogData->VolumetricFogUVMax = CompUtils_GetVolumetricFogUVMaxForSampling(ViewInfo.ViewRect.Size(), VolumetricFogResourceGridSize, VolumetricFogGridPixelSize);
-	VolumetricFogData->OneOverPreExposure = 1.0f / ViewInfo.PreExposure;
+	FogData.VolumetricFogGridZParams = static_cast<FVector3f>(ZParams);
+	FogData.VolumetricFogSVPosToVolumeUV = FVector2f::UnitVector / (FVector2f(VolumetricFogResourceGridSize.X, VolumetricFogResourceGridSize.Y) * VolumetricFogGridPixelSize);
+	FogData.VolumetricFogUVMax = CompUtils_GetVolumetricFogUVMaxForSampling(ViewInfo.ViewRect.Size(), VolumetricFogResourceGridSize, VolumetricFogGridPixelSize);
+	FogData.OneOverPreExposure = 1.0f / ViewInfo.PreExposure;
+
+	VolumetricFogData->PublishExtraction();
 }
@@ -6,6 +6,9 @@
 
 DEFINE_LOG_CATEGORY(LogCompositionUtils);
 
+CSV_DEFINE_CATEGORY_MODULE(COMPOSITIONUTILS_API, CompUtils, true);
+UE_TRACE_CHANNEL_DEFINE(CompUtilsChannel);
+
 
 void FCompositionUtilsModule::StartupModule()
 {
@@ -13,59 +13,81 @@ ACompositionUtilsCaptureBase::ACompositionUtilsCaptureBase()
 
 	if (!HasAnyFlags(RF_ClassDefaultObject))
 	{
-		CompUtilsViewExtension = MakeShared<FCompUtilsViewExtension>(this);
-		SceneCaptureComponent2D->SceneViewExtensions.Add(CompUtilsViewExtension);
+		VolumetricFogData = MakeShared<FVolumetricFogRequiredDataBuffer, ESPMode::ThreadSafe>();
 
-		VolumetricFogData_RenderThread = MakeShared<FVolumetricFogRequiredDataProxy>();
+		CompUtilsViewExtension = MakeShared<FCompUtilsViewExtension>(this, VolumetricFogData);
+		SceneCaptureComponent2D->SceneViewExtensions.Add(CompUtilsViewExtension);
 	}
 }
 
-const FVolumetricFogRequiredDataProxy* ACompositionUtilsCaptureBase::GetVolumetricFogData() const
-{
-	check(IsInRenderingThread());
-	return VolumetricFogData_RenderThread.Get();
-}
-
-FVolumetricFogRequiredDataProxy* ACompositionUtilsCaptureBase::GetVolumetricFogData()
+TSharedPtr<const FVolumetricFogRequiredDataBuffer, ESPMode::ThreadSafe> ACompositionUtilsCaptureBase::GetVolumetricFogData() const
 {
-	check(IsInRenderingThread());
-	return VolumetricFogData_RenderThread.Get();
+	return VolumetricFogData;
 }
 
 void ACompositionUtilsCaptureBase::FetchLatestCameraTextures_GameThread()
 {
 	check(!IsInRenderingThread());
 
-	FCameraTexturesProxy Textures;
 	// FindNamedRenderResult must be called on game thread to avoid race conditions
-	Textures.ColorTexture = FindNamedRenderResult(bUseOverrideColorPass ? OverrideCameraColorPassName : CameraColorPassName);
-	Textures.DepthTexture = FindNamedRenderResult(CameraDepthPassName);
-	Textures.NormalsTexture = FindNamedRenderResult(CameraNormalsPassName);
-
-	ENQUEUE_RENDER_COMMAND(UpdateCameraTextures)(
-	[this, TempTextures = MoveTemp(Textures)](FRHICommandListImmediate&)
+	// The textures reach the render thread along with the rest of the render state, see FCompUtilsViewExtension::BeginRenderViewFamily
+	CameraTextures.ColorTexture = FindNamedRenderResult(bUseOverrideColorPass ? OverrideCameraColorPassName : CameraColorPassName);
+	CameraTextures.DepthTexture = FindNamedRenderResult(CameraDepthPassName);
+	CameraTextures.NormalsTexture = FindNamedRenderResult(CameraNormalsPassName);
+
+	// Measures the latency from the camera to the injection of its samples
+	CameraTextures.SampleTime.Reset();
+	for (UTexture* Texture : { CameraTextures.ColorTexture, CameraTextures.DepthTexture, CameraTextures.NormalsTexture })
 	{
-		CameraTextures_RenderThread = TempTextures;
-	});
+		FCompUtilsSampleTime SampleTime;
+		if (!CompositionUtils::GetTextureSampleTime(Texture, SampleTime))
+		{
+			CameraTextures.SampleTime.Reset();
+			break;
+		}
+
+		if (!CameraTextures.SampleTime.IsSet() || SampleTime.Seconds < CameraTextures.SampleTime->Seconds)
+		{
+			CameraTextures.SampleTime = SampleTime;
+		}
+	}
 }
 
-const FCameraTexturesProxy& ACompositionUtilsCaptureBase::GetCameraTextures_RenderThread() const
+bool ACompositionUtilsCaptureBase::GetTargetCameraView(FTargetCameraView& OutView)
 {
-	check(IsInRenderingThread());
-	return CameraTextures_RenderThread;
-}
+	check(IsInGameThread());
 
-bool ACompositionUtilsCaptureBase::GetCameraIntrinsicData(FCompUtilsCameraIntrinsicData& OutData)
-{
 	ACameraActor* CameraActor = FindTargetCamera();
 	if (!CameraActor)
 	{
 		return false;
 	}
 
-	FMinimalViewInfo VirtualCameraView;
 	UCameraComponent* CameraComponent = CameraActor->GetCameraComponent();
-	CameraComponent->GetCameraView(0.0f, VirtualCameraView);
+	CameraComponent->GetCameraView(0.0f, OutView.View);
+	OutView.CameraComponent = CameraComponent;
+
+	if (UCineCameraComponent* CineCameraComponent = Cast<UCineCameraComponent>(CameraComponent))
+	{
+		OutView.bIsCineCamera = true;
+		OutView.SensorWidth = CineCameraComponent->Filmback.SensorWidth;
+		OutView.SensorHeight = CineCameraComponent->Filmback.SensorHeight;
+		OutView.FocalLength = CineCameraComponent->CurrentFocalLength;
+		OutView.Aperture = CineCameraComponent->CurrentAperture;
+		OutView.FocusDistance = CineCameraComponent->CurrentFocusDistance;
+	}
+
+	return true;
+}
+
+bool ACompositionUtilsCaptureBase::GetCameraIntrinsicData(FCompUtilsCameraIntrinsicData& OutData)
+{
+	FTargetCameraView CameraView;
+	if (!GetTargetCameraView(CameraView))
+	{
+		return false;
+	}
+	const FMinimalViewInfo& VirtualCameraView = CameraView.View;
 
 	FMatrix ProjectionMatrix = VirtualCameraView.CalculateProjectionMatrix();
 
@@ -79,7 +101,7 @@ bool ACompositionUtilsCaptureBase::GetCameraIntrinsicData(FCompUtilsCameraIntrin
 	OutData.VerticalFOV =
 		2.0f * FMath::Atan(FMath::Tan(0.5f * OutData.HorizontalFOV) / VirtualCameraView.AspectRatio);
 
-	if (UCineCameraComponent* CineCameraComponent = Cast<UCineCameraComponent>(CameraComponent))
+	if (CameraView.bIsCineCamera)
 	{
 		// TODO: Populate camera intrinsics
 	}
@@ -90,3 +112,35 @@ bool ACompositionUtilsCaptureBase::GetCameraIntrinsicData(FCompUtilsCameraIntrin
 
 	return true;
 }
+
+bool ACompositionUtilsCaptureBase::GetCameraIntrinsicsHash(uint32& OutHash)
+{
+	FTargetCameraView CameraView;
+	if (!GetTargetCameraView(CameraView))
+	{
+		return false;
+	}
+	const FMinimalViewInfo& VirtualCameraView = CameraView.View;
+
+	// Everything that the projection matrix and FOVs are calculated from
+	OutHash = GetTypeHash(CameraView.CameraComponent);
+	OutHash = HashCombine(OutHash, GetTypeHash(VirtualCameraView.FOV));
+	OutHash = HashCombine(OutHash, GetTypeHash(VirtualCameraView.AspectRatio));
+	OutHash = HashCombine(OutHash, GetTypeHash(VirtualCameraView.ProjectionMode));
+	OutHash = HashCombine(OutHash, GetTypeHash(VirtualCameraView.OrthoWidth));
+	OutHash = HashCombine(OutHash, GetTypeHash(VirtualCameraView.OrthoNearClipPlane));
+	OutHash = HashCombine(OutHash, GetTypeHash(VirtualCameraView.OrthoFarClipPlane));
+	OutHash = HashCombine(OutHash, GetTypeHash(VirtualCameraView.GetFinalPerspectiveNearClipPlane()));
+	OutHash = HashCombine(OutHash, GetTypeHash(VirtualCameraView.OffCenterProjectionOffset));
+
+	if (CameraView.bIsCineCamera)
+	{
+		OutHash = HashCombine(OutHash, GetTypeHash(CameraView.SensorWidth));
+		OutHash = HashCombine(OutHash, GetTypeHash(CameraView.SensorHeight));
+		OutHash = HashCombine(OutHash, GetTypeHash(CameraView.FocalLength));
+		OutHash = HashCombine(OutHash, GetTypeHash(CameraView.Aperture));
+		OutHash = HashCombine(OutHash, GetTypeHash(CameraView.FocusDistance));
+	}
+
+	return true;
+}
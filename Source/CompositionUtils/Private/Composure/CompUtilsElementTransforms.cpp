@@ -4,13 +4,19 @@
 #include "RHIGPUReadback.h"
 #include "TextureResource.h"
 
+#include "Async/Async.h"
+#include "Camera/CameraActor.h"
+#include "Camera/CameraComponent.h"
 #include "Components/DirectionalLightComponent.h"
+#include "Engine/AssetManager.h"
+#include "UObject/WeakInterfacePtr.h"
 
 #include "CompositingElements/ICompositingTextureLookupTable.h"
 #include "Composure/CompUtilsCaptureBase.h"
 
 #include "CompositionUtils.h"
 #include "CompUtilsCameraInterface.h"
+#include "CompUtilsExtrinsicRefinement.h"
 
 #include "Pipelines/CompUtilsPipelines.h"
 
@@ -40,37 +46,116 @@ ICompUtilsCameraInterface* FindCameraInterfaceFromInputElement(ACompositingEleme
 	return nullptr;
 }
 
-//////////////////////////////////////////
-// UCompositionUtilsDepthProcessingPass //
-//////////////////////////////////////////
+// Intrinsics of the camera that a compositing element represents, shared by all passes referencing the element
+struct FCachedCameraIntrinsics
+{
+	TWeakInterfacePtr<ICompUtilsCameraInterface> Interface;
+	uint64 LastResolveFrame = MAX_uint64;
+	uint64 LastUpdateFrame = MAX_uint64;
+
+	bool bValid = false;
+	bool bHasHash = false;
+	uint32 Hash = 0;
+	FCompUtilsCameraIntrinsicData Data;
+};
+
+static TMap<TObjectKey<ACompositingElement>, FCachedCameraIntrinsics> GCachedCameraIntrinsics;
+static uint64 GCachedCameraIntrinsicsPruneFrame = 0;
+
+// Finds the camera of the element again once per frame, as its inputs may have been rewired to another camera since
+// Must be called on the game thread
+static ICompUtilsCameraInterface* ResolveCachedCameraInterface(ACompositingElement* CompositingElement, FCachedCameraIntrinsics& Cached)
+{
+	if (Cached.LastResolveFrame != GFrameCounter)
+	{
+		Cached.LastResolveFrame = GFrameCounter;
+
+		ICompUtilsCameraInterface* Interface = FindCameraInterfaceFromInputElement(CompositingElement);
+		if (Interface != Cached.Interface.Get())
+		{
+			// Intrinsics of another camera must not be handed on, even if its hash happens to match
+			Cached.Interface = Interface;
+			Cached.bValid = false;
+			Cached.bHasHash = false;
+		}
+	}
+
+	return Cached.Interface.Get();
+}
 
-UTexture* UCompositionUtilsDepthProcessingPass::ApplyTransform_Implementation(UTexture* Input, UComposurePostProcessingPassProxy* PostProcessProxy, ACameraActor* TargetCamera)
+// Fetches the intrinsics again if the camera properties they depend on have changed
+static void UpdateCachedCameraIntrinsics(FCachedCameraIntrinsics& Cached, ICompUtilsCameraInterface* Interface)
 {
-	if (!Input)
-		return Input;
-	check(Input->GetResource());
+	uint32 Hash = 0;
+	const bool bHasHash = Interface->GetCameraIntrinsicsHash(Hash);
 
-	FIntPoint Dims;
-	Dims.X = Input->GetResource()->GetSizeX();
-	Dims.Y = Input->GetResource()->GetSizeY();
+	if (!Cached.bValid || !bHasHash || !Cached.bHasHash || Hash != Cached.Hash)
+	{
+		Cached.bValid = Interface->GetCameraIntrinsicData(Cached.Data);
+	}
 
-	UTextureRenderTarget2D* RenderTarget = RequestRenderTarget(Dims, PF_FloatRGBA);
-	if (!(RenderTarget && RenderTarget->GetResource()))
-		return Input;
+	Cached.bHasHash = bHasHash;
+	Cached.Hash = Hash;
+	Cached.LastUpdateFrame = GFrameCounter;
+}
 
-	FDepthProcessingParametersProxy Params;
+// Looks up the intrinsics of the camera that the compositing element represents, see FindCameraInterfaceFromInputElement
+// Intrinsics are checked for changes at most once per frame, and only fetched again when the camera properties they depend on change
+bool GetCameraIntrinsicsFromInputElement(ACompositingElement* CompositingElement, FCompUtilsCameraIntrinsicData& OutData)
+{
+	check(IsInGameThread());
 
-	if (SourceCamera.IsValid())
+	if (GCachedCameraIntrinsicsPruneFrame != GFrameCounter)
 	{
-		if (auto Interface = FindCameraInterfaceFromInputElement(SourceCamera.Get()))
+		// Drop elements that have been destroyed
+		for (auto It = GCachedCameraIntrinsics.CreateIterator(); It; ++It)
+		{
+			if (!It.Key().ResolveObjectPtr())
+			{
+				It.RemoveCurrent();
+			}
+		}
+		GCachedCameraIntrinsicsPruneFrame = GFrameCounter;
+	}
+
+	FCachedCameraIntrinsics& Cached = GCachedCameraIntrinsics.FindOrAdd(CompositingElement);
+
+	if (Cached.LastUpdateFrame != GFrameCounter)
+	{
+		if (ICompUtilsCameraInterface* Interface = ResolveCachedCameraInterface(CompositingElement, Cached))
+		{
+			UpdateCachedCameraIntrinsics(Cached, Interface);
+		}
+		else
 		{
-			Interface->GetCameraIntrinsicData(Params.SourceCamera);
+			Cached.bValid = false;
+			Cached.LastUpdateFrame = GFrameCounter;
 		}
 	}
+
+	if (!Cached.bValid)
+		return false;
+
+	OutData = Cached.Data;
+	return true;
+}
+
+//////////////////////////////////////////
+// UCompositionUtilsDepthProcessingPass //
+//////////////////////////////////////////
+
+bool UCompositionUtilsDepthProcessingPass::PrepareRenderPass(FIntPoint InputSize, ACameraActor* TargetCamera, FCompUtilsPreparedPass& OutPass)
+{
+	FDepthProcessingParametersProxy Params;
+
+	if (SourceCamera.IsValid())
+	{
+		GetCameraIntrinsicsFromInputElement(SourceCamera.Get(), Params.SourceCamera);
+	}
 	else
 	{
 		UE_LOG(LogCompositionUtils, Warning, TEXT("DepthProcessingPass: SourceCamera is missing or doesn't implement CompUtils CameraInterface!"));
-		return Input;
+		return false;
 	}
 
 	Params.bEnableJacobiSteps = bEnableJacobi;
@@ -90,31 +175,29 @@ UTexture* UCompositionUtilsDepthProcessingPass::ApplyTransform_Implementation(UT
 		static_cast<float>(ClippingPlane.W)
 	};
 
-	ENQUEUE_RENDER_COMMAND(ApplyDepthProcessingPass)(
-		[Parameters = MoveTemp(Params), InputResource = Input->GetResource(), OutputResource = RenderTarget->GetResource()]
-		(FRHICommandListImmediate& RHICmdList)
-		{
-			FRDGBuilder GraphBuilder(RHICmdList);
-
-			TRefCountPtr<IPooledRenderTarget> InputRT = CreateRenderTarget(InputResource->GetTextureRHI(), TEXT("CompUtilsDepthProcessingPass.Input"));
-			TRefCountPtr<IPooledRenderTarget> OutputRT = CreateRenderTarget(OutputResource->GetTextureRHI(), TEXT("CompUtilsDepthProcessingPass.Output"));
-
-			// Set up RDG resources
-			FRDGTextureRef InColorTexture = GraphBuilder.RegisterExternalTexture(InputRT);
-			FRDGTextureRef OutColorTexture = GraphBuilder.RegisterExternalTexture(OutputRT);
-
-			// Execute pipeline
-			CompositionUtils::ExecuteDepthProcessingPipeline(
-				GraphBuilder,
-				Parameters,
-				InColorTexture,
-				OutColorTexture
-			);
-
-			GraphBuilder.Execute();
-		});
+	FCompUtilsPassStateHash Hash;
+	Hash.AddCamera(Params.SourceCamera);
+	Hash.Add(Params.bEnableJacobiSteps);
+	Hash.Add(Params.NumJacobiSteps);
+	Hash.Add(Params.bEnableFarClipping);
+	Hash.Add(Params.FarClipDistance);
+	Hash.Add(Params.bEnableClippingPlane);
+	Hash.Add(Params.UserClippingPlane);
+	Hash.Finish(OutPass);
+
+	OutPass.Name = TEXT("DepthProcessingPass");
+	OutPass.OutputSize = InputSize;
+	OutPass.Record = [Parameters = MoveTemp(Params)](FRDGBuilder& GraphBuilder, FRDGTextureRef InTexture, FRDGTextureRef OutTexture)
+	{
+		CompositionUtils::ExecuteDepthProcessingPipeline(
+			GraphBuilder,
+			Parameters,
+			InTexture,
+			OutTexture
+		);
+	};
 
-	return RenderTarget;
+	return true;
 }
 
 
@@ -123,16 +206,12 @@ UTexture* UCompositionUtilsDepthProcessingPass::ApplyTransform_Implementation(UT
 /////////////////////////////////////////
 
 
-UTexture* UCompositionUtilsDepthAlignmentPass::ApplyTransform_Implementation(UTexture* Input, UComposurePostProcessingPassProxy* PostProcessProxy, ACameraActor*)
+bool UCompositionUtilsDepthAlignmentPass::PrepareRenderPass(FIntPoint InputSize, ACameraActor*, FCompUtilsPreparedPass& OutPass)
 {
-	if (!Input)
-		return Input;
-	check(Input->GetResource());
-
 	if (!(SourceCamera.IsValid() && DestinationCamera.IsValid()))
 	{
 		UE_LOG(LogCompositionUtils, Warning, TEXT("DepthAlignmentPass: One of SourceCamera or DestinationCamera has not been assigned."));
-		return Input;
+		return false;
 	}
 
 	// Collect parameters
@@ -141,228 +220,375 @@ UTexture* UCompositionUtilsDepthAlignmentPass::ApplyTransform_Implementation(UTe
 
 	if (SourceCamera.IsValid())
 	{
-		if (auto Interface = FindCameraInterfaceFromInputElement(SourceCamera.Get()))
-		{
-			Interface->GetCameraIntrinsicData(ParametersProxy.SourceCamera);
-		}
+		GetCameraIntrinsicsFromInputElement(SourceCamera.Get(), ParametersProxy.SourceCamera);
 	}
 	else
 	{
 		UE_LOG(LogCompositionUtils, Warning, TEXT("DepthAlignmentPass: SourceCamera is missing or doesn't implement CompUtils CameraInterface!"));
-		return Input;
+		return false;
 	}
 
 	if (DestinationCamera.IsValid())
 	{
-		if (auto Interface = FindCameraInterfaceFromInputElement(DestinationCamera.Get()))
-		{
-			Interface->GetCameraIntrinsicData(ParametersProxy.DestinationCamera);
-		}
+		GetCameraIntrinsicsFromInputElement(DestinationCamera.Get(), ParametersProxy.DestinationCamera);
 	}
 	else
 	{
 		UE_LOG(LogCompositionUtils, Warning, TEXT("DepthAlignmentPass: DestinationCamera is missing or doesn't implement CompUtils CameraInterface!"));
-		return Input;
+		return false;
 	}
 
-	// Update nodal offset transform
-	if (!CalibrationData.IsNull() && CalibrationData.LoadSynchronous())
+	// The calibration may have been reassigned without an edit notification, e.g. from Blueprint
+	if (CalibrationData.ToSoftObjectPath() != RequestedCalibrationPath)
 	{
-		ParametersProxy.SourceToDestinationNodalOffset = static_cast<FMatrix44f>(CalibrationData->ExtrinsicTransform.ToMatrixNoScale());
+		RequestCalibrationData();
 	}
-	else
+
+	// Update nodal offset transform
+	// A live refinement takes precedence over the calibrated offset
+	FTransform NodalOffset = CalibratedTransform;
+	ParametersProxy.SourceToDestinationNodalOffset = CalibratedNodalOffset;
+	if (bEnableLiveRefinement && bHasRefinedTransform)
 	{
-		ParametersProxy.SourceToDestinationNodalOffset = FMatrix44f::Identity;
+		NodalOffset = RefinedTransform;
+		ParametersProxy.SourceToDestinationNodalOffset = RefinedNodalOffset;
 	}
 
 	ParametersProxy.HoleFillingBias = static_cast<uint32>(HoleFillingBias);
 
-	FIntPoint Dims;
-	Dims.X = Input->GetResource()->GetSizeX();
-	Dims.Y = Input->GetResource()->GetSizeY();
+	// Decide if a new point cloud should be read back for live refinement
+	// Only one refinement is ever in flight, so a slow solve cannot cause work to queue up
+	FDepthCalibrationParametersProxy RefinementParameters;
+	FCompUtilsExtrinsicRefinementSettings RefinementSettings;
+	TArray<FPlane> ReferencePlanes;
+	bool bRequestRefinement = false;
 
-	UTextureRenderTarget2D* RenderTarget = RequestRenderTarget(Dims, PF_FloatRGBA);
-	if (!(RenderTarget && RenderTarget->GetResource()))
-		return Input;
+	if (bEnableLiveRefinement)
+	{
+		if (!RefinementState.IsValid())
+		{
+			RefinementState = MakeShared<FCompUtilsExtrinsicRefinementState, ESPMode::ThreadSafe>();
+		}
 
-	ENQUEUE_RENDER_COMMAND(ApplyDepthAlignmentPass)(
-		[this, Parameters = ParametersProxy, InputResource = Input->GetResource(), OutputResource = RenderTarget->GetResource()]
-		(FRHICommandListImmediate& RHICmdList)
+		const double CurrentTime = FPlatformTime::Seconds();
+		if (!RefinementState->bBusy
+			&& CurrentTime - RefinementState->LastRequestTime >= RefinementInterval
+			&& GetReferencePlanesInDestinationView(ReferencePlanes))
 		{
-			FRDGBuilder GraphBuilder(RHICmdList);
-			FRHIGPUBufferReadback CalibrationPointReadback("CalibrationPointReadback");
+			RefinementState->bBusy = true;
+			RefinementState->LastRequestTime = CurrentTime;
+			bRequestRefinement = true;
 
-			TRefCountPtr<IPooledRenderTarget> InputRT = CreateRenderTarget(InputResource->GetTextureRHI(), TEXT("CompUtilsDepthAlignmentPass.Input"));
-			TRefCountPtr<IPooledRenderTarget> OutputRT = CreateRenderTarget(OutputResource->GetTextureRHI(), TEXT("CompUtilsDepthAlignmentPass.Output"));
+			RefinementParameters.SourceCamera = ParametersProxy.SourceCamera;
+			RefinementParameters.CalibrationPointCount = static_cast<uint32>(RefinementPointCount);
 
-			// Set up RDG resources
-			FRDGTextureRef InColorTexture = GraphBuilder.RegisterExternalTexture(InputRT);
-			FRDGTextureRef OutColorTexture = GraphBuilder.RegisterExternalTexture(OutputRT);
+			RefinementSettings.MaxIterations = RefinementMaxIterations;
+			RefinementSettings.MaxCorrespondenceDistance = RefinementMaxCorrespondenceDistance;
+		}
+	}
+
+	// A live refinement may change the nodal offset at any time, so the pass is only skipped while it is disabled
+	if (!bEnableLiveRefinement)
+	{
+		FCompUtilsPassStateHash Hash;
+		Hash.AddCamera(ParametersProxy.SourceCamera);
+		Hash.AddCamera(ParametersProxy.DestinationCamera);
+		Hash.Add(ParametersProxy.SourceToDestinationNodalOffset);
+		Hash.Add(ParametersProxy.HoleFillingBias);
+		Hash.Finish(OutPass);
+	}
+
+	OutPass.Name = TEXT("DepthAlignmentPass");
+	OutPass.OutputSize = InputSize;
+	OutPass.Record =
+		[Parameters = ParametersProxy, State = RefinementState, bRequestRefinement, RefinementParameters, RefinementSettings,
+		 ReferencePlanes = MoveTemp(ReferencePlanes), NodalOffset, WeakThis = TWeakObjectPtr<UCompositionUtilsDepthAlignmentPass>(this)]
+		(FRDGBuilder& GraphBuilder, FRDGTextureRef InTexture, FRDGTextureRef OutTexture) mutable
+		{
+			// Graphs that recorded this pass on previous frames have executed by now
+			// If the readback requested by one of them has arrived, copy it out and hand it to a background task,
+			// so that neither the render or game thread wait on the solve
+			if (State.IsValid() && State->bReadbackPending && State->PointReadback->IsReady())
+			{
+				State->bReadbackPending = false;
+
+				TArray<FVector3f> Points;
+				{
+					const uint32 NumPoints = State->NumPointsRequested;
+					const FVector3f* ReadbackPoints = static_cast<const FVector3f*>(State->PointReadback->Lock(NumPoints * sizeof(FVector3f)));
+
+					Points.Reserve(NumPoints);
+					for (uint32 i = 0; i < NumPoints; i++)
+					{
+						// Invalid depth is written as the origin
+						if (!ReadbackPoints[i].IsNearlyZero() && !ReadbackPoints[i].ContainsNaN())
+						{
+							Points.Add(ReadbackPoints[i]);
+						}
+					}
+
+					State->PointReadback->Unlock();
+				}
+
+				Async(EAsyncExecution::ThreadPool,
+				[State, Points = MoveTemp(Points), WeakThis]
+				{
+					FCompUtilsExtrinsicRefinementResult Result = CompositionUtils::RefineTransformPointToPlane(
+						Points,
+						State->ReferencePlanes,
+						State->InitialTransform,
+						State->Settings);
+
+					// Send result to game thread
+					Async(EAsyncExecution::TaskGraphMainTick, [State, Result, WeakThis]
+					{
+						if (UCompositionUtilsDepthAlignmentPass* This = WeakThis.Get())
+						{
+							This->PublishRefinement_GameThread(Result);
+						}
+						State->bBusy = false;
+					});
+				});
+			}
 
 			// Execute pipeline
 			CompositionUtils::ExecuteDepthAlignmentPipeline(
 				GraphBuilder,
 				Parameters,
-				InColorTexture,
-				OutColorTexture);
-			
-			GraphBuilder.Execute();
+				InTexture,
+				OutTexture);
 
-			/*
-			if (bRunCalibration)
+			if (bRequestRefinement)
 			{
-				TFuture<void> Task = Async(EAsyncExecution::TaskGraph, [this, CalibrationPointReadbackTemp = std::move(CalibrationPointReadback)]
-					{
-						FRHIGPUBufferReadback& BufferReadback = *const_cast<FRHIGPUBufferReadback*>(&CalibrationPointReadbackTemp);
-
-						while (!BufferReadback.IsReady()) {}
-
-						ENQUEUE_RENDER_COMMAND(DepthAlignmentCalibrationReadback)(
-							[this, BufferReadbackTemp = std::move(BufferReadback)]
-							(FRHICommandListImmediate&)
-							{
-								FRHIGPUBufferReadback& BufferReadback = *const_cast<FRHIGPUBufferReadback*>(&BufferReadbackTemp);
-								CalibrateAlignment_RenderThread(BufferReadback);
-							});
-					});
+				// Sample a point cloud from the processed depth (the input to this pass) and read it back
+				CompositionUtils::ExecuteDepthAlignmentCalibrationPipeline(
+					GraphBuilder,
+					RefinementParameters,
+					InTexture,
+					OutTexture,
+					*State->PointReadback);
+
+				State->NumPointsRequested = RefinementParameters.CalibrationPointCount;
+				State->ReferencePlanes = MoveTemp(ReferencePlanes);
+				State->InitialTransform = NodalOffset;
+				State->Settings = RefinementSettings;
+				State->bReadbackPending = true;
 			}
-			*/
-		});
+		};
 
-	return RenderTarget;
+	return true;
 }
 
-/*
-void UCompositionUtilsDepthAlignmentPass::CalibrateAlignment_RenderThread(FRHIGPUBufferReadback& Readback)
+void UCompositionUtilsDepthAlignmentPass::ResetLiveRefinement()
 {
-	// Read back calibration points and perform calibration
-	check(IsInRenderingThread());
-	check(Readback.IsReady());
+	bHasRefinedTransform = false;
+	RefinedTransform = FTransform::Identity;
+	RefinedNodalOffset = FMatrix44f::Identity;
+	RefinementReport = FCompUtilsExtrinsicRefinementReport();
+}
+
+bool UCompositionUtilsDepthAlignmentPass::GetReferencePlanesInDestinationView(TArray<FPlane>& OutPlanes) const
+{
+	if (RefinementReferencePlanes.IsEmpty() || !DestinationCamera.IsValid())
+		return false;
 
-	TArray<FVector3f> Points;
-	Points.SetNum(CalibrationPointCount);
+	ACameraActor* DestinationCameraActor = DestinationCamera->FindTargetCamera();
+	if (!DestinationCameraActor || !DestinationCameraActor->GetCameraComponent())
+		return false;
 
-	// Read bytes
+	FMinimalViewInfo CameraView;
+	DestinationCameraActor->GetCameraComponent()->GetCameraView(0.0f, CameraView);
+
+	// Matches the view space that the alignment shaders operate in: X right, Y up, Z forward
+	const FMatrix WorldToView = FTranslationMatrix(-CameraView.Location)
+		* FInverseRotationMatrix(CameraView.Rotation)
+		* FMatrix(
+			FPlane(0, 0, 1, 0),
+			FPlane(1, 0, 0, 0),
+			FPlane(0, 1, 0, 0),
+			FPlane(0, 0, 0, 1));
+
+	FMatrix ReferenceToView = WorldToView;
+	if (RefinementReferenceActor.IsValid())
 	{
-		uint64 NumBytes = sizeof(FVector3f) * CalibrationPointCount;
-		uint8* Bytes = static_cast<uint8*>(Readback.Lock(NumBytes));
-		FMemory::Memcpy(Points.GetData(), Bytes, NumBytes);
-		Readback.Unlock();
+		ReferenceToView = RefinementReferenceActor->GetActorTransform().ToMatrixWithScale() * WorldToView;
 	}
 
-	// Calculate plane of best fit
-	TOptional<FPlane4f> Plane = CompositionUtils::CalculatePlaneOfBestFit(Points);
-	if (!Plane || !Plane->IsValid())
-		return;
+	OutPlanes.Reset(RefinementReferencePlanes.Num());
+	for (const FPlane& Plane : RefinementReferencePlanes)
+	{
+		OutPlanes.Add(Plane.TransformBy(ReferenceToView));
+	}
 
-	// We are using the convention that the camera is looking along +Z
-	// Therefore, a normal vector seen by the camera should be pointing somewhat towards it; so Z should always be less than 0
-	if (Plane->GetNormal().Z > 0.0f)
-		Plane = Plane->Flip();
+	return true;
+}
 
-	// Deduce transform
-	FVector3f AlignmentTranslation;
-	FQuat4f AlignmentRotation;
+void UCompositionUtilsDepthAlignmentPass::PublishRefinement_GameThread(const FCompUtilsExtrinsicRefinementResult& Result)
+{
+	check(IsInGameThread());
+
+	RefinementReport.NumRefinements++;
+	RefinementReport.bConverged = Result.bConverged;
+	RefinementReport.NumIterations = Result.NumIterations;
+	RefinementReport.NumPoints = Result.NumPoints;
+	RefinementReport.NumInliers = Result.NumInliers;
+	RefinementReport.ConvergenceTimeMs = static_cast<float>(Result.TotalTimeMs);
+	RefinementReport.IterationTimeMs = static_cast<float>(Result.AvgIterationTimeMs);
+	RefinementReport.RMSError = static_cast<float>(Result.RMSError);
+
+	UE_LOG(LogCompositionUtils, Verbose, TEXT("DepthAlignmentPass: Live refinement %s after %d iterations in %.2fms (%.3fms per iteration). %d/%d inliers, RMS error %.2fcm."),
+		Result.bConverged ? TEXT("converged") : TEXT("did not converge"),
+		Result.NumIterations, Result.TotalTimeMs, Result.AvgIterationTimeMs,
+		Result.NumInliers, Result.NumPoints, Result.RMSError);
+
+	// Live refinement may have been disabled while the solve was in flight
+	if (Result.bSuccess && bEnableLiveRefinement)
 	{
-		// This is done in three steps. First, the normals of the two planes are aligned.
-		// Second, the tangents of the planes are aligned. This is based on a rotation tuned by the user.
-		// Finally, translation is applied to line up the centroids of the planes. This is also additionally tuned by an offset supplied by user.
+		bHasRefinedTransform = true;
+		RefinedTransform = Result.Transform;
+		RefinedNodalOffset = static_cast<FMatrix44f>(RefinedTransform.ToMatrixNoScale());
+	}
+}
+
+void UCompositionUtilsDepthAlignmentPass::PostLoad()
+{
+	Super::PostLoad();
 
-		FVector3f TargetNormal{ 0, 0, -1 };
-		FVector3f TargetOrigin{ 0, 0, KnownDistance };
+	RequestCalibrationData();
+}
 
-		FVector3f Normal = Plane->GetNormal();
-		check(Normal.Normalize());
-		FVector3f Centroid = Plane->GetOrigin();
+void UCompositionUtilsDepthAlignmentPass::BeginDestroy()
+{
+	UnbindCalibrationData();
 
-		AlignmentTranslation = TargetOrigin - Centroid;
+	if (CalibrationLoadHandle.IsValid())
+	{
+		CalibrationLoadHandle->CancelHandle();
+		CalibrationLoadHandle.Reset();
+	}
 
-		// Construct basis for plane
-		FVector3f Tangent = Normal ^ ((Normal == FVector3f{ 0, 1, 0 }) 
-									? FVector3f{ 1, 0, 0 }
-									: Normal ^ FVector3f{ 0, 1, 0 });
-		FVector3f Bitangent = Normal ^ Tangent;
-		check(Bitangent.Normalize());
-		Tangent = Normal ^ Bitangent;
-		check(Tangent.IsNormalized());
+	Super::BeginDestroy();
+}
 
-		// Step 1: Align normals
-		float AngleBetweenNormals = FMath::Acos(Normal | TargetNormal);
-		FVector3f RotationAxis = Normal ^ TargetNormal;
-		check(RotationAxis.Normalize()); // Very important to normalize rotation axis
+#if WITH_EDITOR
+void UCompositionUtilsDepthAlignmentPass::PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent)
+{
+	Super::PostEditChangeProperty(PropertyChangedEvent);
 
-		AlignmentRotation = FQuat4f{ RotationAxis, AngleBetweenNormals };
+	if (PropertyChangedEvent.GetMemberPropertyName() == GET_MEMBER_NAME_CHECKED(UCompositionUtilsDepthAlignmentPass, CalibrationData))
+	{
+		RequestCalibrationData();
 	}
+}
+#endif
 
-	// Send transform to game thread
-	TFuture<void> Task = Async(EAsyncExecution::TaskGraphMainTick, [this, AlignmentTranslation, AlignmentRotation]
+void UCompositionUtilsDepthAlignmentPass::RequestCalibrationData()
+{
+	if (CalibrationLoadHandle.IsValid())
+	{
+		CalibrationLoadHandle->CancelHandle();
+		CalibrationLoadHandle.Reset();
+	}
+
+	RequestedCalibrationPath = CalibrationData.ToSoftObjectPath();
+
+	if (CalibrationData.IsNull())
+	{
+		UnbindCalibrationData();
+		OnCalibrationChanged(nullptr);
+		return;
+	}
+
+	if (UReprojectionCalibration* Calibration = CalibrationData.Get())
+	{
+		BindCalibrationData(Calibration);
+		return;
+	}
+
+	// Keep using the previous nodal offset until the new calibration has streamed in
+	CalibrationLoadHandle = UAssetManager::GetStreamableManager().RequestAsyncLoad(
+		RequestedCalibrationPath,
+		FStreamableDelegate::CreateWeakLambda(this, [this]()
 		{
-			UpdateCalibration_GameThread(AlignmentTranslation, AlignmentRotation);
-		});
+			CalibrationLoadHandle.Reset();
+
+			if (UReprojectionCalibration* Calibration = CalibrationData.Get())
+			{
+				BindCalibrationData(Calibration);
+			}
+			else
+			{
+				UE_LOG(LogCompositionUtils, Warning, TEXT("DepthAlignmentPass: Failed to load CalibrationData '%s'."), *RequestedCalibrationPath.ToString());
+			}
+		}));
 }
 
-void UCompositionUtilsDepthAlignmentPass::UpdateCalibration_GameThread(const FVector3f& Translation, const FQuat4f& Rotation)
+void UCompositionUtilsDepthAlignmentPass::BindCalibrationData(UReprojectionCalibration* Calibration)
 {
-	check(IsInGameThread());
-	CalibratedTranslation = Translation;
-	CalibratedRotation = Rotation;
+	if (BoundCalibration != Calibration)
+	{
+		UnbindCalibrationData();
+
+		BoundCalibration = Calibration;
+		CalibrationChangedHandle = Calibration->OnCalibrationChanged.AddUObject(this, &UCompositionUtilsDepthAlignmentPass::OnCalibrationChanged);
+	}
+
+	OnCalibrationChanged(Calibration);
+}
+
+void UCompositionUtilsDepthAlignmentPass::UnbindCalibrationData()
+{
+	if (UReprojectionCalibration* Calibration = BoundCalibration)
+	{
+		Calibration->OnCalibrationChanged.Remove(CalibrationChangedHandle);
+	}
+
+	BoundCalibration = nullptr;
+	CalibrationChangedHandle.Reset();
+}
+
+void UCompositionUtilsDepthAlignmentPass::OnCalibrationChanged(UReprojectionCalibration* Calibration)
+{
+	CalibratedTransform = Calibration ? Calibration->ExtrinsicTransform : FTransform::Identity;
+	CalibratedNodalOffset = static_cast<FMatrix44f>(CalibratedTransform.ToMatrixNoScale());
 }
-*/
 
 //////////////////////////////////////
 // UCompositionUtilsVolumetricsPass //
 //////////////////////////////////////
 
 
-UTexture* UCompositionUtilsVolumetricsPass::ApplyTransform_Implementation(UTexture* Input, UComposurePostProcessingPassProxy* PostProcessProxy, ACameraActor* TargetCamera)
+bool UCompositionUtilsVolumetricsPass::PrepareRenderPass(FIntPoint InputSize, ACameraActor* TargetCamera, FCompUtilsPreparedPass& OutPass)
 {
-	if (!Input || !CompUtilsCGLayer.IsValid())
-		return Input;
-	check(Input->GetResource());
-
-	FIntPoint Dims;
-	Dims.X = Input->GetResource()->GetSizeX();
-	Dims.Y = Input->GetResource()->GetSizeY();
-
-	UTextureRenderTarget2D* RenderTarget = RequestRenderTarget(Dims, PF_FloatRGBA);
-	if (!(RenderTarget && RenderTarget->GetResource()))
-		return Input;
+	if (!CompUtilsCGLayer.IsValid())
+		return false;
 
 	FVolumetricsCompositionParametersProxy Params;
-	Params.VolumetricFogData = static_cast<const ACompositionUtilsCaptureBase*>(CompUtilsCGLayer.Get())->GetVolumetricFogData();
-	if (!Params.VolumetricFogData || !Params.VolumetricFogData->IntegratedLightScatteringTexture)
-		return Input;
+	Params.VolumetricFogData = CompUtilsCGLayer->GetVolumetricFogData();
+	if (!Params.VolumetricFogData.IsValid() || !Params.VolumetricFogData->HasData())
+		return false;
+
+	// Composes the fog of the capture in this frame, if it has been extracted by the time the pass executes
+	Params.FrameNumber = GFrameCounter;
 
 	// Get the output of the depth pass
 	bool bSuccess = PrePassLookupTable->FindNamedPassResult(CameraDepthPassName, Params.CameraDepthTexture);
 	if (!bSuccess || !Params.CameraDepthTexture)
-		return Input;
-
-	ENQUEUE_RENDER_COMMAND(ApplyVolumetricCompositionPass)(
-		[Parameters = MoveTemp(Params), InputResource = Input->GetResource(), OutputResource = RenderTarget->GetResource()]
-		(FRHICommandListImmediate& RHICmdList)
-		{
-			FRDGBuilder GraphBuilder(RHICmdList);
-
-			TRefCountPtr<IPooledRenderTarget> InputRT = CreateRenderTarget(InputResource->GetTextureRHI(), TEXT("CompUtilsVolumetricsPass.Input"));
-			TRefCountPtr<IPooledRenderTarget> OutputRT = CreateRenderTarget(OutputResource->GetTextureRHI(), TEXT("CompUtilsVolumetricsPass.Output"));
+		return false;
 
-			// Set up RDG resources
-			FRDGTextureRef InColorTexture = GraphBuilder.RegisterExternalTexture(InputRT);
-			FRDGTextureRef OutColorTexture = GraphBuilder.RegisterExternalTexture(OutputRT);
-
-			// Execute pipeline
-			CompositionUtils::ExecuteVolumetricsCompositionPipeline(
-				GraphBuilder,
-				Parameters,
-				InColorTexture,
-				OutColorTexture
-			);
-
-			GraphBuilder.Execute();
-		});
+	OutPass.Name = TEXT("VolumetricsPass");
+	OutPass.OutputSize = InputSize;
+	OutPass.Record = [Parameters = MoveTemp(Params)](FRDGBuilder& GraphBuilder, FRDGTextureRef InTexture, FRDGTextureRef OutTexture)
+	{
+		CompositionUtils::ExecuteVolumetricsCompositionPipeline(
+			GraphBuilder,
+			Parameters,
+			InTexture,
+			OutTexture
+		);
+	};
 
-	return RenderTarget;
+	return true;
 }
 
 
@@ -371,22 +597,10 @@ UTexture* UCompositionUtilsVolumetricsPass::ApplyTransform_Implementation(UTextu
 /////////////////////////////////////
 
 
-UTexture* UCompositionUtilsRelightingPass::ApplyTransform_Implementation(UTexture* Input, UComposurePostProcessingPassProxy* PostProcessProxy, ACameraActor* TargetCamera)
+bool UCompositionUtilsRelightingPass::PrepareRenderPass(FIntPoint InputSize, ACameraActor* TargetCamera, FCompUtilsPreparedPass& OutPass)
 {
-	if (!Input)
-		return Input;
-	check(Input->GetResource());
-
 	if (!TargetCamera || !TargetCamera->GetCameraComponent())
-		return Input;
-
-	FIntPoint Dims;
-	Dims.X = Input->GetResource()->GetSizeX();
-	Dims.Y = Input->GetResource()->GetSizeY();
-
-	UTextureRenderTarget2D* RenderTarget = RequestRenderTarget(Dims, PF_FloatRGBA);
-	if (!(RenderTarget && RenderTarget->GetResource()))
-		return Input;
+		return false;
 
 	FRelightingParametersProxy Params;
 	bool bSuccess = PrePassLookupTable->FindNamedPassResult(CameraDepthPassName, Params.CameraDepthTexture);
@@ -403,33 +617,33 @@ UTexture* UCompositionUtilsRelightingPass::ApplyTransform_Implementation(UTextur
 	Params.LightWeight = LightWeight;
 
 	if (!bSuccess || !Params.IsValid())
-		return Input;
-
-	ENQUEUE_RENDER_COMMAND(ApplyRelightingPass)(
-		[Parameters = MoveTemp(Params), InputResource = Input->GetResource(), OutputResource = RenderTarget->GetResource()]
-		(FRHICommandListImmediate& RHICmdList)
-		{
-			FRDGBuilder GraphBuilder(RHICmdList);
-
-			TRefCountPtr<IPooledRenderTarget> InputRT = CreateRenderTarget(InputResource->GetTextureRHI(), TEXT("CompUtilsRelightingPass.Input"));
-			TRefCountPtr<IPooledRenderTarget> OutputRT = CreateRenderTarget(OutputResource->GetTextureRHI(), TEXT("CompUtilsRelightingPass.Output"));
-
-			// Set up RDG resources
-			FRDGTextureRef InColorTexture = GraphBuilder.RegisterExternalTexture(InputRT);
-			FRDGTextureRef OutColorTexture = GraphBuilder.RegisterExternalTexture(OutputRT);
-
-			// Execute pipeline
-			CompositionUtils::ExecuteRelightingPipeline(
-				GraphBuilder,
-				Parameters,
-				InColorTexture,
-				OutColorTexture
-			);
-
-			GraphBuilder.Execute();
-		});
+		return false;
+
+	const ULightComponent* Light = LightSource->GetComponent();
+
+	FCompUtilsPassStateHash Hash;
+	Hash.Add(Params.CameraTransform.ToMatrixWithScale());
+	Hash.Add(Params.LightWeight);
+	Hash.Add(Light->GetDirection());
+	Hash.Add(Light->GetLightColor());
+	Hash.Add(Light->Intensity);
+	Hash.AddTexture(Params.CameraDepthTexture);
+	Hash.AddTexture(Params.CameraNormalTexture);
+	Hash.Finish(OutPass);
+
+	OutPass.Name = TEXT("RelightingPass");
+	OutPass.OutputSize = InputSize;
+	OutPass.Record = [Parameters = MoveTemp(Params)](FRDGBuilder& GraphBuilder, FRDGTextureRef InTexture, FRDGTextureRef OutTexture)
+	{
+		CompositionUtils::ExecuteRelightingPipeline(
+			GraphBuilder,
+			Parameters,
+			InTexture,
+			OutTexture
+		);
+	};
 
-	return RenderTarget;
+	return true;
 }
 
 
@@ -438,47 +652,33 @@ UTexture* UCompositionUtilsRelightingPass::ApplyTransform_Implementation(UTextur
 ///////////////////////////////////////
 
 
-UTexture* UCompositionUtilsAddCrosshairPass::ApplyTransform_Implementation(UTexture* Input, UComposurePostProcessingPassProxy* PostProcessProxy, ACameraActor* TargetCamera)
+bool UCompositionUtilsAddCrosshairPass::PrepareRenderPass(FIntPoint InputSize, ACameraActor* TargetCamera, FCompUtilsPreparedPass& OutPass)
 {
-	if (!Input)
-		return Input;
-	check(Input->GetResource());
-
 	if (!TargetCamera || !TargetCamera->GetCameraComponent())
-		return Input;
-
-	FIntPoint Dims;
-	Dims.X = Input->GetResource()->GetSizeX();
-	Dims.Y = Input->GetResource()->GetSizeY();
-
-	UTextureRenderTarget2D* RenderTarget = RequestRenderTarget(Dims, PF_FloatRGBA);
-	if (!(RenderTarget && RenderTarget->GetResource()))
-		return Input;
-
-	ENQUEUE_RENDER_COMMAND(AddCrosshairPass)(
-		[this, InputResource = Input->GetResource(), OutputResource = RenderTarget->GetResource()]
-		(FRHICommandListImmediate& RHICmdList)
-		{
-			FRDGBuilder GraphBuilder(RHICmdList);
-
-			TRefCountPtr<IPooledRenderTarget> InputRT = CreateRenderTarget(InputResource->GetTextureRHI(), TEXT("CompUtilsAddCrosshairPass.Input"));
-			TRefCountPtr<IPooledRenderTarget> OutputRT = CreateRenderTarget(OutputResource->GetTextureRHI(), TEXT("CompUtilsAddCrosshairPass.Output"));
-			FRDGTextureRef InTexture = GraphBuilder.RegisterExternalTexture(InputRT);
-			FRDGTextureRef OutTexture = GraphBuilder.RegisterExternalTexture(OutputRT);
-
-			CompositionUtils::ExecuteAddCrosshairPipeline(
-				GraphBuilder,
-				FVector4f(Color),
-				static_cast<uint32>(Width),
-				static_cast<uint32>(Length),
-				InTexture,
-				OutTexture
-			);
-
-			GraphBuilder.Execute();
-		});
+		return false;
+
+	FCompUtilsPassStateHash Hash;
+	Hash.Add(Color);
+	Hash.Add(Width);
+	Hash.Add(Length);
+	Hash.Finish(OutPass);
+
+	OutPass.Name = TEXT("AddCrosshairPass");
+	OutPass.OutputSize = InputSize;
+	OutPass.Record = [CrosshairColor = FVector4f(Color), CrosshairWidth = static_cast<uint32>(Width), CrosshairLength = static_cast<uint32>(Length)]
+		(FRDGBuilder& GraphBuilder, FRDGTextureRef InTexture, FRDGTextureRef OutTexture)
+	{
+		CompositionUtils::ExecuteAddCrosshairPipeline(
+			GraphBuilder,
+			CrosshairColor,
+			CrosshairWidth,
+			CrosshairLength,
+			InTexture,
+			OutTexture
+		);
+	};
 
-	return RenderTarget;
+	return true;
 }
 
 
@@ -487,50 +687,28 @@ UTexture* UCompositionUtilsAddCrosshairPass::ApplyTransform_Implementation(UText
 ////////////////////////////////////////////
 
 
-UTexture* UCompositionUtilsDepthPreviewPass::ApplyTransform_Implementation(UTexture* Input, UComposurePostProcessingPassProxy* PostProcessProxy, ACameraActor* TargetCamera)
+bool UCompositionUtilsDepthPreviewPass::PrepareRenderPass(FIntPoint InputSize, ACameraActor* TargetCamera, FCompUtilsPreparedPass& OutPass)
 {
-	if (!Input)
-		return Input;
-	check(Input->GetResource());
-
 	if (!TargetCamera || !TargetCamera->GetCameraComponent())
-		return Input;
-
-	FIntPoint Dims;
-	Dims.X = Input->GetResource()->GetSizeX();
-	Dims.Y = Input->GetResource()->GetSizeY();
-
-	UTextureRenderTarget2D* RenderTarget = RequestRenderTarget(Dims, PF_FloatRGBA);
-	if (!(RenderTarget && RenderTarget->GetResource()))
-		return Input;
-
-	ApplyVisualizeDepth(Input, RenderTarget);
+		return false;
 
-	return RenderTarget;
-}
+	FCompUtilsPassStateHash Hash;
+	Hash.Add(VisualizeDepthRange);
+	Hash.Finish(OutPass);
 
-void UCompositionUtilsDepthPreviewPass::ApplyVisualizeDepth(UTexture* Input, UTextureRenderTarget2D* RenderTarget) const
-{
-	ENQUEUE_RENDER_COMMAND(ApplyDepthPreviewPass)(
-		[DepthRange = VisualizeDepthRange, InputResource = Input->GetResource(), OutputResource = RenderTarget->GetResource()]
-		(FRHICommandListImmediate& RHICmdList)
-		{
-			FRDGBuilder GraphBuilder(RHICmdList);
-
-			TRefCountPtr<IPooledRenderTarget> InputRT = CreateRenderTarget(InputResource->GetTextureRHI(), TEXT("CompUtilsDepthPreviewPass.Input"));
-			TRefCountPtr<IPooledRenderTarget> OutputRT = CreateRenderTarget(OutputResource->GetTextureRHI(), TEXT("CompUtilsDepthPreviewPass.Output"));
-			FRDGTextureRef InTexture = GraphBuilder.RegisterExternalTexture(InputRT);
-			FRDGTextureRef OutTexture = GraphBuilder.RegisterExternalTexture(OutputRT);
-
-			CompositionUtils::VisualizeProcessedDepth(
-				GraphBuilder,
-				static_cast<FVector2f>(DepthRange),
-				InTexture,
-				OutTexture
-			);
+	OutPass.Name = TEXT("DepthPreviewPass");
+	OutPass.OutputSize = InputSize;
+	OutPass.Record = [DepthRange = static_cast<FVector2f>(VisualizeDepthRange)](FRDGBuilder& GraphBuilder, FRDGTextureRef InTexture, FRDGTextureRef OutTexture)
+	{
+		CompositionUtils::VisualizeProcessedDepth(
+			GraphBuilder,
+			DepthRange,
+			InTexture,
+			OutTexture
+		);
+	};
 
-			GraphBuilder.Execute();
-		});
+	return true;
 }
 
 
@@ -538,22 +716,10 @@ void UCompositionUtilsDepthPreviewPass::ApplyVisualizeDepth(UTexture* Input, UTe
 // UCompositionUtilsNormalMapPreviewPass //
 ///////////////////////////////////////////
 
-UTexture* UCompositionUtilsNormalMapPreviewPass::ApplyTransform_Implementation(UTexture* Input, UComposurePostProcessingPassProxy* PostProcessProxy, ACameraActor* TargetCamera)
+bool UCompositionUtilsNormalMapPreviewPass::PrepareRenderPass(FIntPoint InputSize, ACameraActor* TargetCamera, FCompUtilsPreparedPass& OutPass)
 {
-	if (!Input)
-		return Input;
-	check(Input->GetResource());
-
 	if (!TargetCamera || !TargetCamera->GetCameraComponent())
-		return Input;
-
-	FIntPoint Dims;
-	Dims.X = Input->GetResource()->GetSizeX();
-	Dims.Y = Input->GetResource()->GetSizeY();
-
-	UTextureRenderTarget2D* RenderTarget = RequestRenderTarget(Dims, PF_FloatRGBA);
-	if (!(RenderTarget && RenderTarget->GetResource()))
-		return Input;
+		return false;
 
 	FTransform LocalToWorldTransform;
 	if (bDisplayWorldSpaceNormals)
@@ -564,29 +730,26 @@ UTexture* UCompositionUtilsNormalMapPreviewPass::ApplyTransform_Implementation(U
 		LocalToWorldTransform.SetTranslation(CameraView.Location);
 	}
 
-	ENQUEUE_RENDER_COMMAND(ApplyNormalMapPreviewPass)(
-		[bWorldSpace = bDisplayWorldSpaceNormals, LocalToWorld = LocalToWorldTransform, InputResource = Input->GetResource(), OutputResource = RenderTarget->GetResource()]
-		(FRHICommandListImmediate& RHICmdList)
-		{
-			FRDGBuilder GraphBuilder(RHICmdList);
-
-			TRefCountPtr<IPooledRenderTarget> InputRT = CreateRenderTarget(InputResource->GetTextureRHI(), TEXT("CompUtilsNormalMapPreviewPass.Input"));
-			TRefCountPtr<IPooledRenderTarget> OutputRT = CreateRenderTarget(OutputResource->GetTextureRHI(), TEXT("CompUtilsNormalMapPreviewPass.Output"));
-			FRDGTextureRef InTexture = GraphBuilder.RegisterExternalTexture(InputRT);
-			FRDGTextureRef OutTexture = GraphBuilder.RegisterExternalTexture(OutputRT);
+	FCompUtilsPassStateHash Hash;
+	Hash.Add(bDisplayWorldSpaceNormals);
+	Hash.Add(LocalToWorldTransform.ToMatrixWithScale());
+	Hash.Finish(OutPass);
 
-			CompositionUtils::VisualizeNormalMap(
-				GraphBuilder,
-				bWorldSpace,
-				LocalToWorld,
-				InTexture,
-				OutTexture
-			);
-
-			GraphBuilder.Execute();
-		});
+	OutPass.Name = TEXT("NormalMapPreviewPass");
+	OutPass.OutputSize = InputSize;
+	OutPass.Record = [bWorldSpace = bDisplayWorldSpaceNormals, LocalToWorld = LocalToWorldTransform]
+		(FRDGBuilder& GraphBuilder, FRDGTextureRef InTexture, FRDGTextureRef OutTexture)
+	{
+		CompositionUtils::VisualizeNormalMap(
+			GraphBuilder,
+			bWorldSpace,
+			LocalToWorld,
+			InTexture,
+			OutTexture
+		);
+	};
 
-	return RenderTarget;
+	return true;
 }
 
 
@@ -594,53 +757,34 @@ UTexture* UCompositionUtilsNormalMapPreviewPass::ApplyTransform_Implementation(U
 // UCompositionUtilsTextureMappingPass //
 /////////////////////////////////////////
 
-UTexture* UCompositionUtilsTextureMappingPass::ApplyTransform_Implementation(UTexture* Input, UComposurePostProcessingPassProxy* PostProcessProxy, ACameraActor* TargetCamera)
+bool UCompositionUtilsTextureMappingPass::PrepareRenderPass(FIntPoint InputSize, ACameraActor* TargetCamera, FCompUtilsPreparedPass& OutPass)
 {
-	if (!Input)
-		return Input;
-	check(Input->GetResource());
-
-	FIntPoint Dims;
-	Dims.X = Input->GetResource()->GetSizeX();
-	Dims.Y = Input->GetResource()->GetSizeY();
-
-	UTextureRenderTarget2D* RenderTarget = RequestRenderTarget(Dims, PF_FloatRGBA);
-	if (!(RenderTarget && RenderTarget->GetResource()))
-		return Input;
-
 	UTexture* AlignedDepth = nullptr;
 	bool bSuccess = PrePassLookupTable->FindNamedPassResult(AlignedDepthPassName, AlignedDepth);
 
-	if (!bSuccess || !AlignedDepth)
-		return Input;
-
-	ENQUEUE_RENDER_COMMAND(ApplyRelightingPass)(
-		[TextureToMapResource = Input->GetResource(), AlignedDepthResource = AlignedDepth->GetResource(), OutputResource = RenderTarget->GetResource()]
-		(FRHICommandListImmediate& RHICmdList)
-		{
-			FRDGBuilder GraphBuilder(RHICmdList);
-
-			TRefCountPtr<IPooledRenderTarget> TextureToMapRT = CreateRenderTarget(TextureToMapResource->GetTextureRHI(), TEXT("CompUtilsTextureMappingPass.TextureToMap"));
-			TRefCountPtr<IPooledRenderTarget> AlignedDepthRT = CreateRenderTarget(AlignedDepthResource->GetTextureRHI(), TEXT("CompUtilsTextureMappingPass.AlignedDepth"));
-			TRefCountPtr<IPooledRenderTarget> OutputRT = CreateRenderTarget(OutputResource->GetTextureRHI(), TEXT("CompUtilsTextureMappingPass.Output"));
+	if (!bSuccess || !AlignedDepth || !AlignedDepth->GetResource())
+		return false;
 
-			// Set up RDG resources
-			FRDGTextureRef InTextureToMap = GraphBuilder.RegisterExternalTexture(TextureToMapRT);
-			FRDGTextureRef InAlignedDepth = GraphBuilder.RegisterExternalTexture(AlignedDepthRT);
-			FRDGTextureRef OutTexture = GraphBuilder.RegisterExternalTexture(OutputRT);
+	FCompUtilsPassStateHash Hash;
+	Hash.AddTexture(AlignedDepth);
+	Hash.Finish(OutPass);
 
-			// Execute pipeline
-			CompositionUtils::ExecuteTextureMappingPipeline(
-				GraphBuilder,
-				InTextureToMap,
-				InAlignedDepth,
-				OutTexture
-			);
-
-			GraphBuilder.Execute();
-		});
+	OutPass.Name = TEXT("TextureMappingPass");
+	OutPass.OutputSize = InputSize;
+	OutPass.Record = [AlignedDepthResource = AlignedDepth->GetResource()](FRDGBuilder& GraphBuilder, FRDGTextureRef InTextureToMap, FRDGTextureRef OutTexture)
+	{
+		TRefCountPtr<IPooledRenderTarget> AlignedDepthRT = CompositionUtils::GetExternalRenderTarget(AlignedDepthResource->GetTextureRHI(), TEXT("CompUtilsTextureMappingPass.AlignedDepth"));
+		FRDGTextureRef InAlignedDepth = GraphBuilder.RegisterExternalTexture(AlignedDepthRT);
+
+		CompositionUtils::ExecuteTextureMappingPipeline(
+			GraphBuilder,
+			InTextureToMap,
+			InAlignedDepth,
+			OutTexture
+		);
+	};
 
-	return RenderTarget;
+	return true;
 }
 
 
@@ -660,3 +804,8 @@ UTexture* UCompositionUtilsCompareTexturesPass::ApplyTransform_Implementation(UT
 
 	return bShowA ? TextureA : TextureB;
 }
+
+void UCompositionUtilsCompareTexturesPass::GetReferencedPassNames(TArray<FName>& OutPassNames) const
+{
+	OutPassNames.Add(bShowA ? TextureAPassName : TextureBPassName);
+}
@@ -0,0 +1,563 @@
+#include "Composure/CompUtilsPassBase.h"
+
+#include "RenderGraphBuilder.h"
+#include "RenderGraphUtils.h"
+#include "TextureResource.h"
+#include "Engine/TextureRenderTarget2D.h"
+#include "ProfilingDebugging/CpuProfilerTrace.h"
+
+#include "CompositingElement.h"
+#include "CompositionUtils.h"
+#include "CompUtilsSampleLatency.h"
+#include "Composure/CompUtilsTextureRevisions.h"
+
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Passes Executed"), STAT_CompUtilsPassesExecuted, STATGROUP_CompUtils);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Passes Skipped"), STAT_CompUtilsPassesSkipped, STATGROUP_CompUtils);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Passes Unused"), STAT_CompUtilsPassesUnused, STATGROUP_CompUtils);
+
+
+// Identifies the work of a pass on one thread in stat CompUtils, CSV captures and Unreal Insights
+struct FCompUtilsPassProfilingId
+{
+	FString EventName;
+	FName CsvStatName;
+	TStatId StatId;
+};
+
+struct FCompUtilsPassProfilingIds
+{
+	FCompUtilsPassProfilingId GameThread;
+	FCompUtilsPassProfilingId RenderThread;
+};
+
+// Profiling ids are named after the class of the pass, so that the cost of every kind of pass shows up separately
+// Keyed by class rather than by pass name, so that renaming passes doesn't keep adding ids
+// Created on the game thread and never freed, so that render commands can refer to them
+static const FCompUtilsPassProfilingIds& GetPassProfilingIds(const UCompositingElementTransform* Pass)
+{
+	check(IsInGameThread());
+
+	const FName ClassName = Pass->GetClass()->GetFName();
+
+	static TMap<FName, TUniquePtr<FCompUtilsPassProfilingIds>> ProfilingIds;
+	TUniquePtr<FCompUtilsPassProfilingIds>& Ids = ProfilingIds.FindOrAdd(ClassName);
+	if (!Ids)
+	{
+		Ids = MakeUnique<FCompUtilsPassProfilingIds>();
+
+		auto InitId = [&ClassName](FCompUtilsPassProfilingId& Id, const TCHAR* ThreadName)
+		{
+			Id.EventName = FString::Printf(TEXT("CompUtils.%s.%s"), *ClassName.ToString(), ThreadName);
+			Id.CsvStatName = FName(*Id.EventName);
+#if STATS
+			Id.StatId = FDynamicStats::CreateStatId<FStatGroup_STATGROUP_CompUtils>(Id.EventName);
+#endif
+		};
+		InitId(Ids->GameThread, TEXT("GameThread"));
+		InitId(Ids->RenderThread, TEXT("RenderThread"));
+	}
+
+	return *Ids;
+}
+
+// Times a scope as a cycle stat, an accumulated CSV stat and a trace event on the CompUtils channel
+class FCompUtilsPassProfilingScope
+{
+public:
+	explicit FCompUtilsPassProfilingScope(const FCompUtilsPassProfilingId& InId)
+		: Id(InId)
+#if STATS
+		, CycleCounter(InId.StatId)
+#endif
+		, StartCycles(FPlatformTime::Cycles64())
+	{
+#if CPUPROFILERTRACE_ENABLED
+		bTraced = UE_TRACE_CHANNELEXPR_IS_ENABLED(CompUtilsChannel);
+		if (bTraced)
+		{
+			FCpuProfilerTrace::OutputBeginDynamicEvent(*Id.EventName);
+		}
+#endif
+	}
+
+	~FCompUtilsPassProfilingScope()
+	{
+#if CPUPROFILERTRACE_ENABLED
+		if (bTraced)
+		{
+			FCpuProfilerTrace::OutputEndEvent();
+		}
+#endif
+#if CSV_PROFILER
+		const float Milliseconds = static_cast<float>(FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - StartCycles));
+		FCsvProfiler::RecordCustomStat(Id.CsvStatName, CSV_CATEGORY_INDEX(CompUtils), Milliseconds, ECsvCustomStatOp::Accumulate);
+#endif
+	}
+
+private:
+	const FCompUtilsPassProfilingId& Id;
+#if STATS
+	FScopeCycleCounter CycleCounter;
+#endif
+	uint64 StartCycles;
+	bool bTraced = false;
+};
+
+
+// Whether the output of the pass is the final composite: that of the last pass of an element that isn't composited into a parent
+static bool IsFinalCompositePass(const UCompositingElementTransform* Pass)
+{
+	const ACompositingElement* Element = Pass->GetTypedOuter<ACompositingElement>();
+	if (!Element || Element->GetElementParent())
+		return false;
+
+	const TConstArrayView<TObjectPtr<UCompositingElementTransform>> Transforms = CompositionUtils::GetTransformPasses(Element);
+	for (int32 i = Transforms.Num() - 1; i >= 0; i--)
+	{
+		if (Transforms[i] && Transforms[i]->bEnabled)
+			return Transforms[i] == Pass;
+	}
+
+	return false;
+}
+
+// Sample time of the output if it is the final composite, unset otherwise
+// Its latency from the camera is recorded by the render command that submits the passes of the output
+static TOptional<FCompUtilsSampleTime> GetCompositeSampleTime(const UCompositingElementTransform* Pass, UTexture* Output)
+{
+	FCompUtilsSampleTime SampleTime;
+	if (!IsFinalCompositePass(Pass) || !CompositionUtils::GetTextureSampleTime(Output, SampleTime))
+		return {};
+
+	return SampleTime;
+}
+
+// Outputs that are handed on again have no render command of their own, so their latency is recorded by a separate one
+static void RecordHandedOnCompositeLatency(const UCompositingElementTransform* Pass, UTexture* Output)
+{
+	const TOptional<FCompUtilsSampleTime> SampleTime = GetCompositeSampleTime(Pass, Output);
+	if (!SampleTime.IsSet())
+		return;
+
+	ENQUEUE_RENDER_COMMAND(RecordCompUtilsCompositeLatency)(
+		[SampleTime = SampleTime.GetValue()](FRHICommandListImmediate& RHICmdList)
+		{
+			CompositionUtils::RecordSampleLatency_RenderThread(ECompUtilsLatencyStage::FinalComposite, SampleTime);
+		});
+}
+
+
+// Render target owned by a pass rather than the render target pool of the element, so that it can be handed on across frames
+static UTextureRenderTarget2D* CreatePersistentTarget(UObject* Outer, FIntPoint Size, EPixelFormat Format)
+{
+	UTextureRenderTarget2D* Target = NewObject<UTextureRenderTarget2D>(Outer);
+	Target->ClearColor = FLinearColor::Black;
+	Target->bAutoGenerateMips = false;
+	// Allows compute pipelines to write into the output directly
+	Target->bCanCreateUAV = UE::PixelFormat::HasCapabilities(Format, EPixelFormatCapabilities::TypedUAVStore);
+	Target->InitCustomFormat(Size.X, Size.Y, Format, true);
+	Target->UpdateResourceImmediate(true);
+	return Target;
+}
+
+// Combines the revision of the input with the state of the passes applied to it
+// Unset if the input or the state of any of the passes isn't tracked
+static TOptional<uint64> GetExecutionHash(UTexture* Input, TConstArrayView<FCompUtilsPreparedPass> Passes)
+{
+	uint64 InputRevision = 0;
+	if (!CompositionUtils::GetTextureRevision(Input, InputRevision))
+		return {};
+
+	FCompUtilsPassStateHash Hash;
+	Hash.Add(Input);
+	Hash.Add(InputRevision);
+	for (const FCompUtilsPreparedPass& Pass : Passes)
+	{
+		if (!Pass.StateHash.IsSet())
+			return {};
+
+		Hash.Add(Pass.StateHash.GetValue());
+		Hash.Add(Pass.OutputSize);
+		Hash.Add(Pass.OutputFormat);
+	}
+
+	return Hash.Get();
+}
+
+
+/////////////////////////////
+// FCompUtilsPassStateHash //
+/////////////////////////////
+
+void FCompUtilsPassStateHash::AddCamera(const FCompUtilsCameraIntrinsicData& Camera)
+{
+	Add(Camera.Type);
+	Add(Camera.ViewToNDC);
+	Add(Camera.HorizontalFOV);
+	Add(Camera.VerticalFOV);
+	Add(Camera.FocalLength);
+	Add(Camera.ImageCenter);
+	Add(Camera.DistortionParams.Num());
+	for (float Param : Camera.DistortionParams)
+	{
+		Add(Param);
+	}
+}
+
+void FCompUtilsPassStateHash::AddTexture(UTexture* Texture)
+{
+	uint64 Revision = 0;
+	if (!CompositionUtils::GetTextureRevision(Texture, Revision))
+	{
+		bTracked = false;
+		return;
+	}
+
+	Add(Texture);
+	Add(Revision);
+}
+
+void FCompUtilsPassStateHash::Finish(FCompUtilsPreparedPass& Pass) const
+{
+	if (bTracked)
+	{
+		Pass.StateHash = Hash;
+	}
+}
+
+
+//////////////////////////////
+// FCompUtilsExecutionCache //
+//////////////////////////////
+
+UTexture* FCompUtilsExecutionCache::Find(const TOptional<uint64>& ExecutionHash) const
+{
+	if (!ExecutionHash.IsSet() || ExecutionHash != LastExecutionHash)
+		return nullptr;
+
+	return (LastOutput && LastOutput->GetResource()) ? LastOutput.Get() : nullptr;
+}
+
+UTextureRenderTarget2D* FCompUtilsExecutionCache::GetPersistentTarget(UObject* Outer, FIntPoint Size, EPixelFormat Format)
+{
+	check(!HasWrittenPersistentTargetThisFrame());
+	LastWriteFrame = GFrameCounter;
+
+	if (!PersistentTarget
+		|| PersistentTarget->SizeX != Size.X
+		|| PersistentTarget->SizeY != Size.Y
+		|| PersistentTarget->GetFormat() != Format)
+	{
+		if (PersistentTarget)
+		{
+			PersistentTarget->ReleaseResource();
+		}
+		PersistentTarget = CreatePersistentTarget(Outer, Size, Format);
+	}
+
+	return PersistentTarget;
+}
+
+void FCompUtilsExecutionCache::Store(const TOptional<uint64>& ExecutionHash, UTexture* Output)
+{
+	LastExecutionHash = ExecutionHash;
+	LastOutput = ExecutionHash.IsSet() ? Output : nullptr;
+}
+
+void FCompUtilsExecutionCache::Reset()
+{
+	if (PersistentTarget)
+	{
+		PersistentTarget->ReleaseResource();
+	}
+
+	PersistentTarget = nullptr;
+	LastOutput = nullptr;
+	LastExecutionHash.Reset();
+	LastWriteFrame = MAX_uint64;
+}
+
+
+///////////////////////////////
+// UCompositionUtilsPassBase //
+///////////////////////////////
+
+UTexture* UCompositionUtilsPassBase::ApplyTransform_Implementation(UTexture* Input, UComposurePostProcessingPassProxy* PostProcessProxy, ACameraActor* TargetCamera)
+{
+	if (!Input)
+		return Input;
+	check(Input->GetResource());
+
+	const FCompUtilsPassProfilingIds& ProfilingIds = GetPassProfilingIds(this);
+	FCompUtilsPassProfilingScope ProfilingScope(ProfilingIds.GameThread);
+
+	if (!CompositionUtils::IsPassOutputUsed(this))
+	{
+		INC_DWORD_STAT(STAT_CompUtilsPassesUnused);
+		return Input;
+	}
+
+	FIntPoint Dims;
+	Dims.X = Input->GetResource()->GetSizeX();
+	Dims.Y = Input->GetResource()->GetSizeY();
+
+	FCompUtilsPreparedPass Pass;
+	if (!PrepareRenderPass(Dims, TargetCamera, Pass))
+		return Input;
+	ApplyOutputSettings(Pass);
+
+	// Hand on the previous output if neither the input nor the state of the pass changed since
+	const TOptional<uint64> ExecutionHash = GetExecutionHash(Input, MakeArrayView(&Pass, 1));
+	if (UTexture* PreviousOutput = ExecutionCache.Find(ExecutionHash))
+	{
+		INC_DWORD_STAT(STAT_CompUtilsPassesSkipped);
+		RecordHandedOnCompositeLatency(this, PreviousOutput);
+		return PreviousOutput;
+	}
+
+	// Only the first application of a frame is cached, see FCompUtilsExecutionCache::HasWrittenPersistentTargetThisFrame
+	const bool bCacheOutput = ExecutionHash.IsSet() && !ExecutionCache.HasWrittenPersistentTargetThisFrame();
+
+	UTextureRenderTarget2D* Output = bCacheOutput
+		? ExecutionCache.GetPersistentTarget(this, Pass.OutputSize, Pass.OutputFormat)
+		: RequestRenderTarget(Pass.OutputSize, Pass.OutputFormat);
+
+	if (!(Output && Output->GetResource()))
+		return Input;
+
+	// Persistent outputs are tracked, so that passes downstream can skip work as well
+	if (bCacheOutput)
+	{
+		CompositionUtils::BumpTextureRevision(Output);
+	}
+	// Outputs carry the sample time of the input they were rendered from
+	// Pooled outputs may be reused by anyone in later frames, so their sample time expires with the frame
+	CompositionUtils::PropagateTextureSampleTime(Input, Output, !bCacheOutput);
+
+	// Keep the output of the first application cached, as further ones were rendered into pooled targets
+	if (bCacheOutput || !ExecutionHash.IsSet())
+	{
+		ExecutionCache.Store(ExecutionHash, Output);
+	}
+	INC_DWORD_STAT(STAT_CompUtilsPassesExecuted);
+
+	ENQUEUE_RENDER_COMMAND(ApplyCompUtilsPass)(
+		[Pass = MoveTemp(Pass), InputResource = Input->GetResource(), OutputResource = Output->GetResource(), ProfilingId = &ProfilingIds.RenderThread,
+		CompositeSampleTime = GetCompositeSampleTime(this, Output)]
+		(FRHICommandListImmediate& RHICmdList) mutable
+		{
+			FCompUtilsPassProfilingScope ProfilingScope(*ProfilingId);
+			FRDGBuilder GraphBuilder(RHICmdList);
+
+			TRefCountPtr<IPooledRenderTarget> InputRT = CompositionUtils::GetExternalRenderTarget(InputResource->GetTextureRHI(), TEXT("CompUtilsPass.Input"));
+			TRefCountPtr<IPooledRenderTarget> OutputRT = CompositionUtils::GetExternalRenderTarget(OutputResource->GetTextureRHI(), TEXT("CompUtilsPass.Output"));
+
+			// Set up RDG resources
+			FRDGTextureRef InTexture = GraphBuilder.RegisterExternalTexture(InputRT);
+			FRDGTextureRef OutTexture = GraphBuilder.RegisterExternalTexture(OutputRT);
+
+			{
+				RDG_EVENT_SCOPE(GraphBuilder, "CompUtils.%s", Pass.Name);
+				Pass.Record(GraphBuilder, InTexture, OutTexture);
+			}
+
+			GraphBuilder.Execute();
+
+			// Measures the latency from the camera to the composite, once the passes recorded for it have been submitted
+			if (CompositeSampleTime.IsSet())
+			{
+				CompositionUtils::RecordSampleLatency_RenderThread(ECompUtilsLatencyStage::FinalComposite, CompositeSampleTime.GetValue());
+			}
+		});
+
+	return Output;
+}
+
+void UCompositionUtilsPassBase::ApplyOutputSettings(FCompUtilsPreparedPass& Pass) const
+{
+	if (!IsOutputFormatFixed())
+	{
+		switch (OutputFormat)
+		{
+		case ECompUtilsPassOutputFormat::RGBA8:		Pass.OutputFormat = PF_B8G8R8A8; break;
+		case ECompUtilsPassOutputFormat::RGB10A2:	Pass.OutputFormat = PF_A2B10G10R10; break;
+		case ECompUtilsPassOutputFormat::FloatRGBA:	Pass.OutputFormat = PF_FloatRGBA; break;
+		default:									Pass.OutputFormat = GetDefaultOutputFormat(); break;
+		}
+	}
+
+	if (!IsOutputResolutionFixed() && OutputResolutionScale < 1.0f)
+	{
+		const float Scale = FMath::Clamp(OutputResolutionScale, 0.1f, 1.0f);
+		Pass.OutputSize.X = FMath::Max(FMath::RoundToInt(Pass.OutputSize.X * Scale), 1);
+		Pass.OutputSize.Y = FMath::Max(FMath::RoundToInt(Pass.OutputSize.Y * Scale), 1);
+	}
+}
+
+void UCompositionUtilsPassBase::OnDisabled_Implementation()
+{
+	Super::OnDisabled_Implementation();
+
+	ExecutionCache.Reset();
+}
+
+
+////////////////////////////////
+// UCompositionUtilsPassChain //
+////////////////////////////////
+
+FIntPoint UCompositionUtilsPassChain::PreparePasses(FIntPoint InputSize, ACameraActor* TargetCamera, FCompUtilsPreparedPasses& OutPasses)
+{
+	FIntPoint Dims = InputSize;
+	for (UCompositionUtilsPassBase* Pass : Passes)
+	{
+		if (!Pass || !Pass->bEnabled)
+			continue;
+
+		// Passes of the chain are not known to the element, so share the lookup table of the chain
+		Pass->PrePassLookupTable = PrePassLookupTable;
+
+		FCompUtilsPreparedPass& PreparedPass = OutPasses.AddDefaulted_GetRef();
+		if (Pass->PrepareRenderPass(Dims, TargetCamera, PreparedPass))
+		{
+			Pass->ApplyOutputSettings(PreparedPass);
+			Dims = PreparedPass.OutputSize;
+		}
+		else
+		{
+			OutPasses.Pop();
+		}
+	}
+
+	return Dims;
+}
+
+UTexture* UCompositionUtilsPassChain::ApplyTransform_Implementation(UTexture* Input, UComposurePostProcessingPassProxy* PostProcessProxy, ACameraActor* TargetCamera)
+{
+	if (!Input)
+		return Input;
+	check(Input->GetResource());
+
+	const FCompUtilsPassProfilingIds& ProfilingIds = GetPassProfilingIds(this);
+	FCompUtilsPassProfilingScope ProfilingScope(ProfilingIds.GameThread);
+
+	if (!CompositionUtils::IsPassOutputUsed(this))
+	{
+		INC_DWORD_STAT(STAT_CompUtilsPassesUnused);
+		return Input;
+	}
+
+	FIntPoint InputSize;
+	InputSize.X = Input->GetResource()->GetSizeX();
+	InputSize.Y = Input->GetResource()->GetSizeY();
+
+	FCompUtilsPreparedPasses PreparedPasses;
+	const FIntPoint Dims = PreparePasses(InputSize, TargetCamera, PreparedPasses);
+
+	if (PreparedPasses.IsEmpty())
+		return Input;
+
+	// See UCompositionUtilsPassBase::ApplyTransform_Implementation
+	const TOptional<uint64> ExecutionHash = GetExecutionHash(Input, PreparedPasses);
+	if (UTexture* PreviousOutput = ExecutionCache.Find(ExecutionHash))
+	{
+		INC_DWORD_STAT_BY(STAT_CompUtilsPassesSkipped, PreparedPasses.Num());
+		RecordHandedOnCompositeLatency(this, PreviousOutput);
+		return PreviousOutput;
+	}
+
+	const bool bCacheOutput = ExecutionHash.IsSet() && !ExecutionCache.HasWrittenPersistentTargetThisFrame();
+
+	UTextureRenderTarget2D* Output = bCacheOutput
+		? ExecutionCache.GetPersistentTarget(this, Dims, PreparedPasses.Last().OutputFormat)
+		: RequestRenderTarget(Dims, PreparedPasses.Last().OutputFormat);
+
+	if (!(Output && Output->GetResource()))
+		return Input;
+
+	if (bCacheOutput)
+	{
+		CompositionUtils::BumpTextureRevision(Output);
+	}
+	CompositionUtils::PropagateTextureSampleTime(Input, Output, !bCacheOutput);
+
+	if (bCacheOutput || !ExecutionHash.IsSet())
+	{
+		ExecutionCache.Store(ExecutionHash, Output);
+	}
+	INC_DWORD_STAT_BY(STAT_CompUtilsPassesExecuted, PreparedPasses.Num());
+
+	ENQUEUE_RENDER_COMMAND(ApplyCompUtilsPassChain)(
+		[PreparedPasses = MoveTemp(PreparedPasses), InputResource = Input->GetResource(), OutputResource = Output->GetResource(), ProfilingId = &ProfilingIds.RenderThread,
+		CompositeSampleTime = GetCompositeSampleTime(this, Output)]
+		(FRHICommandListImmediate& RHICmdList) mutable
+		{
+			FCompUtilsPassProfilingScope ProfilingScope(*ProfilingId);
+			FRDGBuilder GraphBuilder(RHICmdList);
+
+			TRefCountPtr<IPooledRenderTarget> InputRT = CompositionUtils::GetExternalRenderTarget(InputResource->GetTextureRHI(), TEXT("CompUtilsPassChain.Input"));
+			TRefCountPtr<IPooledRenderTarget> OutputRT = CompositionUtils::GetExternalRenderTarget(OutputResource->GetTextureRHI(), TEXT("CompUtilsPassChain.Output"));
+
+			FRDGTextureRef CurrentTexture = GraphBuilder.RegisterExternalTexture(InputRT);
+
+			for (int32 Index = 0; Index < PreparedPasses.Num(); Index++)
+			{
+				FCompUtilsPreparedPass& Pass = PreparedPasses[Index];
+
+				// Only the final output outlives the graph
+				FRDGTextureRef OutTexture = nullptr;
+				if (Index == PreparedPasses.Num() - 1)
+				{
+					OutTexture = GraphBuilder.RegisterExternalTexture(OutputRT);
+				}
+				else
+				{
+					// Compute pipelines fall back to a copy for formats that can't be written as a UAV
+					ETextureCreateFlags Flags = TexCreate_ShaderResource | TexCreate_RenderTargetable;
+					if (UE::PixelFormat::HasCapabilities(Pass.OutputFormat, EPixelFormatCapabilities::TypedUAVStore))
+					{
+						Flags |= TexCreate_UAV;
+					}
+
+					const FRDGTextureDesc Desc = FRDGTextureDesc::Create2D(Pass.OutputSize, Pass.OutputFormat, FClearValueBinding::Black, Flags);
+					OutTexture = GraphBuilder.CreateTexture(Desc, TEXT("CompUtilsPassChain.Intermediate"));
+				}
+
+				{
+					RDG_EVENT_SCOPE(GraphBuilder, "CompUtils.%s", Pass.Name);
+					Pass.Record(GraphBuilder, CurrentTexture, OutTexture);
+				}
+
+				CurrentTexture = OutTexture;
+			}
+
+			GraphBuilder.Execute();
+
+			// Measures the latency from the camera to the composite, once the passes recorded for it have been submitted
+			if (CompositeSampleTime.IsSet())
+			{
+				CompositionUtils::RecordSampleLatency_RenderThread(ECompUtilsLatencyStage::FinalComposite, CompositeSampleTime.GetValue());
+			}
+		});
+
+	return Output;
+}
+
+void UCompositionUtilsPassChain::OnDisabled_Implementation()
+{
+	Super::OnDisabled_Implementation();
+
+	ExecutionCache.Reset();
+}
+
+void UCompositionUtilsPassChain::GetReferencedPassNames(TArray<FName>& OutPassNames) const
+{
+	for (const UCompositionUtilsPassBase* Pass : Passes)
+	{
+		if (Pass && Pass->bEnabled)
+		{
+			Pass->GetReferencedPassNames(OutPassNames);
+		}
+	}
+}
@@ -0,0 +1,131 @@
+#include "Composure/CompUtilsPassDependencies.h"
+
+#include "CompositingElement.h"
+#include "CompositingElements/CompositingElementPasses.h"
+#include "HAL/IConsoleManager.h"
+#include "UObject/ObjectKey.h"
+#include "UObject/UnrealType.h"
+
+#include "Composure/CompUtilsCaptureBase.h"
+
+
+static TAutoConsoleVariable<int32> CVarCompUtilsSkipUnusedPasses(
+	TEXT("r.CompUtils.SkipUnusedPasses"),
+	0,
+	TEXT("Whether CompUtils passes whose outputs are not read by any later pass of their element, or by the injection of a parent CompUtils capture, are skipped.\n")
+	TEXT("Only enable if pass results are not looked up from elsewhere, e.g. through FindNamedRenderResult in Blueprint.\n")
+	TEXT(" 0: always execute passes (default)\n")
+	TEXT(" 1: skip unused passes"),
+	ECVF_Default);
+
+
+// Transform passes of an element whose outputs nothing reads, resolved once per frame
+struct FCompUtilsElementLiveness
+{
+	uint64 LastUpdateFrame = MAX_uint64;
+	TSet<TObjectKey<UCompositingElementTransform>> UnusedPasses;
+};
+
+static TMap<TObjectKey<ACompositingElement>, FCompUtilsElementLiveness> GCompUtilsElementLiveness;
+static uint64 GCompUtilsElementLivenessPruneFrame = 0;
+
+
+// Named results that parent CompUtils captures inject into their scene, which may be looked up from their child elements
+static void GetInjectedPassNames(const ACompositingElement* Element, TSet<FName>& OutPassNames)
+{
+	for (const ACompositingElement* Parent = Element; Parent; Parent = Parent->GetElementParent())
+	{
+		const ACompositionUtilsCaptureBase* Capture = Cast<ACompositionUtilsCaptureBase>(Parent);
+		if (!Capture || !Capture->bInjectionMode)
+			continue;
+
+		OutPassNames.Add(Capture->bUseOverrideColorPass ? Capture->OverrideCameraColorPassName : Capture->CameraColorPassName);
+		OutPassNames.Add(Capture->CameraDepthPassName);
+		OutPassNames.Add(Capture->CameraNormalsPassName);
+	}
+}
+
+// Walks the transform passes of the element backwards, from the output of the element to the passes it depends on
+static void ResolveUnusedPasses(const ACompositingElement* Element, TSet<TObjectKey<UCompositingElementTransform>>& OutUnusedPasses)
+{
+	TSet<FName> ReferencedPassNames;
+	GetInjectedPassNames(Element, ReferencedPassNames);
+
+	// The output of the element is always used, by its outputs or by its parent
+	bool bInputUsed = true;
+	bool bAllResultsUsed = false;
+
+	TArray<FName> PassNames;
+	const TConstArrayView<TObjectPtr<UCompositingElementTransform>> Transforms = CompositionUtils::GetTransformPasses(Element);
+	for (int32 i = Transforms.Num() - 1; i >= 0; i--)
+	{
+		const UCompositingElementTransform* Transform = Transforms[i];
+		if (!Transform || !Transform->bEnabled)
+			continue;
+
+		if (!(bInputUsed || bAllResultsUsed || ReferencedPassNames.Contains(Transform->PassName)))
+		{
+			// Passes the input through unchanged, which nothing reads either
+			OutUnusedPasses.Add(Transform);
+			continue;
+		}
+
+		const ICompUtilsPassDependencies* Dependencies = Cast<ICompUtilsPassDependencies>(Transform);
+		if (!Dependencies)
+		{
+			bAllResultsUsed = true;
+			continue;
+		}
+
+		bInputUsed = Dependencies->ConsumesInput();
+
+		PassNames.Reset();
+		Dependencies->GetReferencedPassNames(PassNames);
+		ReferencedPassNames.Append(PassNames);
+	}
+}
+
+
+TConstArrayView<TObjectPtr<UCompositingElementTransform>> CompositionUtils::GetTransformPasses(const ACompositingElement* Element)
+{
+	// GetTransformsList returns a copy, so read the property in place
+	static const FArrayProperty* TransformPassesProperty = FindFProperty<FArrayProperty>(ACompositingElement::StaticClass(), TEXT("TransformPasses"));
+	checkf(TransformPassesProperty && TransformPassesProperty->Inner->IsA<FObjectPropertyBase>(), TEXT("ACompositingElement::TransformPasses has changed"));
+
+	return *TransformPassesProperty->ContainerPtrToValuePtr<TArray<TObjectPtr<UCompositingElementTransform>>>(Element);
+}
+
+bool CompositionUtils::IsPassOutputUsed(const UCompositingElementTransform* Pass)
+{
+	check(IsInGameThread());
+
+	if (CVarCompUtilsSkipUnusedPasses.GetValueOnGameThread() == 0)
+		return true;
+
+	const ACompositingElement* Element = Pass->GetTypedOuter<ACompositingElement>();
+	if (!Element)
+		return true;
+
+	if (GCompUtilsElementLivenessPruneFrame != GFrameCounter)
+	{
+		// Drop elements that have been destroyed
+		for (auto It = GCompUtilsElementLiveness.CreateIterator(); It; ++It)
+		{
+			if (!It.Key().ResolveObjectPtr())
+			{
+				It.RemoveCurrent();
+			}
+		}
+		GCompUtilsElementLivenessPruneFrame = GFrameCounter;
+	}
+
+	FCompUtilsElementLiveness& Liveness = GCompUtilsElementLiveness.FindOrAdd(Element);
+	if (Liveness.LastUpdateFrame != GFrameCounter)
+	{
+		Liveness.LastUpdateFrame = GFrameCounter;
+		Liveness.UnusedPasses.Reset();
+		ResolveUnusedPasses(Element, Liveness.UnusedPasses);
+	}
+
+	return !Liveness.UnusedPasses.Contains(Pass);
+}
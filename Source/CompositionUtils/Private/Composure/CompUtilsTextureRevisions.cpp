@@ -0,0 +1,239 @@
+#include "Composure/CompUtilsTextureRevisions.h"
+
+#include "MediaPlayer.h"
+#include "MediaPlayerFacade.h"
+#include "MediaSampleSink.h"
+#include "MediaTexture.h"
+#include "Misc/ScopeLock.h"
+#include "UObject/ObjectKey.h"
+
+
+struct FCompUtilsMediaSampleSnapshot
+{
+	uint64 SampleCount = 0;
+	TOptional<FCompUtilsSampleTime> LatestSampleTime;
+};
+
+/**
+ * Video sample sink that only counts the samples delivered by a media player, and notes when the latest one arrived, without holding on to them
+ * Samples are enqueued from media threads
+ */
+class FCompUtilsMediaSampleCounter : public FMediaTextureSampleSink
+{
+public:
+	//~ Begin TMediaSampleSink interface
+	virtual bool Enqueue(const TSharedRef<IMediaTextureSample, ESPMode::ThreadSafe>& Sample) override
+	{
+		// The time a sample was captured at isn't known in general, its arrival is the closest to it
+		FCompUtilsSampleTime SampleTime;
+		SampleTime.Seconds = FPlatformTime::Seconds();
+		SampleTime.Frame = GFrameCounter;
+
+		FScopeLock Lock(&CriticalSection);
+		Snapshot.SampleCount++;
+		Snapshot.LatestSampleTime = SampleTime;
+		return true;
+	}
+
+	virtual int32 Num() const override { return 0; }
+	virtual void RequestFlush() override {}
+	virtual bool CanAcceptSamples(int32 NumSamples) const override { return true; }
+	//~ End TMediaSampleSink interface
+
+	FCompUtilsMediaSampleSnapshot GetSnapshot() const
+	{
+		FScopeLock Lock(&CriticalSection);
+		return Snapshot;
+	}
+
+private:
+	mutable FCriticalSection CriticalSection;
+	FCompUtilsMediaSampleSnapshot Snapshot;
+};
+
+
+struct FCompUtilsMediaTextureRevision
+{
+	TWeakObjectPtr<UMediaPlayer> Player;
+	TSharedPtr<FCompUtilsMediaSampleCounter, ESPMode::ThreadSafe> Counter;
+
+	// Samples counted at the first lookups of the two most recent frames
+	uint64 SnapshotFrame = MAX_uint64;
+	FCompUtilsMediaSampleSnapshot CurrentSnapshot;
+	FCompUtilsMediaSampleSnapshot PreviousSnapshot;
+};
+
+struct FCompUtilsTextureSampleTimeTag
+{
+	FCompUtilsSampleTime SampleTime;
+
+	// Frame the tag was set in, if it only holds for that frame
+	TOptional<uint64> TagFrame;
+};
+
+static TMap<TObjectKey<UTexture>, uint64> GCompUtilsTextureRevisions;
+static TMap<TObjectKey<UTexture>, FCompUtilsTextureSampleTimeTag> GCompUtilsTextureSampleTimes;
+static TMap<TObjectKey<UMediaTexture>, FCompUtilsMediaTextureRevision> GCompUtilsMediaTextureRevisions;
+static uint64 GCompUtilsTextureRevisionsPruneFrame = 0;
+
+
+// Returns the snapshot of samples that are certain to have been rendered into the media texture, see below
+static const FCompUtilsMediaSampleSnapshot* GetMediaTextureSnapshot(UMediaTexture* MediaTexture)
+{
+	UMediaPlayer* Player = MediaTexture->GetMediaPlayer();
+	if (!Player)
+		return nullptr;
+
+	FCompUtilsMediaTextureRevision& Revision = GCompUtilsMediaTextureRevisions.FindOrAdd(MediaTexture);
+	if (!Revision.Counter.IsValid() || Revision.Player != Player)
+	{
+		// Samples are only counted from here on, the facade drops the sink along with the revision
+		Revision = FCompUtilsMediaTextureRevision();
+		Revision.Player = Player;
+		Revision.Counter = MakeShared<FCompUtilsMediaSampleCounter, ESPMode::ThreadSafe>();
+		Player->GetPlayerFacade()->AddVideoSampleSink(Revision.Counter.ToSharedRef());
+	}
+
+	if (Revision.SnapshotFrame != GFrameCounter)
+	{
+		Revision.SnapshotFrame = GFrameCounter;
+		Revision.PreviousSnapshot = Revision.CurrentSnapshot;
+		Revision.CurrentSnapshot = Revision.Counter->GetSnapshot();
+	}
+
+	// A sample may be delivered after the media texture has been updated for this frame, in which case it only shows up on the next one
+	// Samples counted by a previous frame are certain to have been rendered into the texture by now, so the revision lags a frame behind
+	return &Revision.PreviousSnapshot;
+}
+
+static void PruneTextureRevisions()
+{
+	if (GCompUtilsTextureRevisionsPruneFrame == GFrameCounter)
+		return;
+
+	for (auto It = GCompUtilsTextureRevisions.CreateIterator(); It; ++It)
+	{
+		if (!It.Key().ResolveObjectPtr())
+		{
+			It.RemoveCurrent();
+		}
+	}
+
+	for (auto It = GCompUtilsTextureSampleTimes.CreateIterator(); It; ++It)
+	{
+		const TOptional<uint64>& TagFrame = It.Value().TagFrame;
+		if (!It.Key().ResolveObjectPtr() || (TagFrame.IsSet() && TagFrame.GetValue() != GFrameCounter))
+		{
+			It.RemoveCurrent();
+		}
+	}
+
+	for (auto It = GCompUtilsMediaTextureRevisions.CreateIterator(); It; ++It)
+	{
+		if (!It.Key().ResolveObjectPtr())
+		{
+			It.RemoveCurrent();
+		}
+	}
+
+	GCompUtilsTextureRevisionsPruneFrame = GFrameCounter;
+}
+
+
+bool CompositionUtils::GetTextureRevision(UTexture* Texture, uint64& OutRevision)
+{
+	check(IsInGameThread());
+
+	if (!Texture)
+		return false;
+
+	PruneTextureRevisions();
+
+	if (const uint64* Revision = GCompUtilsTextureRevisions.Find(Texture))
+	{
+		OutRevision = *Revision;
+		return true;
+	}
+
+	if (UMediaTexture* MediaTexture = Cast<UMediaTexture>(Texture))
+	{
+		if (const FCompUtilsMediaSampleSnapshot* Snapshot = GetMediaTextureSnapshot(MediaTexture))
+		{
+			OutRevision = Snapshot->SampleCount;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void CompositionUtils::BumpTextureRevision(UTexture* Texture)
+{
+	check(IsInGameThread());
+
+	if (Texture)
+	{
+		GCompUtilsTextureRevisions.FindOrAdd(Texture)++;
+	}
+}
+
+bool CompositionUtils::GetTextureSampleTime(UTexture* Texture, FCompUtilsSampleTime& OutSampleTime)
+{
+	check(IsInGameThread());
+
+	if (!Texture)
+		return false;
+
+	PruneTextureRevisions();
+
+	// Pruned above if the tag was only for a previous frame
+	if (const FCompUtilsTextureSampleTimeTag* Tag = GCompUtilsTextureSampleTimes.Find(Texture))
+	{
+		OutSampleTime = Tag->SampleTime;
+		return true;
+	}
+
+	if (UMediaTexture* MediaTexture = Cast<UMediaTexture>(Texture))
+	{
+		const FCompUtilsMediaSampleSnapshot* Snapshot = GetMediaTextureSnapshot(MediaTexture);
+		if (Snapshot && Snapshot->LatestSampleTime.IsSet())
+		{
+			OutSampleTime = Snapshot->LatestSampleTime.GetValue();
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void CompositionUtils::SetTextureSampleTime(UTexture* Texture, const FCompUtilsSampleTime& SampleTime)
+{
+	check(IsInGameThread());
+
+	if (Texture)
+	{
+		GCompUtilsTextureSampleTimes.Add(Texture, { SampleTime });
+	}
+}
+
+void CompositionUtils::PropagateTextureSampleTime(UTexture* Source, UTexture* Target, bool bCurrentFrameOnly)
+{
+	check(IsInGameThread());
+
+	if (!Target)
+		return;
+
+	FCompUtilsTextureSampleTimeTag Tag;
+	if (GetTextureSampleTime(Source, Tag.SampleTime))
+	{
+		if (bCurrentFrameOnly)
+		{
+			Tag.TagFrame = GFrameCounter;
+		}
+		GCompUtilsTextureSampleTimes.Add(Target, Tag);
+	}
+	else
+	{
+		GCompUtilsTextureSampleTimes.Remove(Target);
+	}
+}
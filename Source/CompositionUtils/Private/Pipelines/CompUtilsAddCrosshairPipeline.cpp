@@ -1,5 +1,7 @@
 #include "CompUtilsPipelines.h"
 
+DECLARE_GPU_STAT_NAMED(CompUtilsAddCrosshairStat, TEXT("CompUtilsAddCrosshair"));
+
 
 class FAddCrosshairPS : public FGlobalShader
 {
@@ -35,6 +37,10 @@ void CompositionUtils::ExecuteAddCrosshairPipeline(
 {
 	check(IsInRenderingThread());
 
+	RDG_EVENT_SCOPE_STAT(GraphBuilder, CompUtilsAddCrosshairStat, "CompUtilsAddCrosshair");
+	RDG_GPU_STAT_SCOPE(GraphBuilder, CompUtilsAddCrosshairStat);
+	SCOPED_NAMED_EVENT(CompUtilsAddCrosshair, FColor::Purple);
+
 	CompositionUtils::AddPass<FAddCrosshairPS>(
 		GraphBuilder,
 		RDG_EVENT_NAME("CompUtils.AddCrossHair"),
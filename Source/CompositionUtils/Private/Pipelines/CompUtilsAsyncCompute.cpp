@@ -0,0 +1,165 @@
+#include "CompUtilsPipelines.h"
+
+#include "Async/Async.h"
+#include "CompositionUtils.h"
+#include "Containers/Ticker.h"
+#include "HAL/IConsoleManager.h"
+
+
+static TAutoConsoleVariable<int32> CVarCompUtilsDepthAsyncCompute(
+	TEXT("r.CompUtils.DepthAsyncCompute"),
+	0,
+	TEXT("Whether the CompUtils depth processing and alignment pipelines run as compute passes on the async compute pipe.\n")
+	TEXT("Use CompUtils.BenchmarkDepthAsyncCompute to check whether this pays off on the target hardware.\n")
+	TEXT(" 0: pixel shaders on the graphics pipe (default)\n")
+	TEXT(" 1: compute shaders on the async compute pipe, where supported by the RHI"),
+	ECVF_RenderThreadSafe);
+
+
+bool CompositionUtils::UseDepthAsyncCompute()
+{
+	return CVarCompUtilsDepthAsyncCompute.GetValueOnRenderThread() != 0;
+}
+
+ERDGPassFlags CompositionUtils::GetDepthComputePassFlags()
+{
+	return (UseDepthAsyncCompute() && GSupportsEfficientAsyncCompute) ? ERDGPassFlags::AsyncCompute : ERDGPassFlags::Compute;
+}
+
+
+// Measures the GPU frame time with the depth chain on the graphics pipe and on the async compute pipe
+// Each configuration runs for the same number of frames, after a few frames for the change to reach the GPU
+class FCompUtilsDepthAsyncComputeBenchmark
+{
+public:
+	static void Start(int32 NumFrames)
+	{
+		if (Instance.IsValid())
+		{
+			UE_LOG(LogCompositionUtils, Warning, TEXT("Depth async compute benchmark is already running."));
+			return;
+		}
+
+		if (!GSupportsEfficientAsyncCompute)
+		{
+			UE_LOG(LogCompositionUtils, Warning, TEXT("RHI does not support efficient async compute, the depth chain will run as compute on the graphics pipe."));
+		}
+
+		const int32 OriginalValue = CVarCompUtilsDepthAsyncCompute.GetValueOnGameThread();
+		const EConsoleVariableFlags OriginalSetBy = static_cast<EConsoleVariableFlags>(CVarCompUtilsDepthAsyncCompute->GetFlags() & ECVF_SetByMask);
+		if (!SetAsyncCompute(0, OriginalSetBy))
+		{
+			UE_LOG(LogCompositionUtils, Warning, TEXT("Depth async compute benchmark cannot override r.CompUtils.DepthAsyncCompute."));
+			return;
+		}
+
+		Instance = MakeUnique<FCompUtilsDepthAsyncComputeBenchmark>(NumFrames, OriginalValue, OriginalSetBy);
+	}
+
+	FCompUtilsDepthAsyncComputeBenchmark(int32 InNumFrames, int32 InOriginalValue, EConsoleVariableFlags InOriginalSetBy)
+		: NumFrames(FMath::Max(InNumFrames, 1))
+		, OriginalValue(InOriginalValue)
+		, OriginalSetBy(InOriginalSetBy)
+	{
+		TickerHandle = FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateRaw(this, &FCompUtilsDepthAsyncComputeBenchmark::Tick));
+
+		UE_LOG(LogCompositionUtils, Log, TEXT("Running depth async compute benchmark over %d frames per configuration..."), NumFrames);
+	}
+
+	~FCompUtilsDepthAsyncComputeBenchmark()
+	{
+		FTSTicker::GetCoreTicker().RemoveTicker(TickerHandle);
+	}
+
+private:
+	// Sets the cvar with the priority it was originally set with, so that restoring it leaves no trace of the benchmark
+	// Returns false if the cvar didn't take the value, so that timings are never attributed to the wrong configuration
+	static bool SetAsyncCompute(int32 Value, EConsoleVariableFlags SetBy)
+	{
+		CVarCompUtilsDepthAsyncCompute->Set(Value, SetBy);
+		return CVarCompUtilsDepthAsyncCompute.GetValueOnGameThread() == Value;
+	}
+
+	// Restores the cvar and destroys the benchmark once the ticker is done with it
+	// Returns false to remove the ticker
+	bool Finish()
+	{
+		SetAsyncCompute(OriginalValue, OriginalSetBy);
+		AsyncTask(ENamedThreads::GameThread, []()
+		{
+			Instance.Reset();
+		});
+		return false;
+	}
+
+	bool Tick(float)
+	{
+		// GPU timings lag behind the game thread, so allow the change to take effect
+		if (WarmupFrames > 0)
+		{
+			WarmupFrames--;
+			return true;
+		}
+
+		if (CVarCompUtilsDepthAsyncCompute.GetValueOnGameThread() != Config)
+		{
+			UE_LOG(LogCompositionUtils, Warning, TEXT("r.CompUtils.DepthAsyncCompute changed while the depth async compute benchmark was running, aborting it."));
+			return Finish();
+		}
+
+		TotalGPUTimeMs[Config] += FPlatformTime::ToMilliseconds(RHIGetGPUFrameCycles());
+		MeasuredFrames++;
+
+		if (MeasuredFrames < NumFrames)
+			return true;
+
+		if (Config == 0)
+		{
+			Config = 1;
+			if (!SetAsyncCompute(Config, OriginalSetBy))
+			{
+				UE_LOG(LogCompositionUtils, Warning, TEXT("Depth async compute benchmark cannot override r.CompUtils.DepthAsyncCompute, aborting it."));
+				return Finish();
+			}
+			MeasuredFrames = 0;
+			WarmupFrames = NumWarmupFrames;
+			return true;
+		}
+
+		const double GraphicsMs = TotalGPUTimeMs[0] / NumFrames;
+		const double AsyncMs = TotalGPUTimeMs[1] / NumFrames;
+		UE_LOG(LogCompositionUtils, Log, TEXT("Depth async compute benchmark: GPU frame time %.3fms on graphics pipe, %.3fms on async compute pipe. Recovered %.3fms (%.1f%%)."),
+			GraphicsMs, AsyncMs, GraphicsMs - AsyncMs, GraphicsMs > 0.0 ? 100.0 * (GraphicsMs - AsyncMs) / GraphicsMs : 0.0);
+
+		return Finish();
+	}
+
+	static constexpr int32 NumWarmupFrames = 4;
+
+	static TUniquePtr<FCompUtilsDepthAsyncComputeBenchmark> Instance;
+
+	FTSTicker::FDelegateHandle TickerHandle;
+
+	int32 NumFrames;
+	int32 OriginalValue;
+	EConsoleVariableFlags OriginalSetBy;
+
+	// Configuration being measured, 0 on the graphics pipe and 1 on the async compute pipe
+	int32 Config = 0;
+	int32 WarmupFrames = NumWarmupFrames;
+	int32 MeasuredFrames = 0;
+	double TotalGPUTimeMs[2] = { 0.0, 0.0 };
+};
+
+TUniquePtr<FCompUtilsDepthAsyncComputeBenchmark> FCompUtilsDepthAsyncComputeBenchmark::Instance;
+
+
+static FAutoConsoleCommand CCmdCompUtilsBenchmarkDepthAsyncCompute(
+	TEXT("CompUtils.BenchmarkDepthAsyncCompute"),
+	TEXT("Reports how much GPU frame time is recovered by running the depth chain on the async compute pipe, see r.CompUtils.DepthAsyncCompute.\n")
+	TEXT("Usage: CompUtils.BenchmarkDepthAsyncCompute [NumFrames=120]"),
+	FConsoleCommandWithArgsDelegate::CreateStatic([](const TArray<FString>& Args)
+	{
+		const int32 NumFrames = Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 120;
+		FCompUtilsDepthAsyncComputeBenchmark::Start(NumFrames);
+	}));
@@ -0,0 +1,62 @@
+#include "CompUtilsBoxDownsample.h"
+
+#include "CompUtilsPipelines.h"
+
+DECLARE_GPU_STAT_NAMED(CompUtilsBoxDownsampleStat, TEXT("CompUtilsBoxDownsample"));
+
+
+class FBoxDownsamplePS : public FGlobalShader
+{
+	DECLARE_GLOBAL_SHADER(FBoxDownsamplePS)
+	SHADER_USE_PARAMETER_STRUCT(FBoxDownsamplePS, FGlobalShader)
+
+	BEGIN_SHADER_PARAMETER_STRUCT(FParameters, )
+		SHADER_PARAMETER_STRUCT(FScreenPassTextureViewportParameters, OutViewPort)
+		SHADER_PARAMETER_STRUCT(FScreenPassTextureViewportParameters, InViewPort)
+		SHADER_PARAMETER_SAMPLER(SamplerState, sampler0)
+
+		SHADER_PARAMETER_RDG_TEXTURE_SRV(Texture2D<float4>, InTex)
+
+		SHADER_PARAMETER(FUintVector2, InputDims)
+		SHADER_PARAMETER(uint32, DownsampleFactor)
+
+		RENDER_TARGET_BINDING_SLOTS()
+	END_SHADER_PARAMETER_STRUCT()
+
+	static bool ShouldCompilePermutation(const FGlobalShaderPermutationParameters& Parameters)
+	{
+		return CompositionUtils::ShouldCompileShader(Parameters);
+	}
+};
+
+IMPLEMENT_GLOBAL_SHADER(FBoxDownsamplePS, "/Plugin/CompositionUtils/BoxDownsample.usf", "BoxDownsamplePS", SF_Pixel);
+
+
+void CompositionUtils::AddBoxDownsamplePass(
+	FRDGBuilder& GraphBuilder,
+	FRDGTextureRef InTexture,
+	FRDGTextureRef OutTexture,
+	uint32 DownsampleFactor
+)
+{
+	check(IsInRenderingThread());
+	check(FIntPoint::DivideAndRoundUp(InTexture->Desc.Extent, FMath::Max<int32>(DownsampleFactor, 1)) == OutTexture->Desc.Extent);
+
+	RDG_EVENT_SCOPE_STAT(GraphBuilder, CompUtilsBoxDownsampleStat, "CompUtilsBoxDownsample");
+	SCOPED_NAMED_EVENT(CompUtilsBoxDownsample, FColor::Purple);
+
+	const FIntPoint InputDims = InTexture->Desc.Extent;
+
+	CompositionUtils::AddPass<FBoxDownsamplePS>(
+		GraphBuilder,
+		RDG_EVENT_NAME("CompUtils.BoxDownsample"),
+		OutTexture,
+		[&](auto PassParameters)
+		{
+			PassParameters->InTex = GraphBuilder.CreateSRV(InTexture);
+
+			PassParameters->InputDims = FUintVector2(InputDims.X, InputDims.Y);
+			PassParameters->DownsampleFactor = FMath::Max(DownsampleFactor, 1u);
+		}
+	);
+}
@@ -1,6 +1,9 @@
 #include "CompUtilsPipelines.h"
 #include "RHIGPUReadback.h"
 
+DECLARE_GPU_STAT_NAMED(CompUtilsCalibrationStat, TEXT("CompUtilsCalibration"));
+DECLARE_GPU_STAT_NAMED(CompUtilsCalibrationVisualizationStat, TEXT("CompUtilsCalibrationVisualization"));
+
 
 class FSpawnPointsAndDeprojectCS : public FGlobalShader
 {
@@ -36,6 +39,15 @@ class FVisualizePointSpawningPS : public FGlobalShader
 	DECLARE_GLOBAL_SHADER(FVisualizePointSpawningPS)
 	SHADER_USE_PARAMETER_STRUCT(FVisualizePointSpawningPS, FGlobalShader)
 
+	// Per-pixel loop over all calibration points is compiled out when the points are hidden
+	class FShowPoints : SHADER_PERMUTATION_BOOL("SHOW_POINTS");
+	using FPermutationDomain = TShaderPermutationDomain<FShowPoints>;
+
+	static bool ShouldCompilePermutation(const FGlobalShaderPermutationParameters& Parameters)
+	{
+		return CompositionUtils::ShouldCompileShader(Parameters);
+	}
+
 	BEGIN_SHADER_PARAMETER_STRUCT(FParameters, )
 		SHADER_PARAMETER_STRUCT(FScreenPassTextureViewportParameters, OutViewPort)
 		SHADER_PARAMETER_STRUCT(FScreenPassTextureViewportParameters, InViewPort)
@@ -46,8 +58,6 @@ class FVisualizePointSpawningPS : public FGlobalShader
 		SHADER_PARAMETER(uint32, NumPoints)
 		SHADER_PARAMETER(FVector4f, RulersMinAndMax)
 
-		SHADER_PARAMETER(uint32, bShowPoints)
-
 		RENDER_TARGET_BINDING_SLOTS()
 	END_SHADER_PARAMETER_STRUCT()
 };
@@ -62,6 +72,10 @@ void CompositionUtils::ExecuteDepthAlignmentCalibrationPipeline(
 	FRDGTextureRef OutTexture,
 	FRHIGPUBufferReadback& CalibrationPointReadback)
 {
+	RDG_EVENT_SCOPE_STAT(GraphBuilder, CompUtilsCalibrationStat, "CompUtilsCalibration");
+	RDG_GPU_STAT_SCOPE(GraphBuilder, CompUtilsCalibrationStat);
+	SCOPED_NAMED_EVENT(CompUtilsCalibration, FColor::Purple);
+
 	FRDGBufferRef CalibrationPointsBuffer = CreateStructuredBuffer(GraphBuilder, TEXT("CompositionUtils.DepthAlignment.CalibrationPoints"),
 		sizeof(FVector3f), Parameters.CalibrationPointCount, nullptr, 0);
 
@@ -111,7 +125,14 @@ void CompositionUtils::ExecuteDepthAlignmentCalibrationPipeline(
 
 void CompositionUtils::VisualizeDepthAlignmentCalibrationPoints(FRDGBuilder& GraphBuilder, const FDepthCalibrationParametersProxy& Parameters, FRDGTextureRef InTexture, FRDGTextureRef OutTexture)
 {
+	RDG_EVENT_SCOPE_STAT(GraphBuilder, CompUtilsCalibrationVisualizationStat, "CompUtilsCalibrationVisualization");
+	RDG_GPU_STAT_SCOPE(GraphBuilder, CompUtilsCalibrationVisualizationStat);
+	SCOPED_NAMED_EVENT(CompUtilsCalibrationVisualization, FColor::Purple);
+
 	// Visualize rulers + points for helpful user feedback
+	FVisualizePointSpawningPS::FPermutationDomain Permutation;
+	Permutation.Set<FVisualizePointSpawningPS::FShowPoints>(Parameters.bShowPoints);
+
 	CompositionUtils::AddPass<FVisualizePointSpawningPS>(
 		GraphBuilder,
 		RDG_EVENT_NAME("CompUtils.Calibration.VisualizePointSpawning"),
@@ -121,9 +142,8 @@ void CompositionUtils::VisualizeDepthAlignmentCalibrationPoints(FRDGBuilder& Gra
 			PassParameters->InTex = GraphBuilder.CreateSRV(InTexture);
 			PassParameters->NumPoints = Parameters.CalibrationPointCount;
 			PassParameters->RulersMinAndMax = Parameters.CalibrationRulers;
-
-			PassParameters->bShowPoints = Parameters.bShowPoints ? 1 : 0;
-		}
+		},
+		Permutation
 	);
 }
 
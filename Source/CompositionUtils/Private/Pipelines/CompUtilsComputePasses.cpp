@@ -0,0 +1,56 @@
+#include "CompUtilsPipelines.h"
+
+#include "HAL/IConsoleManager.h"
+
+
+static TAutoConsoleVariable<int32> CVarCompUtilsComputeStages(
+	TEXT("r.CompUtils.ComputeStages"),
+	0,
+	TEXT("Bitmask of point-wise CompUtils stages that run as compute shaders instead of pixel shaders.\n")
+	TEXT(" 1: depth visualization\n")
+	TEXT(" 2: relighting\n")
+	TEXT(" 4: volumetrics composition\n")
+	TEXT(" 8: texture mapping\n")
+	TEXT("The depth processing chain is controlled by r.CompUtils.DepthAsyncCompute instead."),
+	ECVF_RenderThreadSafe);
+
+static TAutoConsoleVariable<int32> CVarCompUtilsComputeGroupSize(
+	TEXT("r.CompUtils.ComputeGroupSize"),
+	8,
+	TEXT("Width and height of thread groups of point-wise CompUtils compute passes. One of 8, 16 or 32.\n")
+	TEXT("Only takes effect when r.CompUtils.CompileAllComputeGroupSizes is set, otherwise 8 is used."),
+	ECVF_RenderThreadSafe);
+
+static TAutoConsoleVariable<int32> CVarCompUtilsCompileAllComputeGroupSizes(
+	TEXT("r.CompUtils.CompileAllComputeGroupSizes"),
+	0,
+	TEXT("Whether point-wise CompUtils compute shaders are compiled for every group size, to allow benchmarking them.\n")
+	TEXT("By default only a group size of 8 is compiled into the global shader map."),
+	ECVF_ReadOnly);
+
+static constexpr int32 DefaultComputeGroupSize = 8;
+
+
+bool CompositionUtils::UseComputeForStage(EComputeStage Stage)
+{
+	return (static_cast<uint32>(CVarCompUtilsComputeStages.GetValueOnRenderThread()) & static_cast<uint32>(Stage)) != 0;
+}
+
+uint32 CompositionUtils::GetComputeGroupSize()
+{
+	if (CVarCompUtilsCompileAllComputeGroupSizes.GetValueOnAnyThread() == 0)
+		return DefaultComputeGroupSize;
+
+	// Must be one of the sizes of FComputeGroupSizeDim
+	const int32 GroupSize = CVarCompUtilsComputeGroupSize.GetValueOnRenderThread();
+	if (GroupSize >= 32)
+		return 32;
+	if (GroupSize >= 16)
+		return 16;
+	return 8;
+}
+
+bool CompositionUtils::ShouldCompileComputeGroupSize(int32 GroupSize)
+{
+	return GroupSize == DefaultComputeGroupSize || CVarCompUtilsCompileAllComputeGroupSizes.GetValueOnAnyThread() != 0;
+}
@@ -0,0 +1,89 @@
+#include "CompUtilsCornerPrefilter.h"
+
+#include "CompUtilsPipelines.h"
+
+DECLARE_GPU_STAT_NAMED(CompUtilsCornerPrefilterStat, TEXT("CompUtilsCornerPrefilter"));
+
+
+class FCornerResponseCS : public FGlobalShader
+{
+	DECLARE_GLOBAL_SHADER(FCornerResponseCS)
+	SHADER_USE_PARAMETER_STRUCT(FCornerResponseCS, FGlobalShader)
+
+	BEGIN_SHADER_PARAMETER_STRUCT(FParameters, )
+		SHADER_PARAMETER_RDG_TEXTURE_SRV(Texture2D<float4>, InTexture)
+		SHADER_PARAMETER_RDG_BUFFER_UAV(RWBuffer<uint>, RWBounds)
+
+		SHADER_PARAMETER(FUintVector2, ViewDims)
+		SHADER_PARAMETER(uint32, SampleSpacing)
+		SHADER_PARAMETER(float, ResponseThreshold)
+		SHADER_PARAMETER(uint32, MinCandidatesPerTile)
+	END_SHADER_PARAMETER_STRUCT()
+
+	static void ModifyCompilationEnvironment(const FGlobalShaderPermutationParameters& Parameters, FShaderCompilerEnvironment& OutEnvironment)
+	{
+		FGlobalShader::ModifyCompilationEnvironment(Parameters, OutEnvironment);
+		OutEnvironment.SetDefine(TEXT("THREADGROUP_SIZE_2D"), GetThreadGroupSize2D());
+	}
+
+	static uint32 GetThreadGroupSize2D() { return 8; }
+};
+
+IMPLEMENT_GLOBAL_SHADER(FCornerResponseCS, "/Plugin/CompositionUtils/CornerPrefilter.usf", "CornerResponseCS", SF_Compute);
+
+
+FRDGBufferRef CompositionUtils::AddCornerPrefilterPasses(
+	FRDGBuilder& GraphBuilder,
+	FRDGTextureRef InTexture,
+	const FCompUtilsCornerPrefilterSettings& Settings)
+{
+	RDG_EVENT_SCOPE_STAT(GraphBuilder, CompUtilsCornerPrefilterStat, "CompUtilsCornerPrefilter");
+	SCOPED_NAMED_EVENT(CompUtilsCornerPrefilter, FColor::Purple);
+
+	FRDGBufferRef BoundsBuffer = GraphBuilder.CreateBuffer(
+		FRDGBufferDesc::CreateBufferDesc(sizeof(uint32), CornerPrefilterBoundsSize / sizeof(uint32)),
+		TEXT("CompositionUtils.CornerPrefilter.Bounds"));
+	FRDGBufferUAVRef BoundsUAV = GraphBuilder.CreateUAV(BoundsBuffer, PF_R32_UINT);
+
+	// Min is stored inverted, so clearing to 0 initializes every element
+	AddClearUAVPass(GraphBuilder, BoundsUAV, 0u);
+
+	const FIntPoint ViewDims = InTexture->Desc.Extent;
+
+	FCornerResponseCS::FParameters* PassParameters = GraphBuilder.AllocParameters<FCornerResponseCS::FParameters>();
+	PassParameters->InTexture = GraphBuilder.CreateSRV(InTexture);
+	PassParameters->RWBounds = BoundsUAV;
+	PassParameters->ViewDims = FUintVector2(ViewDims.X, ViewDims.Y);
+	PassParameters->SampleSpacing = FMath::Max(Settings.SampleSpacing, 1u);
+	PassParameters->ResponseThreshold = Settings.ResponseThreshold;
+	PassParameters->MinCandidatesPerTile = Settings.MinCandidatesPerTile;
+
+	FGlobalShaderMap* ShaderMap = GetGlobalShaderMap(GMaxRHIFeatureLevel);
+	TShaderMapRef<FCornerResponseCS> ComputeShader(ShaderMap);
+
+	FComputeShaderUtils::AddPass(
+		GraphBuilder,
+		RDG_EVENT_NAME("CompUtils.CornerPrefilter"),
+		ERDGPassFlags::Compute,
+		ComputeShader,
+		PassParameters,
+		FComputeShaderUtils::GetGroupCount(ViewDims, FCornerResponseCS::GetThreadGroupSize2D())
+	);
+
+	return BoundsBuffer;
+}
+
+bool CompositionUtils::DecodeCornerPrefilterBounds(const void* BoundsData, FIntRect& OutBounds)
+{
+	const uint32* Bounds = static_cast<const uint32*>(BoundsData);
+
+	const uint32 NumTiles = Bounds[4];
+	if (NumTiles == 0)
+	{
+		return false;
+	}
+
+	OutBounds.Min = FIntPoint(~Bounds[0], ~Bounds[1]);
+	OutBounds.Max = FIntPoint(Bounds[2], Bounds[3]);
+	return OutBounds.Width() > 0 && OutBounds.Height() > 0;
+}
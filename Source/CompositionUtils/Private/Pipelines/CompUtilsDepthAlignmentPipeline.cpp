@@ -1,6 +1,7 @@
 #include "CompUtilsPipelines.h"
 
 DECLARE_GPU_STAT_NAMED(CompUtilsDepthAlignmentStat, TEXT("CompUtilsDepthAlignment"));
+DECLARE_GPU_STAT_NAMED(CompUtilsTextureMappingStat, TEXT("CompUtilsTextureMapping"));
 
 
 class FCalculateUVMapPS : public FGlobalShader
@@ -26,6 +27,37 @@ class FCalculateUVMapPS : public FGlobalShader
 IMPLEMENT_GLOBAL_SHADER(FCalculateUVMapPS, "/Plugin/CompositionUtils/DepthAlignment.usf", "CalculateUVMapPS", SF_Pixel);
 
 
+// Used in place of FCalculateUVMapPS when alignment runs on the async compute pipe
+class FCalculateUVMapCS : public FGlobalShader
+{
+	DECLARE_GLOBAL_SHADER(FCalculateUVMapCS)
+	SHADER_USE_PARAMETER_STRUCT(FCalculateUVMapCS, FGlobalShader)
+
+	BEGIN_SHADER_PARAMETER_STRUCT(FParameters, )
+		SHADER_PARAMETER_SAMPLER(SamplerState, sampler0)
+
+		SHADER_PARAMETER_RDG_TEXTURE_SRV(Texture2D<float4>, InTex)
+		SHADER_PARAMETER_RDG_TEXTURE_UAV(RWTexture2D<float2>, OutUVMap)
+
+		SHADER_PARAMETER(FMatrix44f, SourceNDCToView)
+		SHADER_PARAMETER(FMatrix44f, SourceToDestinationNodalOffset)
+		SHADER_PARAMETER(FMatrix44f, DestinationViewToNDC)
+
+		SHADER_PARAMETER(FUintVector2, ViewDims)
+	END_SHADER_PARAMETER_STRUCT()
+
+	static void ModifyCompilationEnvironment(const FGlobalShaderPermutationParameters& Parameters, FShaderCompilerEnvironment& OutEnvironment)
+	{
+		FGlobalShader::ModifyCompilationEnvironment(Parameters, OutEnvironment);
+		OutEnvironment.SetDefine(TEXT("THREADGROUP_SIZE_2D"), GetThreadGroupSize2D());
+	}
+
+	static uint32 GetThreadGroupSize2D() { return 8; }
+};
+
+IMPLEMENT_GLOBAL_SHADER(FCalculateUVMapCS, "/Plugin/CompositionUtils/DepthAlignment.usf", "CalculateUVMapCS", SF_Compute);
+
+
 class FConvertDepthTextureToBufferCS : public FGlobalShader
 {
 	DECLARE_GLOBAL_SHADER(FConvertDepthTextureToBufferCS)
@@ -117,37 +149,71 @@ void CompositionUtils::ExecuteDepthAlignmentPipeline(
 	SCOPED_NAMED_EVENT(CompUtilsDepthAlignment, FColor::Purple);
 
 	FIntPoint Extent = InTexture->Desc.Extent;
+	FIntVector GroupCount = FComputeShaderUtils::GetGroupCount(Extent, FAlignDepthToColorCS::GetThreadGroupSize2D());
+
+	// All passes are compute when running on the async compute pipe, otherwise only the UV map is created on the graphics pipe
+	const bool bAsyncCompute = UseDepthAsyncCompute();
+	const ERDGPassFlags PassFlags = bAsyncCompute ? GetDepthComputePassFlags() : ERDGPassFlags::Compute;
 
 	FRDGTextureDesc UVMapDesc = FRDGTextureDesc::Create2D(Extent, PF_G32R32F, FClearValueBinding{ {-1, -1, -1, -1} }, TexCreate_RenderTargetable | TexCreate_ShaderResource | TexCreate_UAV);
 	FRDGTextureRef UVMap = GraphBuilder.CreateTexture(UVMapDesc, TEXT("CompUtils.DepthAlignment.UVMap"));
 
-	FRDGTextureRef AlignedDepthTexture = GraphBuilder.CreateTexture(
+	// Every texel is written by ConvertBufferToDepthTexture, so no clear is needed
+	// Write directly into the output if possible, which is the case for intermediates of a pass chain
+	const bool bOutputSupportsUAV = EnumHasAnyFlags(OutTexture->Desc.Flags, TexCreate_UAV) && OutTexture->Desc.Extent == Extent;
+	FRDGTextureRef AlignedDepthTexture = bOutputSupportsUAV ? OutTexture : GraphBuilder.CreateTexture(
 		FRDGTextureDesc::Create2D(Extent, PF_FloatRGBA, FClearValueBinding::Black, TexCreate_ShaderResource | TexCreate_UAV),
 		TEXT("CompUtils.DepthAlignment.AlignedDepth")
 	);
-	AddClearUAVPass(GraphBuilder, GraphBuilder.CreateUAV(AlignedDepthTexture), 0.0f);
 
 	uint32 BufferWidth = Extent.X * Extent.Y;
 	FRDGBufferRef BufferA = CreateStructuredBuffer(GraphBuilder, TEXT("CompUtils.DepthAlignment.BufferA"), sizeof(uint64), BufferWidth, nullptr, 0);
 	FRDGBufferRef BufferB = CreateStructuredBuffer(GraphBuilder, TEXT("CompUtils.DepthAlignment.BufferB"), sizeof(uint64), BufferWidth, nullptr, 0);
 
 	// Create UV map
-	CompositionUtils::AddPass<FCalculateUVMapPS>(
-		GraphBuilder,
-		RDG_EVENT_NAME("CompUtils.CalculateUVMap"),
-		UVMap,
-		[&](auto PassParameters)
-		{
-			PassParameters->InTex = GraphBuilder.CreateSRV(InTexture);
+	if (bAsyncCompute)
+	{
+		FCalculateUVMapCS::FParameters* PassParameters = GraphBuilder.AllocParameters<FCalculateUVMapCS::FParameters>();
+		PassParameters->sampler0 = TStaticSamplerState<SF_Bilinear>::GetRHI();
+		PassParameters->InTex = GraphBuilder.CreateSRV(InTexture);
+		PassParameters->OutUVMap = GraphBuilder.CreateUAV(UVMap);
 
-			PassParameters->SourceNDCToView = Parameters.SourceCamera.NDCToView;
-			PassParameters->SourceToDestinationNodalOffset = Parameters.SourceToDestinationNodalOffset;
-			PassParameters->DestinationViewToNDC = Parameters.DestinationCamera.ViewToNDC;
-		}
-	);
+		PassParameters->SourceNDCToView = Parameters.SourceCamera.NDCToView;
+		PassParameters->SourceToDestinationNodalOffset = Parameters.SourceToDestinationNodalOffset;
+		PassParameters->DestinationViewToNDC = Parameters.DestinationCamera.ViewToNDC;
+
+		PassParameters->ViewDims = FUintVector2(Extent.X, Extent.Y);
+
+		FGlobalShaderMap* ShaderMap = GetGlobalShaderMap(GMaxRHIFeatureLevel);
+		TShaderMapRef<FCalculateUVMapCS> ComputeShader(ShaderMap);
+
+		FComputeShaderUtils::AddPass(
+			GraphBuilder,
+			RDG_EVENT_NAME("CompUtils.CalculateUVMap"),
+			PassFlags,
+			ComputeShader,
+			PassParameters,
+			GroupCount
+		);
+	}
+	else
+	{
+		CompositionUtils::AddPass<FCalculateUVMapPS>(
+			GraphBuilder,
+			RDG_EVENT_NAME("CompUtils.CalculateUVMap"),
+			UVMap,
+			[&](auto PassParameters)
+			{
+				PassParameters->InTex = GraphBuilder.CreateSRV(InTexture);
+
+				PassParameters->SourceNDCToView = Parameters.SourceCamera.NDCToView;
+				PassParameters->SourceToDestinationNodalOffset = Parameters.SourceToDestinationNodalOffset;
+				PassParameters->DestinationViewToNDC = Parameters.DestinationCamera.ViewToNDC;
+			}
+		);
+	}
 
 	// Create aligned depth
-	FIntVector GroupCount = FComputeShaderUtils::GetGroupCount(Extent, FAlignDepthToColorCS::GetThreadGroupSize2D());
 	{
 		FConvertDepthTextureToBufferCS::FParameters* PassParameters = GraphBuilder.AllocParameters<FConvertDepthTextureToBufferCS::FParameters>();
 		PassParameters->InDepthTexture = GraphBuilder.CreateSRV(InTexture);
@@ -161,7 +227,7 @@ void CompositionUtils::ExecuteDepthAlignmentPipeline(
 		FComputeShaderUtils::AddPass(
 			GraphBuilder,
 			RDG_EVENT_NAME("CompUtils.ConvertDepthTextureToBuffer"),
-			ERDGPassFlags::Compute,
+			PassFlags,
 			ComputeShader,
 			PassParameters,
 			GroupCount
@@ -197,7 +263,7 @@ void CompositionUtils::ExecuteDepthAlignmentPipeline(
 		FComputeShaderUtils::AddPass(
 			GraphBuilder,
 			RDG_EVENT_NAME("CompUtils.AlignDepthToColor"),
-			ERDGPassFlags::Compute,
+			PassFlags,
 			ComputeShader,
 			PassParameters,
 			GroupCount
@@ -215,7 +281,7 @@ void CompositionUtils::ExecuteDepthAlignmentPipeline(
 		FComputeShaderUtils::AddPass(
 			GraphBuilder,
 			RDG_EVENT_NAME("CompUtils.ConvertBufferToDepthTexture"),
-			ERDGPassFlags::Compute,
+			PassFlags,
 			ComputeShader,
 			PassParameters,
 			GroupCount
@@ -223,7 +289,10 @@ void CompositionUtils::ExecuteDepthAlignmentPipeline(
 	}
 
 	// Copy into output
-	AddCopyTexturePass(GraphBuilder, AlignedDepthTexture, OutTexture);
+	if (!bOutputSupportsUAV)
+	{
+		AddCopyTexturePass(GraphBuilder, AlignedDepthTexture, OutTexture);
+	}
 }
 
 
@@ -248,6 +317,32 @@ class FTextureMappingPS : public FGlobalShader
 
 IMPLEMENT_GLOBAL_SHADER(FTextureMappingPS, "/Plugin/CompositionUtils/DepthAlignment.usf", "TextureMappingPS", SF_Pixel);
 
+
+class FTextureMappingCS : public FGlobalShader
+{
+	DECLARE_GLOBAL_SHADER(FTextureMappingCS)
+	SHADER_USE_PARAMETER_STRUCT(FTextureMappingCS, FGlobalShader)
+
+	using FPermutationDomain = TShaderPermutationDomain<CompositionUtils::FComputeGroupSizeDim>;
+
+	static bool ShouldCompilePermutation(const FGlobalShaderPermutationParameters& Parameters)
+	{
+		return CompositionUtils::ShouldCompileComputePermutation<FTextureMappingCS>(Parameters);
+	}
+
+	BEGIN_SHADER_PARAMETER_STRUCT(FParameters, )
+		SHADER_PARAMETER_SAMPLER(SamplerState, sampler0)
+
+		SHADER_PARAMETER_RDG_TEXTURE_SRV(Texture2D<float4>, InTextureToMap)
+		SHADER_PARAMETER_RDG_TEXTURE_SRV(Texture2D<float4>, InAlignedDepth)
+		SHADER_PARAMETER_RDG_TEXTURE_UAV(RWTexture2D<float4>, OutTex)
+
+		SHADER_PARAMETER(FUintVector2, ViewDims)
+	END_SHADER_PARAMETER_STRUCT()
+};
+
+IMPLEMENT_GLOBAL_SHADER(FTextureMappingCS, "/Plugin/CompositionUtils/DepthAlignment.usf", "TextureMappingCS", SF_Compute);
+
 void CompositionUtils::ExecuteTextureMappingPipeline(
 	FRDGBuilder& GraphBuilder,
 	FRDGTextureRef InTextureToMap,
@@ -256,6 +351,25 @@ void CompositionUtils::ExecuteTextureMappingPipeline(
 {
 	check(IsInRenderingThread());
 
+	RDG_EVENT_SCOPE_STAT(GraphBuilder, CompUtilsTextureMappingStat, "CompUtilsTextureMapping");
+	RDG_GPU_STAT_SCOPE(GraphBuilder, CompUtilsTextureMappingStat);
+	SCOPED_NAMED_EVENT(CompUtilsTextureMapping, FColor::Purple);
+
+	if (UseComputeForStage(EComputeStage::TextureMapping))
+	{
+		CompositionUtils::AddComputePass<FTextureMappingCS>(
+			GraphBuilder,
+			RDG_EVENT_NAME("CompUtils.TextureMapping"),
+			OutTexture,
+			[&](auto PassParameters)
+			{
+				PassParameters->InTextureToMap = GraphBuilder.CreateSRV(InTextureToMap);
+				PassParameters->InAlignedDepth = GraphBuilder.CreateSRV(InAlignedDepth);
+			}
+		);
+		return;
+	}
+
 	// Create UV map
 	CompositionUtils::AddPass<FTextureMappingPS>(
 		GraphBuilder,
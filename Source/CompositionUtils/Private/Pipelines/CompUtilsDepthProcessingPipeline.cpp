@@ -1,6 +1,7 @@
 #include "CompUtilsPipelines.h"
 
 DECLARE_GPU_STAT_NAMED(CompUtilsDepthProcessingStat, TEXT("CompUtilsDepthProcessing"));
+DECLARE_GPU_STAT_NAMED(CompUtilsVisualizeDepthStat, TEXT("CompUtilsVisualizeDepth"));
 
 
 class FPreProcessDepthPS : public FGlobalShader
@@ -79,21 +80,30 @@ class FJacobiStepPS : public FGlobalShader
 IMPLEMENT_GLOBAL_SHADER(FJacobiStepPS, "/Plugin/CompositionUtils/DepthProcessing.usf", "JacobiStepPS", SF_Pixel);
 
 
+// Clipping toggles are compiled into the depth clipping shaders rather than branched on
+class FEnableFarClipping : SHADER_PERMUTATION_BOOL("ENABLE_FAR_CLIPPING");
+class FEnableClippingPlane : SHADER_PERMUTATION_BOOL("ENABLE_CLIPPING_PLANE");
+
 // Post-processing on reconstructed depth, including clipping against specified planes
 class FDepthClippingPS : public FGlobalShader
 {
 	DECLARE_GLOBAL_SHADER(FDepthClippingPS)
 	SHADER_USE_PARAMETER_STRUCT(FDepthClippingPS, FGlobalShader)
 
+	using FPermutationDomain = TShaderPermutationDomain<FEnableFarClipping, FEnableClippingPlane>;
+
+	static bool ShouldCompilePermutation(const FGlobalShaderPermutationParameters& Parameters)
+	{
+		return CompositionUtils::ShouldCompileShader(Parameters);
+	}
+
 	BEGIN_SHADER_PARAMETER_STRUCT(FParameters, )
 		SHADER_PARAMETER_STRUCT(FScreenPassTextureViewportParameters, OutViewPort)
 		SHADER_PARAMETER_STRUCT(FScreenPassTextureViewportParameters, InViewPort)
 		SHADER_PARAMETER_SAMPLER(SamplerState, sampler0)
 
 		SHADER_PARAMETER(FMatrix44f, SourceNDCToView)
-		SHADER_PARAMETER(int32, bEnableFarClipping)
 		SHADER_PARAMETER(float, FarClipDistance)
-		SHADER_PARAMETER(int32, bEnableClippingPlane)
 		SHADER_PARAMETER(FVector4f, UserClippingPlane)
 
 		SHADER_PARAMETER_RDG_TEXTURE_SRV(Texture2D<float4>, InTex)
@@ -105,6 +115,86 @@ class FDepthClippingPS : public FGlobalShader
 IMPLEMENT_GLOBAL_SHADER(FDepthClippingPS, "/Plugin/CompositionUtils/DepthProcessing.usf", "DepthClipPS", SF_Pixel);
 
 
+// Compute shader variants of the depth processing chain, used on the async compute pipe
+class FPreProcessDepthCS : public FGlobalShader
+{
+	DECLARE_GLOBAL_SHADER(FPreProcessDepthCS)
+	SHADER_USE_PARAMETER_STRUCT(FPreProcessDepthCS, FGlobalShader)
+
+	using FPermutationDomain = TShaderPermutationDomain<CompositionUtils::FComputeGroupSizeDim>;
+
+	static bool ShouldCompilePermutation(const FGlobalShaderPermutationParameters& Parameters)
+	{
+		return CompositionUtils::ShouldCompileComputePermutation<FPreProcessDepthCS>(Parameters);
+	}
+
+	BEGIN_SHADER_PARAMETER_STRUCT(FParameters, )
+		SHADER_PARAMETER_SAMPLER(SamplerState, sampler0)
+
+		SHADER_PARAMETER_RDG_TEXTURE_SRV(Texture2D<float4>, InTex)
+		SHADER_PARAMETER_RDG_TEXTURE_UAV(RWTexture2D<float4>, OutTex)
+
+		SHADER_PARAMETER(FUintVector2, ViewDims)
+	END_SHADER_PARAMETER_STRUCT()
+};
+
+IMPLEMENT_GLOBAL_SHADER(FPreProcessDepthCS, "/Plugin/CompositionUtils/DepthProcessing.usf", "PreProcessDepthCS", SF_Compute);
+
+
+class FJacobiStepCS : public FGlobalShader
+{
+	DECLARE_GLOBAL_SHADER(FJacobiStepCS)
+	SHADER_USE_PARAMETER_STRUCT(FJacobiStepCS, FGlobalShader)
+
+	using FPermutationDomain = TShaderPermutationDomain<CompositionUtils::FComputeGroupSizeDim>;
+
+	static bool ShouldCompilePermutation(const FGlobalShaderPermutationParameters& Parameters)
+	{
+		return CompositionUtils::ShouldCompileComputePermutation<FJacobiStepCS>(Parameters);
+	}
+
+	BEGIN_SHADER_PARAMETER_STRUCT(FParameters, )
+		SHADER_PARAMETER_SAMPLER(SamplerState, sampler0)
+
+		SHADER_PARAMETER_RDG_TEXTURE_SRV(Texture2D<float4>, InTex)
+		SHADER_PARAMETER_RDG_TEXTURE_UAV(RWTexture2D<float4>, OutTex)
+
+		SHADER_PARAMETER(FUintVector2, ViewDims)
+	END_SHADER_PARAMETER_STRUCT()
+};
+
+IMPLEMENT_GLOBAL_SHADER(FJacobiStepCS, "/Plugin/CompositionUtils/DepthProcessing.usf", "JacobiStepCS", SF_Compute);
+
+
+class FDepthClippingCS : public FGlobalShader
+{
+	DECLARE_GLOBAL_SHADER(FDepthClippingCS)
+	SHADER_USE_PARAMETER_STRUCT(FDepthClippingCS, FGlobalShader)
+
+	using FPermutationDomain = TShaderPermutationDomain<CompositionUtils::FComputeGroupSizeDim, FEnableFarClipping, FEnableClippingPlane>;
+
+	static bool ShouldCompilePermutation(const FGlobalShaderPermutationParameters& Parameters)
+	{
+		return CompositionUtils::ShouldCompileComputePermutation<FDepthClippingCS>(Parameters);
+	}
+
+	BEGIN_SHADER_PARAMETER_STRUCT(FParameters, )
+		SHADER_PARAMETER_SAMPLER(SamplerState, sampler0)
+
+		SHADER_PARAMETER(FMatrix44f, SourceNDCToView)
+		SHADER_PARAMETER(float, FarClipDistance)
+		SHADER_PARAMETER(FVector4f, UserClippingPlane)
+
+		SHADER_PARAMETER_RDG_TEXTURE_SRV(Texture2D<float4>, InTex)
+		SHADER_PARAMETER_RDG_TEXTURE_UAV(RWTexture2D<float4>, OutTex)
+
+		SHADER_PARAMETER(FUintVector2, ViewDims)
+	END_SHADER_PARAMETER_STRUCT()
+};
+
+IMPLEMENT_GLOBAL_SHADER(FDepthClippingCS, "/Plugin/CompositionUtils/DepthProcessing.usf", "DepthClipCS", SF_Compute);
+
+
 class FVisualizeDepthPS : public FGlobalShader
 {
 	DECLARE_GLOBAL_SHADER(FVisualizeDepthPS)
@@ -126,6 +216,114 @@ class FVisualizeDepthPS : public FGlobalShader
 IMPLEMENT_GLOBAL_SHADER(FVisualizeDepthPS, "/Plugin/CompositionUtils/DepthProcessing.usf", "VisualizeDepthPS", SF_Pixel);
 
 
+class FVisualizeDepthCS : public FGlobalShader
+{
+	DECLARE_GLOBAL_SHADER(FVisualizeDepthCS)
+	SHADER_USE_PARAMETER_STRUCT(FVisualizeDepthCS, FGlobalShader)
+
+	using FPermutationDomain = TShaderPermutationDomain<CompositionUtils::FComputeGroupSizeDim>;
+
+	static bool ShouldCompilePermutation(const FGlobalShaderPermutationParameters& Parameters)
+	{
+		return CompositionUtils::ShouldCompileComputePermutation<FVisualizeDepthCS>(Parameters);
+	}
+
+	BEGIN_SHADER_PARAMETER_STRUCT(FParameters, )
+		SHADER_PARAMETER_SAMPLER(SamplerState, sampler0)
+
+		SHADER_PARAMETER(FVector2f, DepthRange)
+
+		SHADER_PARAMETER_RDG_TEXTURE_SRV(Texture2D<float4>, InTex)
+		SHADER_PARAMETER_RDG_TEXTURE_UAV(RWTexture2D<float4>, OutTex)
+
+		SHADER_PARAMETER(FUintVector2, ViewDims)
+	END_SHADER_PARAMETER_STRUCT()
+};
+
+IMPLEMENT_GLOBAL_SHADER(FVisualizeDepthCS, "/Plugin/CompositionUtils/DepthProcessing.usf", "VisualizeDepthCS", SF_Compute);
+
+
+// Same chain as the pixel shader version of the pipeline, recorded as compute passes so it can overlap with graphics work
+static void AddDepthProcessingComputePasses(
+	FRDGBuilder& GraphBuilder,
+	const FDepthProcessingParametersProxy& Parameters,
+	FRDGTextureRef InTexture,
+	FRDGTextureRef OutTexture
+)
+{
+	const ERDGPassFlags PassFlags = CompositionUtils::GetDepthComputePassFlags();
+
+	const FRDGTextureDesc TempDesc = FRDGTextureDesc::Create2D(OutTexture->Desc.Extent, PF_FloatRGBA, FClearValueBinding::Black, TexCreate_ShaderResource | TexCreate_UAV);
+	FRDGTextureRef TempTexture1 = GraphBuilder.CreateTexture(TempDesc, TEXT("CompositionUtilsDepthProcessing.Temp1"));
+	FRDGTextureRef TempTexture2 = GraphBuilder.CreateTexture(TempDesc, TEXT("CompositionUtilsDepthProcessing.Temp2"));
+
+	CompositionUtils::AddComputePass<FPreProcessDepthCS>(
+		GraphBuilder,
+		RDG_EVENT_NAME("PreProcessDepth"),
+		TempTexture1,
+		[&](auto PassParameters)
+		{
+			PassParameters->InTex = GraphBuilder.CreateSRV(InTexture);
+		},
+		{},
+		PassFlags
+	);
+
+	if (Parameters.bEnableJacobiSteps)
+	{
+		for (uint32 i = 0; i < Parameters.NumJacobiSteps; i++)
+		{
+			CompositionUtils::AddComputePass<FJacobiStepCS, TStaticSamplerState<>>(
+				GraphBuilder,
+				RDG_EVENT_NAME("JacobiStep(i=%d)", 2 * i),
+				TempTexture2,
+				[&](auto PassParameters)
+				{
+					PassParameters->InTex = GraphBuilder.CreateSRV(TempTexture1);
+				},
+				{},
+				PassFlags
+			);
+
+			CompositionUtils::AddComputePass<FJacobiStepCS, TStaticSamplerState<>>(
+				GraphBuilder,
+				RDG_EVENT_NAME("JacobiStep(i=%d)", 2 * i + 1),
+				TempTexture1,
+				[&](auto PassParameters)
+				{
+					PassParameters->InTex = GraphBuilder.CreateSRV(TempTexture2);
+				},
+				{},
+				PassFlags
+			);
+		}
+	}
+
+	// Post Processing
+	// Written directly into the output if possible, which is the case for intermediates of a pass chain
+	FDepthClippingCS::FPermutationDomain ClippingPermutation;
+	ClippingPermutation.Set<FEnableFarClipping>(Parameters.bEnableFarClipping);
+	ClippingPermutation.Set<FEnableClippingPlane>(Parameters.bEnableClippingPlane);
+
+	CompositionUtils::AddComputePass<FDepthClippingCS, TStaticSamplerState<>>(
+		GraphBuilder,
+		RDG_EVENT_NAME("DepthClipping"),
+		OutTexture,
+		[&](auto PassParameters)
+		{
+			PassParameters->SourceNDCToView = Parameters.SourceCamera.NDCToView;
+
+			PassParameters->FarClipDistance = Parameters.FarClipDistance;
+			PassParameters->UserClippingPlane = Parameters.UserClippingPlane;
+
+			PassParameters->InTex = GraphBuilder.CreateSRV(TempTexture1);
+		},
+		ClippingPermutation,
+		PassFlags
+	);
+}
+
+
 void CompositionUtils::ExecuteDepthProcessingPipeline(
 	FRDGBuilder& GraphBuilder,
 	const FDepthProcessingParametersProxy& Parameters,
@@ -140,6 +338,12 @@ void CompositionUtils::ExecuteDepthProcessingPipeline(
 	RDG_GPU_STAT_SCOPE(GraphBuilder, CompUtilsDepthProcessingStat);
 	SCOPED_NAMED_EVENT(CompUtilsDepthProcessing, FColor::Purple);
 
+	if (UseDepthAsyncCompute())
+	{
+		AddDepthProcessingComputePasses(GraphBuilder, Parameters, InTexture, OutTexture);
+		return;
+	}
+
 	FRDGTextureRef TempTexture1 = CreateTextureFrom(GraphBuilder, OutTexture, TEXT("CompositionUtilsDepthProcessing.Temp1"));
 	FRDGTextureRef TempTexture2 = CreateTextureFrom(GraphBuilder, OutTexture, TEXT("CompositionUtilsDepthProcessing.Temp2"));
 
@@ -180,6 +384,10 @@ void CompositionUtils::ExecuteDepthProcessingPipeline(
 	}
 
 	// Post Processing
+	FDepthClippingPS::FPermutationDomain ClippingPermutation;
+	ClippingPermutation.Set<FEnableFarClipping>(Parameters.bEnableFarClipping);
+	ClippingPermutation.Set<FEnableClippingPlane>(Parameters.bEnableClippingPlane);
+
 	CompositionUtils::AddPass<FDepthClippingPS, TStaticSamplerState<>>(
 		GraphBuilder,
 		RDG_EVENT_NAME("DepthClipping"),
@@ -188,13 +396,12 @@ void CompositionUtils::ExecuteDepthProcessingPipeline(
 		{
 			PassParameters->SourceNDCToView = Parameters.SourceCamera.NDCToView;
 
-			PassParameters->bEnableFarClipping = Parameters.bEnableFarClipping;
 			PassParameters->FarClipDistance = Parameters.FarClipDistance;
-			PassParameters->bEnableClippingPlane = Parameters.bEnableClippingPlane;
 			PassParameters->UserClippingPlane = Parameters.UserClippingPlane;
 
 			PassParameters->InTex = GraphBuilder.CreateSRV(TempTexture1);
-		}
+		},
+		ClippingPermutation
 	);
 }
 
@@ -203,6 +410,26 @@ void CompositionUtils::VisualizeProcessedDepth(FRDGBuilder& GraphBuilder, FVecto
 {
 	check(IsInRenderingThread());
 
+	RDG_EVENT_SCOPE_STAT(GraphBuilder, CompUtilsVisualizeDepthStat, "CompUtilsVisualizeDepth");
+	RDG_GPU_STAT_SCOPE(GraphBuilder, CompUtilsVisualizeDepthStat);
+	SCOPED_NAMED_EVENT(CompUtilsVisualizeDepth, FColor::Purple);
+
+	if (UseComputeForStage(EComputeStage::VisualizeDepth))
+	{
+		CompositionUtils::AddComputePass<FVisualizeDepthCS>(
+			GraphBuilder,
+			RDG_EVENT_NAME("VisualizeDepth"),
+			OutTexture,
+			[&](auto PassParameters)
+			{
+				PassParameters->DepthRange = VisualizeRange;
+
+				PassParameters->InTex = GraphBuilder.CreateSRV(ProcessedDepthTexture);
+			}
+		);
+		return;
+	}
+
 	CompositionUtils::AddPass<FVisualizeDepthPS>(
 		GraphBuilder,
 		RDG_EVENT_NAME("VisualizeDepth"),
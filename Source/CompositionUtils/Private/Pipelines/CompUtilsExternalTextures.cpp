@@ -0,0 +1,72 @@
+#include "CompUtilsPipelines.h"
+
+#include "RenderGraphUtils.h"
+
+
+// Pooled render target wrappers of external textures, reused across frames rather than created for every graph
+// Each wrapper holds a reference to its texture, so entries are dropped once they haven't been used for a while
+// In steady state the map doesn't allocate: wrappers are only created the first time a texture is seen,
+// and entries removed by pruning leave free slots that later textures reuse
+class FCompUtilsExternalTextureCache : public FRenderResource
+{
+public:
+	TRefCountPtr<IPooledRenderTarget> FindOrCreate(FRHITexture* Texture, const TCHAR* Name)
+	{
+		check(IsInRenderingThread());
+
+		const uint64 Frame = GFrameCounterRenderThread;
+		if (Frame != LastPruneFrame)
+		{
+			Prune(Frame);
+		}
+
+		FCachedTexture& Cached = CachedTextures.FindOrAdd(Texture);
+		if (!Cached.RenderTarget.IsValid())
+		{
+			Cached.RenderTarget = CreateRenderTarget(Texture, Name);
+		}
+		Cached.LastUsedFrame = Frame;
+
+		return Cached.RenderTarget;
+	}
+
+	//~ Begin FRenderResource interface
+	virtual void ReleaseRHI() override
+	{
+		CachedTextures.Empty();
+	}
+	//~ End FRenderResource interface
+
+private:
+	void Prune(uint64 Frame)
+	{
+		for (auto It = CachedTextures.CreateIterator(); It; ++It)
+		{
+			if (Frame - It.Value().LastUsedFrame > MaxUnusedFrames)
+			{
+				It.RemoveCurrent();
+			}
+		}
+
+		LastPruneFrame = Frame;
+	}
+
+	struct FCachedTexture
+	{
+		TRefCountPtr<IPooledRenderTarget> RenderTarget;
+		uint64 LastUsedFrame = 0;
+	};
+
+	static constexpr uint64 MaxUnusedFrames = 30;
+
+	TMap<FRHITexture*, FCachedTexture> CachedTextures;
+	uint64 LastPruneFrame = 0;
+};
+
+static TGlobalResource<FCompUtilsExternalTextureCache> GCompUtilsExternalTextureCache;
+
+
+TRefCountPtr<IPooledRenderTarget> CompositionUtils::GetExternalRenderTarget(FRHITexture* Texture, const TCHAR* Name)
+{
+	return GCompUtilsExternalTextureCache.FindOrCreate(Texture, Name);
+}
@@ -1,5 +1,7 @@
 #include "CompUtilsPipelines.h"
 
+DECLARE_GPU_STAT_NAMED(CompUtilsVisualizeNormalMapStat, TEXT("CompUtilsVisualizeNormalMap"));
+
 
 class FVisualizeNormalMapPS : public FGlobalShader
 {
@@ -9,6 +11,11 @@ class FVisualizeNormalMapPS : public FGlobalShader
 	class FTransformToWorldSpace : SHADER_PERMUTATION_BOOL("VIEW_WORLD_SPACE");
 	using FPermutationDomain = TShaderPermutationDomain<FTransformToWorldSpace>;
 
+	static bool ShouldCompilePermutation(const FGlobalShaderPermutationParameters& Parameters)
+	{
+		return CompositionUtils::ShouldCompileShader(Parameters);
+	}
+
 	BEGIN_SHADER_PARAMETER_STRUCT(FParameters, )
 		SHADER_PARAMETER_STRUCT(FScreenPassTextureViewportParameters, OutViewPort)
 		SHADER_PARAMETER_STRUCT(FScreenPassTextureViewportParameters, InViewPort)
@@ -35,6 +42,10 @@ void CompositionUtils::VisualizeNormalMap(
 {
 	check(IsInRenderingThread());
 
+	RDG_EVENT_SCOPE_STAT(GraphBuilder, CompUtilsVisualizeNormalMapStat, "CompUtilsVisualizeNormalMap");
+	RDG_GPU_STAT_SCOPE(GraphBuilder, CompUtilsVisualizeNormalMapStat);
+	SCOPED_NAMED_EVENT(CompUtilsVisualizeNormalMap, FColor::Purple);
+
 	FVisualizeNormalMapPS::FPermutationDomain Permutation;
 	Permutation.Set<FVisualizeNormalMapPS::FTransformToWorldSpace>(bWorldSpace);
 
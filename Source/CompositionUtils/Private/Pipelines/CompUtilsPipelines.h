@@ -1,10 +1,13 @@
 #pragma once
 
 #include "ScreenPass.h"
-#include <functional>
+#include "RenderGraphUtils.h"
+#include "ShaderPermutation.h"
 
 #include "CompUtilsCameraData.h"
 
+#include <atomic>
+
 
 struct FDepthProcessingParametersProxy
 {
@@ -58,6 +61,9 @@ struct FVolumetricFogRequiredDataProxy
 	FVector2f VolumetricFogUVMax;
 	float OneOverPreExposure;
 
+	// Frame of the scene capture that the fog was extracted from, see GFrameCounterRenderThread
+	uint64 FrameNumber = 0;
+
 	bool IsValid() const
 	{
 		bool bValid = true;
@@ -66,18 +72,47 @@ struct FVolumetricFogRequiredDataProxy
 	}
 };
 
+// Fog extracted by the two most recent frames of a scene capture
+// Composition can read the fog of one frame while the capture of the next frame is extracted into the other slot
+// Only accessed on the render thread, apart from HasData
+class FVolumetricFogRequiredDataBuffer
+{
+public:
+	// Returns the slot to extract the fog of the current frame into, which is published by PublishExtraction
+	FVolumetricFogRequiredDataProxy& BeginExtraction();
+	void PublishExtraction();
+
+	// Returns the fog extracted in FrameNumber, or the most recent fog before it
+	// bOutStale is set if the fog comes from another frame, e.g. because the capture hasn't rendered this frame
+	// Returns nullptr if no fog has been extracted yet
+	const FVolumetricFogRequiredDataProxy* Find(uint64 FrameNumber, bool& bOutStale) const;
+
+	// Whether any fog has been published yet, may be called from any thread
+	bool HasData() const { return bHasData.load(std::memory_order_acquire); }
+
+private:
+	FVolumetricFogRequiredDataProxy Slots[2];
+	bool bPublished[2] = { false, false };
+	int32 WriteIndex = 0;
+	int32 PublishedIndex = INDEX_NONE;
+
+	std::atomic<bool> bHasData = false;
+};
+
 struct FVolumetricsCompositionParametersProxy
 {
 	UTexture* CameraDepthTexture;
 
-	const FVolumetricFogRequiredDataProxy* VolumetricFogData;
+	TSharedPtr<const FVolumetricFogRequiredDataBuffer, ESPMode::ThreadSafe> VolumetricFogData;
+
+	// Frame that the composition is prepared in, the fog extracted by the capture of the same frame is preferred
+	uint64 FrameNumber = 0;
 
 	bool IsValid() const
 	{
 		bool bValid = true;
 		bValid &= CameraDepthTexture != nullptr;
-		bValid &= VolumetricFogData != nullptr;
-		bValid &= VolumetricFogData->IsValid();
+		bValid &= VolumetricFogData.IsValid() && VolumetricFogData->HasData();
 		return bValid;
 	}
 };
@@ -202,13 +237,14 @@ namespace CompositionUtils
 		return GraphBuilder.CreateTexture(Desc, Name);
 	}
 
-	template <typename Shader, typename SamplerState = TStaticSamplerState<SF_Bilinear>>
+	// SetPassParametersLambda is called with the Shader::FParameters of the pass
+	template <typename Shader, typename SamplerState = TStaticSamplerState<SF_Bilinear>, typename SetPassParametersFunc>
 	void AddPass(
 		FRDGBuilder& GraphBuilder,
 		FRDGEventName&& PassName,
 		FRDGTextureRef RenderTarget,
-		std::function<void(typename Shader::FParameters*)>&& SetPassParametersLambda,
-		typename Shader::FPermutationDomain Permutation = TShaderPermutationDomain(),
+		SetPassParametersFunc&& SetPassParametersLambda,
+		typename Shader::FPermutationDomain Permutation = typename Shader::FPermutationDomain(),
 		FIntRect OutRect = FIntRect(),
 		FIntRect InRect = FIntRect()
 	)
@@ -243,8 +279,119 @@ namespace CompositionUtils
 	}
 
 
+	// Compute passes
+
+	// Group sizes that point-wise compute shaders are compiled for, see AddComputePass
+	class FComputeGroupSizeDim : SHADER_PERMUTATION_SPARSE_INT("THREADGROUP_SIZE_2D", 8, 16, 32);
+
+	// Point-wise stages that have both a pixel and a compute shader version
+	enum class EComputeStage : uint32
+	{
+		VisualizeDepth	= 1 << 0,
+		Relighting		= 1 << 1,
+		Volumetrics		= 1 << 2,
+		TextureMapping	= 1 << 3,
+	};
+
+	// Whether a stage should use its compute shader version, see r.CompUtils.ComputeStages
+	// Defined in CompUtilsComputePasses.cpp
+	bool UseComputeForStage(EComputeStage Stage);
+
+	// Group size of point-wise compute passes, see r.CompUtils.ComputeGroupSize
+	uint32 GetComputeGroupSize();
+
+	// Whether shaders should be compiled for a group size of FComputeGroupSizeDim, see r.CompUtils.CompileAllComputeGroupSizes
+	bool ShouldCompileComputeGroupSize(int32 GroupSize);
+
+
+	// Permutation culling policy of CompUtils global shaders
+
+	// CompUtils passes only run on SM5 capable platforms
+	inline bool ShouldCompileShader(const FGlobalShaderPermutationParameters& Parameters)
+	{
+		return IsFeatureLevelSupported(Parameters.Platform, ERHIFeatureLevel::SM5);
+	}
+
+	// Additionally culls group sizes that can never be selected at runtime
+	template <typename Shader>
+	bool ShouldCompileComputePermutation(const FGlobalShaderPermutationParameters& Parameters)
+	{
+		if (!ShouldCompileShader(Parameters))
+			return false;
+
+		typename Shader::FPermutationDomain PermutationVector(Parameters.PermutationId);
+		return ShouldCompileComputeGroupSize(PermutationVector.template Get<FComputeGroupSizeDim>());
+	}
+
+	// Compute counterpart of AddPass, for point-wise stages
+	// Shader must bind sampler0, ViewDims and an OutTex UAV, and have FComputeGroupSizeDim in its permutation domain
+	// Outputs that can't be written as a UAV are written through a temporary texture and copied
+	template <typename Shader, typename SamplerState = TStaticSamplerState<SF_Bilinear>, typename SetPassParametersFunc>
+	void AddComputePass(
+		FRDGBuilder& GraphBuilder,
+		FRDGEventName&& PassName,
+		FRDGTextureRef OutTexture,
+		SetPassParametersFunc&& SetPassParametersLambda,
+		typename Shader::FPermutationDomain Permutation = typename Shader::FPermutationDomain(),
+		ERDGPassFlags PassFlags = ERDGPassFlags::Compute,
+		uint32 GroupSize = GetComputeGroupSize()
+	)
+	{
+		const FIntPoint Extent = OutTexture->Desc.Extent;
+
+		FRDGTextureRef Target = OutTexture;
+		if (!EnumHasAnyFlags(OutTexture->Desc.Flags, TexCreate_UAV))
+		{
+			Target = GraphBuilder.CreateTexture(
+				FRDGTextureDesc::Create2D(Extent, OutTexture->Desc.Format, FClearValueBinding::Black, TexCreate_ShaderResource | TexCreate_UAV),
+				TEXT("CompositionUtils.ComputePassOutput"));
+		}
+
+		typename Shader::FParameters* PassParameters = GraphBuilder.AllocParameters<typename Shader::FParameters>();
+		PassParameters->sampler0 = SamplerState::GetRHI();
+		PassParameters->ViewDims = FUintVector2(Extent.X, Extent.Y);
+		PassParameters->OutTex = GraphBuilder.CreateUAV(Target);
+
+		SetPassParametersLambda(PassParameters);
+
+		Permutation.template Set<FComputeGroupSizeDim>(GroupSize);
+
+		const FGlobalShaderMap* ShaderMap = GetGlobalShaderMap(GMaxRHIFeatureLevel);
+		TShaderMapRef<Shader> ComputeShader(ShaderMap, Permutation);
+
+		FComputeShaderUtils::AddPass(
+			GraphBuilder,
+			std::move(PassName),
+			PassFlags,
+			ComputeShader,
+			PassParameters,
+			FComputeShaderUtils::GetGroupCount(Extent, GroupSize)
+		);
+
+		if (Target != OutTexture)
+		{
+			AddCopyTexturePass(GraphBuilder, Target, OutTexture);
+		}
+	}
+
+
+	// Async compute
+
+	// Whether depth processing and alignment should be recorded as compute passes, so that they can run on the async compute pipe
+	// Controlled by r.CompUtils.DepthAsyncCompute, defined in CompUtilsAsyncCompute.cpp
+	bool UseDepthAsyncCompute();
+
+	// Pass flags for compute passes of the depth chain
+	// Falls back to the graphics pipe on RHIs without efficient async compute
+	ERDGPassFlags GetDepthComputePassFlags();
+
+
 	// Misc helpers
 
+	// Pooled render target wrapping an external texture, to register it with a render graph
+	// Wrappers are cached per texture, rather than created for every graph. Defined in CompUtilsExternalTextures.cpp
+	TRefCountPtr<IPooledRenderTarget> GetExternalRenderTarget(FRHITexture* Texture, const TCHAR* Name);
+
 	// Defined in CompUtilsDepthAlignmentPipeline.cpp
 	TOptional<FPlane4f> CalculatePlaneOfBestFit(const TArray<FVector3f>& Points);
 
@@ -6,11 +6,21 @@
 DECLARE_GPU_STAT_NAMED(CompUtilsRelightingStat, TEXT("CompUtilsRelighting"));
 
 
+// Without a light contribution the pass is compiled down to a copy of the camera color
+class FApplyLighting : SHADER_PERMUTATION_BOOL("APPLY_LIGHTING");
+
 class FRelightingPS : public FGlobalShader
 {
 	DECLARE_GLOBAL_SHADER(FRelightingPS)
 	SHADER_USE_PARAMETER_STRUCT(FRelightingPS, FGlobalShader)
 
+	using FPermutationDomain = TShaderPermutationDomain<FApplyLighting>;
+
+	static bool ShouldCompilePermutation(const FGlobalShaderPermutationParameters& Parameters)
+	{
+		return CompositionUtils::ShouldCompileShader(Parameters);
+	}
+
 	BEGIN_SHADER_PARAMETER_STRUCT(FParameters, )
 		SHADER_PARAMETER_STRUCT(FScreenPassTextureViewportParameters, OutViewPort)
 		SHADER_PARAMETER_STRUCT(FScreenPassTextureViewportParameters, InViewPort)
@@ -35,6 +45,41 @@ class FRelightingPS : public FGlobalShader
 IMPLEMENT_GLOBAL_SHADER(FRelightingPS, "/Plugin/CompositionUtils/Relighting.usf", "RelightingPS", SF_Pixel);
 
 
+class FRelightingCS : public FGlobalShader
+{
+	DECLARE_GLOBAL_SHADER(FRelightingCS)
+	SHADER_USE_PARAMETER_STRUCT(FRelightingCS, FGlobalShader)
+
+	using FPermutationDomain = TShaderPermutationDomain<CompositionUtils::FComputeGroupSizeDim, FApplyLighting>;
+
+	static bool ShouldCompilePermutation(const FGlobalShaderPermutationParameters& Parameters)
+	{
+		return CompositionUtils::ShouldCompileComputePermutation<FRelightingCS>(Parameters);
+	}
+
+	BEGIN_SHADER_PARAMETER_STRUCT(FParameters, )
+		SHADER_PARAMETER_SAMPLER(SamplerState, sampler0)
+
+		SHADER_PARAMETER_RDG_TEXTURE_SRV(Texture2D<float4>, CameraColorTexture)
+		SHADER_PARAMETER_TEXTURE(Texture2D<float4>, CameraDepthTexture) // Not RDG resource
+		SHADER_PARAMETER_TEXTURE(Texture2D<float4>, CameraNormalTexture) // Not RDG resource
+
+		SHADER_PARAMETER(FVector3f, LightDirection)
+		SHADER_PARAMETER(FVector3f, LightColor)
+
+		SHADER_PARAMETER(FMatrix44f, CameraLocalToWorld)
+		SHADER_PARAMETER(FMatrix44f, CameraWorldToLocal)
+
+		SHADER_PARAMETER(float, LightWeight)
+
+		SHADER_PARAMETER_RDG_TEXTURE_UAV(RWTexture2D<float4>, OutTex)
+		SHADER_PARAMETER(FUintVector2, ViewDims)
+	END_SHADER_PARAMETER_STRUCT()
+};
+
+IMPLEMENT_GLOBAL_SHADER(FRelightingCS, "/Plugin/CompositionUtils/Relighting.usf", "RelightingCS", SF_Compute);
+
+
 void CompositionUtils::ExecuteRelightingPipeline(
 	FRDGBuilder& GraphBuilder,
 	const FRelightingParametersProxy& Parameters,
@@ -49,23 +94,47 @@ void CompositionUtils::ExecuteRelightingPipeline(
 	RDG_GPU_STAT_SCOPE(GraphBuilder, CompUtilsRelightingStat);
 	SCOPED_NAMED_EVENT(CompUtilsRelightingStat, FColor::Purple);
 
+	// Parameters are shared by the pixel and compute shader versions
+	auto SetPassParameters = [&](auto PassParameters)
+	{
+		PassParameters->CameraColorTexture = GraphBuilder.CreateSRV(InTexture);
+		PassParameters->CameraDepthTexture = Parameters.CameraDepthTexture->GetResource()->TextureRHI;
+		PassParameters->CameraNormalTexture = Parameters.CameraNormalTexture->GetResource()->TextureRHI;
+
+		PassParameters->LightColor = static_cast<FVector3f>(Parameters.LightProxy->GetColor());
+		PassParameters->LightDirection = static_cast<FVector3f>(Parameters.LightProxy->GetDirection());
+
+		PassParameters->CameraLocalToWorld = static_cast<FMatrix44f>(Parameters.CameraTransform.ToMatrixNoScale());
+		PassParameters->CameraWorldToLocal = PassParameters->CameraLocalToWorld.Inverse();
+
+		PassParameters->LightWeight = Parameters.LightWeight;
+	};
+
+	const bool bApplyLighting = Parameters.LightWeight != 0.0f && !Parameters.LightProxy->GetColor().IsAlmostBlack();
+
+	if (UseComputeForStage(EComputeStage::Relighting))
+	{
+		FRelightingCS::FPermutationDomain Permutation;
+		Permutation.Set<FApplyLighting>(bApplyLighting);
+
+		CompositionUtils::AddComputePass<FRelightingCS, TStaticSamplerState<>>(
+			GraphBuilder,
+			RDG_EVENT_NAME("CompUtilsRelighting"),
+			OutTexture,
+			SetPassParameters,
+			Permutation
+		);
+		return;
+	}
+
+	FRelightingPS::FPermutationDomain Permutation;
+	Permutation.Set<FApplyLighting>(bApplyLighting);
+
 	CompositionUtils::AddPass<FRelightingPS, TStaticSamplerState<>>(
 		GraphBuilder,
 		RDG_EVENT_NAME("CompUtilsRelighting"),
 		OutTexture,
-		[&](auto PassParameters)
-		{
-			PassParameters->CameraColorTexture = GraphBuilder.CreateSRV(InTexture);
-			PassParameters->CameraDepthTexture = Parameters.CameraDepthTexture->GetResource()->TextureRHI;
-			PassParameters->CameraNormalTexture = Parameters.CameraNormalTexture->GetResource()->TextureRHI;
-
-			PassParameters->LightColor = static_cast<FVector3f>(Parameters.LightProxy->GetColor());
-			PassParameters->LightDirection = static_cast<FVector3f>(Parameters.LightProxy->GetDirection());
-
-			PassParameters->CameraLocalToWorld = static_cast<FMatrix44f>(Parameters.CameraTransform.ToMatrixNoScale());
-			PassParameters->CameraWorldToLocal = PassParameters->CameraLocalToWorld.Inverse();
-
-			PassParameters->LightWeight = Parameters.LightWeight;
-		}
+		SetPassParameters,
+		Permutation
 	);
 }
@@ -1,6 +1,75 @@
 #include "CompUtilsPipelines.h"
 
+#include "CompositionUtils.h"
+
 DECLARE_GPU_STAT_NAMED(CompUtilsVolumetricCompositionStat, TEXT("CompUtilsVolumetricComposition"));
+DECLARE_DWORD_COUNTER_STAT(TEXT("Stale Volumetric Fog Reads"), STAT_CompUtilsStaleVolumetricFogReads, STATGROUP_CompUtils);
+
+
+//////////////////////////////////////
+// FVolumetricFogRequiredDataBuffer //
+//////////////////////////////////////
+
+FVolumetricFogRequiredDataProxy& FVolumetricFogRequiredDataBuffer::BeginExtraction()
+{
+	check(IsInRenderingThread());
+
+	// Views rendered again in the same frame replace the fog of that frame, rather than the fog of the previous frame
+	const uint64 FrameNumber = GFrameCounterRenderThread;
+	const bool bSameFrame = PublishedIndex != INDEX_NONE && Slots[PublishedIndex].FrameNumber == FrameNumber;
+	WriteIndex = bSameFrame ? PublishedIndex : (PublishedIndex + 1) % 2;
+
+	bPublished[WriteIndex] = false;
+	Slots[WriteIndex] = FVolumetricFogRequiredDataProxy();
+	Slots[WriteIndex].FrameNumber = FrameNumber;
+	return Slots[WriteIndex];
+}
+
+void FVolumetricFogRequiredDataBuffer::PublishExtraction()
+{
+	check(IsInRenderingThread());
+
+	bPublished[WriteIndex] = true;
+	PublishedIndex = WriteIndex;
+	bHasData.store(true, std::memory_order_release);
+}
+
+const FVolumetricFogRequiredDataProxy* FVolumetricFogRequiredDataBuffer::Find(uint64 FrameNumber, bool& bOutStale) const
+{
+	check(IsInRenderingThread());
+
+	// Most recent fog up to FrameNumber, falling back to the oldest fog if all of it is more recent
+	int32 FoundIndex = INDEX_NONE;
+	for (int32 i = 0; i < 2; i++)
+	{
+		if (!bPublished[i])
+			continue;
+
+		if (FoundIndex == INDEX_NONE)
+		{
+			FoundIndex = i;
+			continue;
+		}
+
+		const uint64 Found = Slots[FoundIndex].FrameNumber;
+		const uint64 Candidate = Slots[i].FrameNumber;
+		const bool bCandidateCloser = (Candidate <= FrameNumber)
+			? (Found > FrameNumber || Candidate > Found)
+			: (Found > FrameNumber && Candidate < Found);
+		if (bCandidateCloser)
+		{
+			FoundIndex = i;
+		}
+	}
+
+	if (FoundIndex == INDEX_NONE)
+		return nullptr;
+
+	bOutStale = Slots[FoundIndex].FrameNumber != FrameNumber;
+	return &Slots[FoundIndex];
+}
+
+
 
 
 class FVolumetricCompositionPS : public FGlobalShader
@@ -33,6 +102,42 @@ class FVolumetricCompositionPS : public FGlobalShader
 IMPLEMENT_GLOBAL_SHADER(FVolumetricCompositionPS, "/Plugin/CompositionUtils/VolumetricComposition.usf", "VolumetricCompositionPS", SF_Pixel);
 
 
+class FVolumetricCompositionCS : public FGlobalShader
+{
+	DECLARE_GLOBAL_SHADER(FVolumetricCompositionCS)
+	SHADER_USE_PARAMETER_STRUCT(FVolumetricCompositionCS, FGlobalShader)
+
+	using FPermutationDomain = TShaderPermutationDomain<CompositionUtils::FComputeGroupSizeDim>;
+
+	static bool ShouldCompilePermutation(const FGlobalShaderPermutationParameters& Parameters)
+	{
+		return CompositionUtils::ShouldCompileComputePermutation<FVolumetricCompositionCS>(Parameters);
+	}
+
+	BEGIN_SHADER_PARAMETER_STRUCT(FParameters, )
+		SHADER_PARAMETER_SAMPLER(SamplerState, sampler0)
+
+		SHADER_PARAMETER_RDG_TEXTURE_SRV(Texture2D<float4>, CameraColorTexture)
+		SHADER_PARAMETER_TEXTURE(Texture2D<float4>, CameraDepthTexture) // Not RDG resource
+
+		SHADER_PARAMETER_RDG_TEXTURE_SRV(Texture3D, IntegratedLightScattering)
+		SHADER_PARAMETER_SAMPLER(SamplerState, IntegratedLightScatteringSampler)
+
+		SHADER_PARAMETER(float, VolumetricFogStartDistance)
+		SHADER_PARAMETER(FVector3f, VolumetricFogInvGridSize)
+		SHADER_PARAMETER(FVector3f, VolumetricFogGridZParams)
+		SHADER_PARAMETER(FVector2f, VolumetricFogSVPosToVolumeUV)
+		SHADER_PARAMETER(FVector2f, VolumetricFogUVMax)
+		SHADER_PARAMETER(float, OneOverPreExposure)
+
+		SHADER_PARAMETER_RDG_TEXTURE_UAV(RWTexture2D<float4>, OutTex)
+		SHADER_PARAMETER(FUintVector2, ViewDims)
+	END_SHADER_PARAMETER_STRUCT()
+};
+
+IMPLEMENT_GLOBAL_SHADER(FVolumetricCompositionCS, "/Plugin/CompositionUtils/VolumetricComposition.usf", "VolumetricCompositionCS", SF_Compute);
+
+
 void CompositionUtils::ExecuteVolumetricsCompositionPipeline(
 	FRDGBuilder& GraphBuilder,
 	const FVolumetricsCompositionParametersProxy& Parameters,
@@ -43,30 +148,54 @@ void CompositionUtils::ExecuteVolumetricsCompositionPipeline(
 	check(IsInRenderingThread());
 	check(Parameters.IsValid());
 
+	bool bStale = false;
+	const FVolumetricFogRequiredDataProxy* VolumetricFogData = Parameters.VolumetricFogData->Find(Parameters.FrameNumber, bStale);
+	check(VolumetricFogData);
+
+	if (bStale)
+	{
+		INC_DWORD_STAT(STAT_CompUtilsStaleVolumetricFogReads);
+		UE_LOG(LogCompositionUtils, Verbose, TEXT("VolumetricsPass: Composing fog of frame %llu in frame %llu"), VolumetricFogData->FrameNumber, Parameters.FrameNumber);
+	}
+
 	RDG_EVENT_SCOPE_STAT(GraphBuilder, CompUtilsVolumetricCompositionStat, "CompUtilsVolumetricComposition");
 	RDG_GPU_STAT_SCOPE(GraphBuilder, CompUtilsVolumetricCompositionStat);
 	SCOPED_NAMED_EVENT(CompUtilsVolumetricCompositionStat, FColor::Purple);
 
-	FRDGTextureRef IntegratedLightScatteringTexture = GraphBuilder.RegisterExternalTexture(Parameters.VolumetricFogData->IntegratedLightScatteringTexture);
+	FRDGTextureRef IntegratedLightScatteringTexture = GraphBuilder.RegisterExternalTexture(VolumetricFogData->IntegratedLightScatteringTexture);
+
+	// Parameters are shared by the pixel and compute shader versions
+	auto SetPassParameters = [&](auto PassParameters)
+	{
+		PassParameters->CameraColorTexture = GraphBuilder.CreateSRV(InTexture);
+		PassParameters->CameraDepthTexture = Parameters.CameraDepthTexture->GetResource()->TextureRHI;
+
+		PassParameters->IntegratedLightScattering = GraphBuilder.CreateSRV(IntegratedLightScatteringTexture);
+		PassParameters->IntegratedLightScatteringSampler = TStaticSamplerState<SF_Bilinear, AM_Clamp, AM_Clamp, AM_Clamp>::GetRHI();
+
+		PassParameters->VolumetricFogStartDistance = VolumetricFogData->VolumetricFogStartDistance;
+		PassParameters->VolumetricFogInvGridSize = VolumetricFogData->VolumetricFogInvGridSize;
+		PassParameters->VolumetricFogGridZParams = VolumetricFogData->VolumetricFogGridZParams;
+		PassParameters->VolumetricFogSVPosToVolumeUV = VolumetricFogData->VolumetricFogSVPosToVolumeUV;
+		PassParameters->VolumetricFogUVMax = VolumetricFogData->VolumetricFogUVMax;
+		PassParameters->OneOverPreExposure = VolumetricFogData->OneOverPreExposure;
+	};
+
+	if (UseComputeForStage(EComputeStage::Volumetrics))
+	{
+		CompositionUtils::AddComputePass<FVolumetricCompositionCS, TStaticSamplerState<SF_Bilinear>>(
+			GraphBuilder,
+			RDG_EVENT_NAME("CompUtilsVolumetricComposition"),
+			OutTexture,
+			SetPassParameters
+		);
+		return;
+	}
 
 	CompositionUtils::AddPass<FVolumetricCompositionPS, TStaticSamplerState<SF_Bilinear>>(
 		GraphBuilder,
 		RDG_EVENT_NAME("CompUtilsVolumetricComposition"),
 		OutTexture,
-		[&](auto PassParameters)
-		{
-			PassParameters->CameraColorTexture = GraphBuilder.CreateSRV(InTexture);
-			PassParameters->CameraDepthTexture = Parameters.CameraDepthTexture->GetResource()->TextureRHI;
-
-			PassParameters->IntegratedLightScattering = GraphBuilder.CreateSRV(IntegratedLightScatteringTexture);
-			PassParameters->IntegratedLightScatteringSampler = TStaticSamplerState<SF_Bilinear, AM_Clamp, AM_Clamp, AM_Clamp>::GetRHI();
-
-			PassParameters->VolumetricFogStartDistance = Parameters.VolumetricFogData->VolumetricFogStartDistance;
-			PassParameters->VolumetricFogInvGridSize = Parameters.VolumetricFogData->VolumetricFogInvGridSize;
-			PassParameters->VolumetricFogGridZParams = Parameters.VolumetricFogData->VolumetricFogGridZParams;
-			PassParameters->VolumetricFogSVPosToVolumeUV = Parameters.VolumetricFogData->VolumetricFogSVPosToVolumeUV;
-			PassParameters->VolumetricFogUVMax = Parameters.VolumetricFogData->VolumetricFogUVMax;
-			PassParameters->OneOverPreExposure = Parameters.VolumetricFogData->OneOverPreExposure;
-		}
+		SetPassParameters
 	);
 }
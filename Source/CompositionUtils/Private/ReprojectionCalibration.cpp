@@ -1,15 +1,125 @@
 #include "ReprojectionCalibration.h"
 
+#include "IMediaTextureSample.h"
+#include "MediaPlayer.h"
+#include "MediaPlayerFacade.h"
+#include "MediaSampleSink.h"
 #include "MediaTexture.h"
 
 
+/**
+ * Video sample sink that only keeps the most recently received sample
+ * Samples are enqueued from media threads, and handed over to the reader when taken
+ * so the sink does not hold on to media buffers between captures
+ */
+class FCompUtilsLatestMediaSampleSink : public FMediaTextureSampleSink
+{
+public:
+	//~ Begin TMediaSampleSink interface
+	virtual bool Enqueue(const TSharedRef<IMediaTextureSample, ESPMode::ThreadSafe>& Sample) override
+	{
+		FScopeLock Lock(&CriticalSection);
+		LatestSample = Sample;
+		return true;
+	}
+
+	virtual int32 Num() const override
+	{
+		FScopeLock Lock(&CriticalSection);
+		return LatestSample.IsValid() ? 1 : 0;
+	}
+
+	virtual void RequestFlush() override
+	{
+		FScopeLock Lock(&CriticalSection);
+		LatestSample.Reset();
+	}
+
+	virtual bool CanAcceptSamples(int32 NumSamples) const override { return true; }
+	//~ End TMediaSampleSink interface
+
+	TSharedPtr<IMediaTextureSample, ESPMode::ThreadSafe> TakeLatestSample()
+	{
+		FScopeLock Lock(&CriticalSection);
+		return MoveTemp(LatestSample);
+	}
+
+private:
+	mutable FCriticalSection CriticalSection;
+	TSharedPtr<IMediaTextureSample, ESPMode::ThreadSafe> LatestSample;
+};
+
+
 UReprojectionCalibration::UReprojectionCalibration()
 	: ExtrinsicTransform(FTransform::Identity)
+	, bUseCoarseToFineDetection(true)
+	, CoarseDetectionDownsampleFactor(4)
+	, bUseCornerPrefilter(true)
+	, CornerPrefilterThreshold(0.01f)
+	, AutoCaptureRate(4.0f)
+	, AutoCaptureMinRotationDifference(10.0f)
+	, AutoCaptureMinTranslationDifference(10.0f)
+	, AutoCaptureMaxReprojectionError(1.0f)
+{
+}
+
+void UReprojectionCalibration::SetExtrinsicTransform(const FTransform& InTransform)
+{
+	ExtrinsicTransform = InTransform;
+	OnCalibrationChanged.Broadcast(this);
+}
+
+#if WITH_EDITOR
+void UReprojectionCalibration::PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent)
 {
+	Super::PostEditChangeProperty(PropertyChangedEvent);
+
+	OnCalibrationChanged.Broadcast(this);
 }
+#endif
 
 
 TObjectPtr<UTexture> UReprojectionCalibrationMediaTarget::GetTexture()
 {
 	return MediaTexture;
 }
+
+bool UReprojectionCalibrationMediaTarget::GetCPUFrame(FCompUtilsCPUFrame& OutFrame)
+{
+	UMediaPlayer* MediaPlayer = MediaTexture ? MediaTexture->GetMediaPlayer() : nullptr;
+	if (!MediaPlayer)
+		return false;
+
+	// Samples only start arriving once registered, so the first request will always fall back to the texture
+	if (!SampleSink.IsValid() || SampleSinkPlayer != MediaPlayer)
+	{
+		SampleSink = MakeShared<FCompUtilsLatestMediaSampleSink, ESPMode::ThreadSafe>();
+		SampleSinkPlayer = MediaPlayer;
+		MediaPlayer->GetPlayerFacade()->AddVideoSampleSink(SampleSink.ToSharedRef());
+		return false;
+	}
+
+	// The sample is released once it goes out of scope, returning its buffer to the player
+	TSharedPtr<IMediaTextureSample, ESPMode::ThreadSafe> Sample = SampleSink->TakeLatestSample();
+	if (!Sample.IsValid())
+		return false;
+
+	// Samples that live on the GPU or need conversion are left to the texture path
+	const uint8* Buffer = static_cast<const uint8*>(Sample->GetBuffer());
+	if (!Buffer || Sample->GetFormat() != EMediaTextureSampleFormat::CharBGRA)
+		return false;
+
+	const FIntPoint Size = Sample->GetOutputDim();
+	const uint32 Stride = Sample->GetStride();
+	if (Size.X <= 0 || Size.Y <= 0 || Stride < Size.X * sizeof(FColor))
+		return false;
+
+	OutFrame.Size = Size;
+	OutFrame.Pixels.SetNumUninitialized(Size.X * Size.Y);
+	for (int32 Y = 0; Y < Size.Y; Y++)
+	{
+		FMemory::Memcpy(&OutFrame.Pixels[Y * Size.X], Buffer + Y * Stride, Size.X * sizeof(FColor));
+	}
+
+	return true;
+}
@@ -0,0 +1,131 @@
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+#include "Camera/CameraActor.h"
+#include "Engine/World.h"
+#include "HAL/MemoryBase.h"
+
+#include "Composure/CompUtilsElementTransforms.h"
+#include "Composure/CompUtilsPassBase.h"
+
+#include <atomic>
+
+
+// Replaces GMalloc while in scope, counting the heap allocations made by the thread that installed it
+// Every call is forwarded to the replaced allocator, so memory may be freed on either side of the scope
+class FCompUtilsAllocationCounter : public FMalloc
+{
+public:
+	FCompUtilsAllocationCounter()
+		: InnerMalloc(GMalloc)
+		, ThreadId(FPlatformTLS::GetCurrentThreadId())
+	{
+		GMalloc = this;
+	}
+
+	virtual ~FCompUtilsAllocationCounter() override
+	{
+		GMalloc = InnerMalloc;
+	}
+
+	int32 GetNumAllocations() const { return NumAllocations.load(); }
+
+	//~ Begin FMalloc interface
+	virtual void* Malloc(SIZE_T Count, uint32 Alignment) override
+	{
+		CountAllocation();
+		return InnerMalloc->Malloc(Count, Alignment);
+	}
+
+	virtual void* TryMalloc(SIZE_T Count, uint32 Alignment) override
+	{
+		CountAllocation();
+		return InnerMalloc->TryMalloc(Count, Alignment);
+	}
+
+	virtual void* Realloc(void* Original, SIZE_T Count, uint32 Alignment) override
+	{
+		CountAllocation();
+		return InnerMalloc->Realloc(Original, Count, Alignment);
+	}
+
+	virtual void* TryRealloc(void* Original, SIZE_T Count, uint32 Alignment) override
+	{
+		CountAllocation();
+		return InnerMalloc->TryRealloc(Original, Count, Alignment);
+	}
+
+	virtual void Free(void* Original) override { InnerMalloc->Free(Original); }
+	virtual SIZE_T QuantizeSize(SIZE_T Count, uint32 Alignment) override { return InnerMalloc->QuantizeSize(Count, Alignment); }
+	virtual bool GetAllocationSize(void* Original, SIZE_T& SizeOut) override { return InnerMalloc->GetAllocationSize(Original, SizeOut); }
+	virtual void Trim(bool bTrimThreadCaches) override { InnerMalloc->Trim(bTrimThreadCaches); }
+	virtual bool IsInternallyThreadSafe() const override { return InnerMalloc->IsInternallyThreadSafe(); }
+	virtual const TCHAR* GetDescriptiveName() override { return TEXT("CompUtilsAllocationCounter"); }
+	//~ End FMalloc interface
+
+private:
+	void CountAllocation()
+	{
+		if (FPlatformTLS::GetCurrentThreadId() == ThreadId)
+		{
+			NumAllocations++;
+		}
+	}
+
+	FMalloc* InnerMalloc;
+	uint32 ThreadId;
+	std::atomic<int32> NumAllocations = 0;
+};
+
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCompUtilsPassChainAllocationTest, "CompositionUtils.PassChain.SteadyStateAllocations",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FCompUtilsPassChainAllocationTest::RunTest(const FString& Parameters)
+{
+	UWorld* World = UWorld::CreateWorld(EWorldType::Game, false);
+	ACameraActor* Camera = World->SpawnActor<ACameraActor>();
+
+	// Passes that only need a target camera, so that no element or camera feed has to be set up
+	UCompositionUtilsPassChain* Chain = NewObject<UCompositionUtilsPassChain>(GetTransientPackage());
+	Chain->Passes.Add(NewObject<UCompositionUtilsDepthPreviewPass>(Chain));
+	Chain->Passes.Add(NewObject<UCompositionUtilsNormalMapPreviewPass>(Chain));
+	Chain->Passes.Add(NewObject<UCompositionUtilsAddCrosshairPass>(Chain));
+
+	// Same steps as UCompositionUtilsPassChain::ApplyTransform_Implementation, up to handing the prepared passes to a render command
+	// Enqueueing the command itself is left out, as its allocation is made by the engine
+	const auto PrepareFrame = [Chain, Camera]()
+	{
+		FCompUtilsPreparedPasses PreparedPasses;
+		Chain->PreparePasses(FIntPoint(1920, 1080), Camera, PreparedPasses);
+
+		auto Command = [PreparedPasses = MoveTemp(PreparedPasses)]() mutable
+		{
+			return PreparedPasses.Num();
+		};
+		return Command();
+	};
+
+	// The first frame may allocate, e.g. for function-local statics
+	const int32 NumPreparedPasses = PrepareFrame();
+
+	constexpr int32 NumFrames = 8;
+	int32 NumAllocations = 0;
+	{
+		FCompUtilsAllocationCounter AllocationCounter;
+		for (int32 Frame = 0; Frame < NumFrames; Frame++)
+		{
+			PrepareFrame();
+		}
+		NumAllocations = AllocationCounter.GetNumAllocations();
+	}
+
+	TestEqual(TEXT("Prepared passes"), NumPreparedPasses, Chain->Passes.Num());
+	TestEqual(TEXT("Heap allocations while preparing a pass chain"), NumAllocations, 0);
+
+	World->DestroyWorld(false);
+	return true;
+}
+
+#endif
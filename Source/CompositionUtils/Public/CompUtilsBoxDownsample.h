@@ -0,0 +1,20 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "RenderGraphFwd.h"
+
+
+namespace CompositionUtils
+{
+	/**
+	 * Averages every DownsampleFactor x DownsampleFactor block of InTexture into a pixel of OutTexture, like cv::INTER_AREA
+	 * Unlike a bilinear copy, every input pixel contributes to the output, so the downsampled image doesn't alias
+	 * OutTexture must have the size of InTexture divided by DownsampleFactor, rounded up
+	 */
+	COMPOSITIONUTILS_API void AddBoxDownsamplePass(
+		FRDGBuilder& GraphBuilder,
+		FRDGTextureRef InTexture,
+		FRDGTextureRef OutTexture,
+		uint32 DownsampleFactor
+	);
+}
@@ -36,5 +36,9 @@ struct COMPOSITIONUTILS_API FCompUtilsCameraIntrinsicData
 	FVector2D FocalLength = FVector2D::ZeroVector;
 	FVector2D ImageCenter = FVector2D::ZeroVector;
 
-	TArray<float> DistortionParams;
+	// Sufficient for every distortion model supported by OpenCV
+	static constexpr int32 MaxDistortionParams = 14;
+
+	// Stored inline, so that intrinsics can be copied into render commands every frame without allocating
+	TArray<float, TFixedAllocator<MaxDistortionParams>> DistortionParams;
 };
@@ -26,4 +26,9 @@ public:
 
 	virtual bool GetCameraIntrinsicData(FCompUtilsCameraIntrinsicData& OutData);
 
+	// Hash of the camera properties that the intrinsic data is derived from: FOV, aspect ratio, filmback, lens, etc.
+	// Allows previously fetched intrinsic data to be reused until the hash changes
+	// Returns false if no hash is available, in which case the intrinsic data must always be fetched
+	virtual bool GetCameraIntrinsicsHash(uint32& OutHash);
+
 };
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "RenderGraphFwd.h"
+
+
+struct FCompUtilsCornerPrefilterSettings
+{
+	// Minimum saddle response for a pixel to be an X-corner candidate, roughly a quarter of the squared contrast of the corner
+	float ResponseThreshold = 0.01f;
+
+	// Distance between the samples used to estimate the response (in pixels)
+	uint32 SampleSpacing = 2;
+
+	// Candidates required within an 8x8 tile for it to be included, which rejects isolated noise
+	uint32 MinCandidatesPerTile = 4;
+};
+
+namespace CompositionUtils
+{
+	// Size of the buffer returned by AddCornerPrefilterPasses, that should be read back and decoded with DecodeCornerPrefilterBounds
+	constexpr uint32 CornerPrefilterBoundsSize = 5 * sizeof(uint32);
+
+	/**
+	 * Computes a saddle response over InTexture and reduces it to the bounding rectangle of tiles containing strong X-corner candidates
+	 * Used to restrict the region searched for a checkerboard, so that detection cost scales with the size of the board rather than the frame
+	 */
+	COMPOSITIONUTILS_API FRDGBufferRef AddCornerPrefilterPasses(
+		FRDGBuilder& GraphBuilder,
+		FRDGTextureRef InTexture,
+		const FCompUtilsCornerPrefilterSettings& Settings
+	);
+
+	// Returns false if no candidates were found
+	COMPOSITIONUTILS_API bool DecodeCornerPrefilterBounds(const void* BoundsData, FIntRect& OutBounds);
+}
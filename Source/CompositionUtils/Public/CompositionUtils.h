@@ -3,9 +3,17 @@
 #pragma once
 
 #include "Modules/ModuleManager.h"
+#include "ProfilingDebugging/CsvProfiler.h"
+#include "Stats/Stats.h"
+#include "Trace/Trace.h"
 
 DECLARE_LOG_CATEGORY_EXTERN(LogCompositionUtils, Log, All);
 
+// Profiling of CompUtils passes: "stat CompUtils", the CompUtils CSV category and the CompUtils trace channel in Unreal Insights
+DECLARE_STATS_GROUP(TEXT("CompUtils"), STATGROUP_CompUtils, STATCAT_Advanced);
+CSV_DECLARE_CATEGORY_MODULE_EXTERN(COMPOSITIONUTILS_API, CompUtils);
+UE_TRACE_CHANNEL_EXTERN(CompUtilsChannel, COMPOSITIONUTILS_API);
+
 
 class FCompositionUtilsModule : public IModuleInterface
 {
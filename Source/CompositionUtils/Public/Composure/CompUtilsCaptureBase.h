@@ -1,18 +1,23 @@
 #pragma once
 
 #include "CompositingCaptureBase.h"
+#include "Camera/CameraTypes.h"
 #include "CompUtilsCameraInterface.h"
+#include "Composure/CompUtilsTextureRevisions.h"
 
 #include "CompUtilsCaptureBase.generated.h"
 
 
-struct FVolumetricFogRequiredDataProxy;
+class FVolumetricFogRequiredDataBuffer;
 
 struct FCameraTexturesProxy
 {
 	UTexture* ColorTexture   = nullptr;
 	UTexture* DepthTexture   = nullptr;
 	UTexture* NormalsTexture = nullptr;
+
+	// Oldest sample time of the textures, unset if any of them isn't known, see CompositionUtils::GetTextureSampleTime
+	TOptional<FCompUtilsSampleTime> SampleTime;
 };
 
 
@@ -65,32 +70,48 @@ public:
 	float SpecularOverride = 0.0f;
 
 public:
-
+	// Fog extracted by the scene capture of the two most recent frames
 	// Only dereference on render thread!
-	// TODO: Return reference type instead of pointer type - the struct itself will always exist
-	const FVolumetricFogRequiredDataProxy* GetVolumetricFogData() const;
-protected:
-	FVolumetricFogRequiredDataProxy* GetVolumetricFogData();
+	TSharedPtr<const FVolumetricFogRequiredDataBuffer, ESPMode::ThreadSafe> GetVolumetricFogData() const;
 
 public:
 	// Call this in GenerateInputs before rendering the scene capture
 	UFUNCTION(BlueprintCallable, Category="Composure|Compositing Utils", CallInEditor)
 	void FetchLatestCameraTextures_GameThread();
 
-	const FCameraTexturesProxy& GetCameraTextures_RenderThread() const;
-
 public:
 	//~ Begin ICompUtilsCameraInterface interface
 	virtual bool GetCameraIntrinsicData(FCompUtilsCameraIntrinsicData& OutData) override;
+	virtual bool GetCameraIntrinsicsHash(uint32& OutHash) override;
 	//~ End ICompUtilsCameraInterface interface
 
+private:
+	// Everything the intrinsics of the target camera are derived from
+	struct FTargetCameraView
+	{
+		FMinimalViewInfo View;
+		// Only used for its identity, never dereferenced
+		const void* CameraComponent = nullptr;
+
+		bool bIsCineCamera = false;
+		float SensorWidth = 0.0f;
+		float SensorHeight = 0.0f;
+		float FocalLength = 0.0f;
+		float Aperture = 0.0f;
+		float FocusDistance = 0.0f;
+	};
+
+	// Must be called on the game thread
+	bool GetTargetCameraView(FTargetCameraView& OutView);
+
 protected:
 	// Rendering resources extracted from the scene renderer for use in composition
 	// This layer provides a place to keep these resources safe and reference them in later Composure passes,
 	// after the scene rendering has been completed
-	TSharedPtr<struct FVolumetricFogRequiredDataProxy> VolumetricFogData_RenderThread;
+	TSharedPtr<FVolumetricFogRequiredDataBuffer, ESPMode::ThreadSafe> VolumetricFogData;
 
-	FCameraTexturesProxy CameraTextures_RenderThread;
+	// Latest camera textures, only accessed on the game thread
+	FCameraTexturesProxy CameraTextures;
 
 private:
 	TSharedPtr<class FCompUtilsViewExtension, ESPMode::ThreadSafe> CompUtilsViewExtension;
@@ -5,13 +5,48 @@
 #include "CompositingElement.h"
 #include "ReprojectionCalibration.h"
 #include "CompositingElements/CompositingElementPasses.h"
+#include "Composure/CompUtilsPassBase.h"
 #include "Engine/DirectionalLight.h"
 
 #include "CompUtilsElementTransforms.generated.h"
 
 
+/**
+ * Statistics of the most recent live extrinsic refinement, for reporting to the user
+ */
+USTRUCT(BlueprintType)
+struct COMPOSITIONUTILS_API FCompUtilsExtrinsicRefinementReport
+{
+	GENERATED_BODY()
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Live Refinement")
+	int32 NumRefinements = 0;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Live Refinement")
+	bool bConverged = false;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Live Refinement")
+	int32 NumIterations = 0;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Live Refinement")
+	int32 NumPoints = 0;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Live Refinement")
+	int32 NumInliers = 0;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Live Refinement", DisplayName = "Convergence Time (ms)")
+	float ConvergenceTimeMs = 0.0f;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Live Refinement", DisplayName = "Time Per Iteration (ms)")
+	float IterationTimeMs = 0.0f;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Live Refinement", DisplayName = "RMS Error (cm)")
+	float RMSError = 0.0f;
+};
+
+
 UCLASS(BlueprintType, Blueprintable)
-class COMPOSITIONUTILS_API UCompositionUtilsDepthProcessingPass : public UCompositingElementTransform
+class COMPOSITIONUTILS_API UCompositionUtilsDepthProcessingPass : public UCompositionUtilsPassBase
 {
 	GENERATED_BODY()
 
@@ -38,9 +73,10 @@ public:
 	TWeakObjectPtr<ACompositingElement> SourceCamera;
 
 public:
-	//~ Begin UCompositingElementTransform interface
-	virtual UTexture* ApplyTransform_Implementation(UTexture* Input, UComposurePostProcessingPassProxy* PostProcessProxy, ACameraActor* TargetCamera) override;
-	//~ End UCompositingElementTransform interface
+	//~ Begin UCompositionUtilsPassBase interface
+	virtual bool PrepareRenderPass(FIntPoint InputSize, ACameraActor* TargetCamera, FCompUtilsPreparedPass& OutPass) override;
+	virtual bool IsOutputFormatFixed() const override { return true; }
+	//~ End UCompositionUtilsPassBase interface
 };
 
 
@@ -52,7 +88,7 @@ public:
  * This relies on known the intrinsic properties of each camera, and the extrinsic nodal offset relating the two cameras.
  */
 UCLASS(BlueprintType, Blueprintable)
-class COMPOSITIONUTILS_API UCompositionUtilsDepthAlignmentPass : public UCompositingElementTransform
+class COMPOSITIONUTILS_API UCompositionUtilsDepthAlignmentPass : public UCompositionUtilsPassBase
 {
 	GENERATED_BODY()
 
@@ -69,10 +105,85 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Compositing Pass", meta = (DisplayAfter = "PassName", EditCondition = "bEnabled", ClampMin="0", ClampMax="8"))
 	int32 HoleFillingBias = 0;
 
+	// Live refinement continuously corrects the nodal offset by fitting the depth point cloud to known virtual geometry
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Compositing Pass|Live Refinement", meta = (EditCondition = "bEnabled"))
+	bool bEnableLiveRefinement = false;
+
+	// Time between point cloud readbacks (in seconds)
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Compositing Pass|Live Refinement", meta = (EditCondition = "bEnableLiveRefinement", ClampMin="0.0"))
+	float RefinementInterval = 1.0f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Compositing Pass|Live Refinement", meta = (EditCondition = "bEnableLiveRefinement", ClampMin="16", ClampMax="65536"))
+	int32 RefinementPointCount = 4096;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Compositing Pass|Live Refinement", meta = (EditCondition = "bEnableLiveRefinement", ClampMin="1"))
+	int32 RefinementMaxIterations = 20;
+
+	// Points further than this from all reference planes are ignored (in cm)
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Compositing Pass|Live Refinement", meta = (EditCondition = "bEnableLiveRefinement", ClampMin="0.0"))
+	float RefinementMaxCorrespondenceDistance = 10.0f;
+
+	// Known virtual geometry that the real-world depth is fit to, e.g. the floor.
+	// Planes are in world space, or in the local space of RefinementReferenceActor if one is assigned.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Compositing Pass|Live Refinement", meta = (EditCondition = "bEnableLiveRefinement"))
+	TArray<FPlane> RefinementReferencePlanes{ FPlane{ FVector::ZeroVector, FVector::UpVector } };
+
+	// Optional tracked object that the reference planes are attached to
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Compositing Pass|Live Refinement", meta = (EditCondition = "bEnableLiveRefinement"))
+	TWeakObjectPtr<AActor> RefinementReferenceActor;
+
+	UPROPERTY(VisibleInstanceOnly, BlueprintReadOnly, Transient, Category = "Compositing Pass|Live Refinement")
+	FCompUtilsExtrinsicRefinementReport RefinementReport;
+
 public:
-	//~ Begin UCompositingElementTransform interface
-	virtual UTexture* ApplyTransform_Implementation(UTexture* Input, UComposurePostProcessingPassProxy* PostProcessProxy, ACameraActor* TargetCamera) override;
-	//~ End UCompositingElementTransform interface
+	// Discards any live refinement and returns to using the calibrated nodal offset
+	UFUNCTION(BlueprintCallable, CallInEditor, Category = "Compositing Pass|Live Refinement")
+	void ResetLiveRefinement();
+
+	//~ Begin UCompositionUtilsPassBase interface
+	virtual bool PrepareRenderPass(FIntPoint InputSize, ACameraActor* TargetCamera, FCompUtilsPreparedPass& OutPass) override;
+	virtual bool IsOutputFormatFixed() const override { return true; }
+	virtual bool IsOutputResolutionFixed() const override { return true; }
+	//~ End UCompositionUtilsPassBase interface
+
+	//~ Begin UObject interface
+	virtual void PostLoad() override;
+	virtual void BeginDestroy() override;
+#if WITH_EDITOR
+	virtual void PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent) override;
+#endif
+	//~ End UObject interface
+
+private:
+	// Snapshot of the reference planes in the view space of the destination camera
+	bool GetReferencePlanesInDestinationView(TArray<FPlane>& OutPlanes) const;
+
+	void PublishRefinement_GameThread(const struct FCompUtilsExtrinsicRefinementResult& Result);
+
+	// Streams in CalibrationData without blocking, the calibrated nodal offset is identity until it has loaded
+	void RequestCalibrationData();
+	void BindCalibrationData(UReprojectionCalibration* Calibration);
+	void UnbindCalibrationData();
+	void OnCalibrationChanged(UReprojectionCalibration* Calibration);
+
+private:
+	bool bHasRefinedTransform = false;
+	FTransform RefinedTransform = FTransform::Identity;
+	FMatrix44f RefinedNodalOffset = FMatrix44f::Identity;
+
+	// Calibrated nodal offset, converted once whenever the calibration changes
+	FTransform CalibratedTransform = FTransform::Identity;
+	FMatrix44f CalibratedNodalOffset = FMatrix44f::Identity;
+
+	FSoftObjectPath RequestedCalibrationPath;
+	TSharedPtr<struct FStreamableHandle> CalibrationLoadHandle;
+
+	// Keeps the loaded calibration alive while bound, as CalibrationData only references it softly
+	UPROPERTY(Transient)
+	TObjectPtr<UReprojectionCalibration> BoundCalibration;
+	FDelegateHandle CalibrationChangedHandle;
+
+	TSharedPtr<struct FCompUtilsExtrinsicRefinementState, ESPMode::ThreadSafe> RefinementState;
 };
 
 
@@ -80,7 +191,7 @@ public:
  * Composites volumetric fog from the scene onto the camera image, using the real-world depth
  */
 UCLASS(BlueprintType, Blueprintable)
-class COMPOSITIONUTILS_API UCompositionUtilsVolumetricsPass : public UCompositingElementTransform
+class COMPOSITIONUTILS_API UCompositionUtilsVolumetricsPass : public UCompositionUtilsPassBase
 {		
 	GENERATED_BODY()
 
@@ -93,7 +204,14 @@ public:
 	TWeakObjectPtr<class ACompositionUtilsCaptureBase> CompUtilsCGLayer;
 
 public:
-	virtual UTexture* ApplyTransform_Implementation(UTexture* Input, UComposurePostProcessingPassProxy* PostProcessProxy, ACameraActor* TargetCamera) override;
+	//~ Begin UCompositionUtilsPassBase interface
+	virtual bool PrepareRenderPass(FIntPoint InputSize, ACameraActor* TargetCamera, FCompUtilsPreparedPass& OutPass) override;
+	virtual EPixelFormat GetDefaultOutputFormat() const override { return PF_B8G8R8A8; }
+	//~ End UCompositionUtilsPassBase interface
+
+	//~ Begin ICompUtilsPassDependencies interface
+	virtual void GetReferencedPassNames(TArray<FName>& OutPassNames) const override { OutPassNames.Add(CameraDepthPassName); }
+	//~ End ICompUtilsPassDependencies interface
 
 };
 
@@ -102,7 +220,7 @@ public:
  * Applies light sources from the virtual world to the camera image
  */
 UCLASS(BlueprintType, Blueprintable)
-class COMPOSITIONUTILS_API UCompositionUtilsRelightingPass : public UCompositingElementTransform
+class COMPOSITIONUTILS_API UCompositionUtilsRelightingPass : public UCompositionUtilsPassBase
 {
 	GENERATED_BODY()
 
@@ -121,7 +239,14 @@ public:
 	float LightWeight = 1.0f;
 
 public:
-	virtual UTexture* ApplyTransform_Implementation(UTexture* Input, UComposurePostProcessingPassProxy* PostProcessProxy, ACameraActor* TargetCamera) override;
+	//~ Begin UCompositionUtilsPassBase interface
+	virtual bool PrepareRenderPass(FIntPoint InputSize, ACameraActor* TargetCamera, FCompUtilsPreparedPass& OutPass) override;
+	virtual EPixelFormat GetDefaultOutputFormat() const override { return PF_B8G8R8A8; }
+	//~ End UCompositionUtilsPassBase interface
+
+	//~ Begin ICompUtilsPassDependencies interface
+	virtual void GetReferencedPassNames(TArray<FName>& OutPassNames) const override { OutPassNames.Add(CameraDepthPassName); OutPassNames.Add(CameraNormalPassName); }
+	//~ End ICompUtilsPassDependencies interface
 
 };
 
@@ -130,7 +255,7 @@ public:
  * Programmatically adds a crosshair to an image to assist with calibration and alignment.
  */
 UCLASS(BlueprintType, Blueprintable)
-class COMPOSITIONUTILS_API UCompositionUtilsAddCrosshairPass : public UCompositingElementTransform
+class COMPOSITIONUTILS_API UCompositionUtilsAddCrosshairPass : public UCompositionUtilsPassBase
 {
 	GENERATED_BODY()
 
@@ -145,7 +270,10 @@ public:
 	int32 Length = 50;
 
 public:
-	virtual UTexture* ApplyTransform_Implementation(UTexture* Input, UComposurePostProcessingPassProxy* PostProcessProxy, ACameraActor* TargetCamera) override;
+	//~ Begin UCompositionUtilsPassBase interface
+	virtual bool PrepareRenderPass(FIntPoint InputSize, ACameraActor* TargetCamera, FCompUtilsPreparedPass& OutPass) override;
+	virtual EPixelFormat GetDefaultOutputFormat() const override { return PF_B8G8R8A8; }
+	//~ End UCompositionUtilsPassBase interface
 };
 
 
@@ -153,7 +281,7 @@ public:
  * To be able to preview the depth image directly in the preview window
  */
 UCLASS(BlueprintType, Blueprintable)
-class COMPOSITIONUTILS_API UCompositionUtilsDepthPreviewPass : public UCompositingElementTransform
+class COMPOSITIONUTILS_API UCompositionUtilsDepthPreviewPass : public UCompositionUtilsPassBase
 {
 	GENERATED_BODY()
 
@@ -162,10 +290,10 @@ public:
 	FVector2D VisualizeDepthRange = { 0, 1000 };
 
 public:
-	virtual UTexture* ApplyTransform_Implementation(UTexture* Input, UComposurePostProcessingPassProxy* PostProcessProxy, ACameraActor* TargetCamera) override;
-
-private:
-	void ApplyVisualizeDepth(UTexture* Input, UTextureRenderTarget2D* RenderTarget) const;
+	//~ Begin UCompositionUtilsPassBase interface
+	virtual bool PrepareRenderPass(FIntPoint InputSize, ACameraActor* TargetCamera, FCompUtilsPreparedPass& OutPass) override;
+	virtual EPixelFormat GetDefaultOutputFormat() const override { return PF_B8G8R8A8; }
+	//~ End UCompositionUtilsPassBase interface
 };
 
 
@@ -173,7 +301,7 @@ private:
  *	For easier previewing and interpretation of the normal map in the composure preview window
  */
 UCLASS(BlueprintType, Blueprintable)
-class COMPOSITIONUTILS_API UCompositionUtilsNormalMapPreviewPass : public UCompositingElementTransform
+class COMPOSITIONUTILS_API UCompositionUtilsNormalMapPreviewPass : public UCompositionUtilsPassBase
 {
 	GENERATED_BODY()
 
@@ -182,7 +310,10 @@ public:
 	bool bDisplayWorldSpaceNormals = true;
 
 public:
-	virtual UTexture* ApplyTransform_Implementation(UTexture* Input, UComposurePostProcessingPassProxy* PostProcessProxy, ACameraActor* TargetCamera) override;
+	//~ Begin UCompositionUtilsPassBase interface
+	virtual bool PrepareRenderPass(FIntPoint InputSize, ACameraActor* TargetCamera, FCompUtilsPreparedPass& OutPass) override;
+	virtual EPixelFormat GetDefaultOutputFormat() const override { return PF_B8G8R8A8; }
+	//~ End UCompositionUtilsPassBase interface
 
 };
 
@@ -191,7 +322,7 @@ public:
  *	Uses an aligned depth texture to map another texture as if it had been taken from a different camera source
  */
 UCLASS(BlueprintType, Blueprintable)
-class COMPOSITIONUTILS_API UCompositionUtilsTextureMappingPass : public UCompositingElementTransform
+class COMPOSITIONUTILS_API UCompositionUtilsTextureMappingPass : public UCompositionUtilsPassBase
 {
 	GENERATED_BODY()
 
@@ -200,7 +331,13 @@ public:
 	FName AlignedDepthPassName;
 
 public:
-	virtual UTexture* ApplyTransform_Implementation(UTexture* Input, UComposurePostProcessingPassProxy* PostProcessProxy, ACameraActor* TargetCamera) override;
+	//~ Begin UCompositionUtilsPassBase interface
+	virtual bool PrepareRenderPass(FIntPoint InputSize, ACameraActor* TargetCamera, FCompUtilsPreparedPass& OutPass) override;
+	//~ End UCompositionUtilsPassBase interface
+
+	//~ Begin ICompUtilsPassDependencies interface
+	virtual void GetReferencedPassNames(TArray<FName>& OutPassNames) const override { OutPassNames.Add(AlignedDepthPassName); }
+	//~ End ICompUtilsPassDependencies interface
 
 };
 
@@ -209,7 +346,7 @@ public:
  *	Uses an aligned depth texture to map another texture as if it had been taken from a different camera source
  */
 UCLASS(BlueprintType, Blueprintable)
-class COMPOSITIONUTILS_API UCompositionUtilsCompareTexturesPass : public UCompositingElementTransform
+class COMPOSITIONUTILS_API UCompositionUtilsCompareTexturesPass : public UCompositingElementTransform, public ICompUtilsPassDependencies
 {
 	GENERATED_BODY()
 
@@ -226,4 +363,10 @@ public:
 public:
 	virtual UTexture* ApplyTransform_Implementation(UTexture* Input, UComposurePostProcessingPassProxy* PostProcessProxy, ACameraActor* TargetCamera) override;
 
+	//~ Begin ICompUtilsPassDependencies interface
+	// Only the texture that is shown is read, so the work producing the other one is skipped
+	virtual bool ConsumesInput() const override { return false; }
+	virtual void GetReferencedPassNames(TArray<FName>& OutPassNames) const override;
+	//~ End ICompUtilsPassDependencies interface
+
 };
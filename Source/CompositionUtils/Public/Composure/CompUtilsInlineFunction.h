@@ -0,0 +1,123 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+#include <type_traits>
+
+
+template <typename FuncType, uint32 InlineSize>
+class TCompUtilsInlineFunction;
+
+/**
+ * Move-only callable like TUniqueFunction, which stores its functor inline instead of on the heap
+ *
+ * Functors that don't fit into InlineSize bytes fail to compile, rather than silently falling back to an allocation.
+ * Like other UE containers, the functor is assumed to be bitwise relocatable when the function is moved around by a TArray.
+ */
+template <typename Ret, typename... ParamTypes, uint32 InlineSize>
+class TCompUtilsInlineFunction<Ret(ParamTypes...), InlineSize>
+{
+public:
+	TCompUtilsInlineFunction() = default;
+	TCompUtilsInlineFunction(TYPE_OF_NULLPTR) {}
+
+	template <typename FunctorType, typename = std::enable_if_t<!std::is_same_v<std::decay_t<FunctorType>, TCompUtilsInlineFunction>>>
+	TCompUtilsInlineFunction(FunctorType&& Functor)
+	{
+		Bind(Forward<FunctorType>(Functor));
+	}
+
+	TCompUtilsInlineFunction(TCompUtilsInlineFunction&& Other)
+	{
+		MoveFrom(Other);
+	}
+
+	TCompUtilsInlineFunction& operator=(TCompUtilsInlineFunction&& Other)
+	{
+		if (this != &Other)
+		{
+			Reset();
+			MoveFrom(Other);
+		}
+		return *this;
+	}
+
+	template <typename FunctorType, typename = std::enable_if_t<!std::is_same_v<std::decay_t<FunctorType>, TCompUtilsInlineFunction>>>
+	TCompUtilsInlineFunction& operator=(FunctorType&& Functor)
+	{
+		Reset();
+		Bind(Forward<FunctorType>(Functor));
+		return *this;
+	}
+
+	TCompUtilsInlineFunction(const TCompUtilsInlineFunction&) = delete;
+	TCompUtilsInlineFunction& operator=(const TCompUtilsInlineFunction&) = delete;
+
+	~TCompUtilsInlineFunction()
+	{
+		Reset();
+	}
+
+	void Reset()
+	{
+		if (Ops)
+		{
+			Ops->Destroy(Storage);
+			Ops = nullptr;
+		}
+	}
+
+	explicit operator bool() const { return Ops != nullptr; }
+
+	Ret operator()(ParamTypes... Params)
+	{
+		check(Ops);
+		return Ops->Call(Storage, Forward<ParamTypes>(Params)...);
+	}
+
+private:
+	struct FOps
+	{
+		Ret (*Call)(void* Functor, ParamTypes&&... Params);
+		void (*Move)(void* Destination, void* Source);
+		void (*Destroy)(void* Functor);
+	};
+
+	template <typename FunctorType>
+	static const FOps* GetOps()
+	{
+		static const FOps Ops =
+		{
+			[](void* Functor, ParamTypes&&... Params) -> Ret { return (*static_cast<FunctorType*>(Functor))(Forward<ParamTypes>(Params)...); },
+			[](void* Destination, void* Source) { new (Destination) FunctorType(MoveTemp(*static_cast<FunctorType*>(Source))); },
+			[](void* Functor) { static_cast<FunctorType*>(Functor)->~FunctorType(); }
+		};
+		return &Ops;
+	}
+
+	template <typename FunctorType>
+	void Bind(FunctorType&& Functor)
+	{
+		using FDecayedFunctor = std::decay_t<FunctorType>;
+		static_assert(sizeof(FDecayedFunctor) <= InlineSize, "Functor does not fit into the inline storage of TCompUtilsInlineFunction, capture less or increase InlineSize");
+		static_assert(alignof(FDecayedFunctor) <= Alignment, "Functor is aligned more strictly than the inline storage of TCompUtilsInlineFunction");
+
+		new (Storage) FDecayedFunctor(Forward<FunctorType>(Functor));
+		Ops = GetOps<FDecayedFunctor>();
+	}
+
+	void MoveFrom(TCompUtilsInlineFunction& Other)
+	{
+		if (Other.Ops)
+		{
+			Other.Ops->Move(Storage, Other.Storage);
+			Ops = Other.Ops;
+			Other.Reset();
+		}
+	}
+
+	static constexpr uint32 Alignment = 16;
+
+	alignas(Alignment) uint8 Storage[InlineSize];
+	const FOps* Ops = nullptr;
+};
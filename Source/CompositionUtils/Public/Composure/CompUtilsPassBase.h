@@ -0,0 +1,212 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+#include "CompositingElements/CompositingElementPasses.h"
+#include "Hash/CityHash.h"
+#include "RenderGraphFwd.h"
+#include "Engine/TextureRenderTarget2D.h"
+
+#include "CompUtilsCameraData.h"
+#include "Composure/CompUtilsInlineFunction.h"
+#include "Composure/CompUtilsPassDependencies.h"
+
+#include "CompUtilsPassBase.generated.h"
+
+
+/**
+ * A CompUtils pass that has been prepared on the game thread, ready to be recorded into a render graph
+ */
+struct FCompUtilsPreparedPass
+{
+	// Must point to a string literal, used to name the event scope of the pass
+	const TCHAR* Name = TEXT("");
+
+	FIntPoint OutputSize = FIntPoint::ZeroValue;
+	EPixelFormat OutputFormat = PF_FloatRGBA;
+
+	// Records the passes on the render thread, reading from InTexture and writing to OutTexture
+	// Must only capture data that is safe to access from the render thread
+	// Captures are stored inline, so that preparing a pass doesn't allocate, see RecordInlineSize
+	static constexpr uint32 RecordInlineSize = 1536;
+	TCompUtilsInlineFunction<void(FRDGBuilder& GraphBuilder, FRDGTextureRef InTexture, FRDGTextureRef OutTexture), RecordInlineSize> Record;
+
+	// Hash of everything besides the input that the output depends on, see FCompUtilsPassStateHash
+	// Left unset if the output must be recomputed every frame, e.g. because it depends on the rendered scene
+	TOptional<uint64> StateHash;
+};
+
+// Prepared passes of a chain, kept inline so that preparing a chain doesn't allocate either
+using FCompUtilsPreparedPasses = TArray<FCompUtilsPreparedPass, TInlineAllocator<8>>;
+
+
+/**
+ * Accumulates the state that the output of a prepared pass depends on
+ * While neither this state nor the input of a pass change, the pass hands on its previous output instead of executing again
+ * The hash is 64-bit, as a collision would silently hand on a stale output
+ */
+struct COMPOSITIONUTILS_API FCompUtilsPassStateHash
+{
+public:
+	// Hashes the bytes of plain data, e.g. scalars, vectors and matrices
+	template <typename T>
+	void Add(const T& Value)
+	{
+		static_assert(std::is_trivially_copyable_v<T>, "Only plain data can be hashed by value");
+		Hash = CityHash64WithSeed(reinterpret_cast<const char*>(&Value), sizeof(T), Hash);
+	}
+
+	void AddCamera(const FCompUtilsCameraIntrinsicData& Camera);
+
+	// Textures whose contents aren't tracked, see CompositionUtils::GetTextureRevision, make the whole state untracked
+	void AddTexture(UTexture* Texture);
+
+	// Stores the hash in the pass, if all of the state is tracked
+	void Finish(FCompUtilsPreparedPass& Pass) const;
+
+	uint64 Get() const { return Hash; }
+
+private:
+	uint64 Hash = 0;
+	bool bTracked = true;
+};
+
+
+/**
+ * Output of the last execution of a pass, handed on while its input and state are unchanged
+ * Outputs that are handed on in later frames can't come from the render target pool, so they are rendered into a persistent target
+ */
+USTRUCT()
+struct COMPOSITIONUTILS_API FCompUtilsExecutionCache
+{
+	GENERATED_BODY()
+
+public:
+	// Returns the previous output if it was computed with the same execution hash
+	UTexture* Find(const TOptional<uint64>& ExecutionHash) const;
+
+	// Must only be called once per frame, see HasWrittenPersistentTargetThisFrame
+	UTextureRenderTarget2D* GetPersistentTarget(UObject* Outer, FIntPoint Size, EPixelFormat Format);
+
+	// Transforms may be applied more than once per frame, e.g. when an element is rendered for several cameras
+	// Only the first application of a frame can render into the persistent target, later ones must use a pooled target
+	// so as not to overwrite the output that was handed on by the first
+	bool HasWrittenPersistentTargetThisFrame() const { return LastWriteFrame == GFrameCounter; }
+
+	void Store(const TOptional<uint64>& ExecutionHash, UTexture* Output);
+
+	void Reset();
+
+private:
+	UPROPERTY(Transient)
+	TObjectPtr<UTextureRenderTarget2D> PersistentTarget;
+
+	UPROPERTY(Transient)
+	TObjectPtr<UTexture> LastOutput;
+
+	TOptional<uint64> LastExecutionHash;
+	uint64 LastWriteFrame = MAX_uint64;
+};
+
+
+/**
+ * Pixel format of the output of a CompUtils pass
+ */
+UENUM(BlueprintType)
+enum class ECompUtilsPassOutputFormat : uint8
+{
+	Default		UMETA(ToolTip = "Format suited to the pass, e.g. 8-bit for debug visualizations and 16-bit float for depth"),
+	RGBA8		UMETA(DisplayName = "RGBA8", ToolTip = "8-bit colour and alpha, clamped to [0, 1]"),
+	RGB10A2		UMETA(DisplayName = "RGB10A2", ToolTip = "10-bit colour clamped to [0, 1], with only 2 bits of alpha"),
+	FloatRGBA	UMETA(DisplayName = "Float RGBA (16-bit)"),
+};
+
+
+/**
+ * Base class for CompUtils transform passes
+ *
+ * Derived passes only gather their parameters on the game thread and describe how to record their work.
+ * Applied on its own, a pass records into its own render graph, with its output materialised in a render target.
+ * Inside a UCompositionUtilsPassChain, it is recorded into a graph shared with the rest of the chain instead.
+ * Passes whose outputs nothing reads are skipped, see CompositionUtils::IsPassOutputUsed.
+ */
+UCLASS(Abstract)
+class COMPOSITIONUTILS_API UCompositionUtilsPassBase : public UCompositingElementTransform, public ICompUtilsPassDependencies
+{
+	GENERATED_BODY()
+
+public:
+	// Ignored by depth passes, which always output 16-bit float depth
+	UPROPERTY(EditAnywhere, AdvancedDisplay, BlueprintReadWrite, Category = "Compositing Pass|Output", meta = (EditCondition = "bEnabled"))
+	ECompUtilsPassOutputFormat OutputFormat = ECompUtilsPassOutputFormat::Default;
+
+	// Resolution of the output relative to the input
+	// Ignored by passes whose output must match their input pixel for pixel, such as depth alignment
+	UPROPERTY(EditAnywhere, AdvancedDisplay, BlueprintReadWrite, Category = "Compositing Pass|Output", meta = (EditCondition = "bEnabled", ClampMin = "0.1", ClampMax = "1.0"))
+	float OutputResolutionScale = 1.0f;
+
+public:
+	// Returns false if the input should be passed through unchanged
+	virtual bool PrepareRenderPass(FIntPoint InputSize, ACameraActor* TargetCamera, FCompUtilsPreparedPass& OutPass) PURE_VIRTUAL(UCompositionUtilsPassBase::PrepareRenderPass, return false;);
+
+	// Format of the output when OutputFormat is Default
+	virtual EPixelFormat GetDefaultOutputFormat() const { return PF_FloatRGBA; }
+
+	// Whether OutputFormat and OutputResolutionScale are ignored
+	virtual bool IsOutputFormatFixed() const { return false; }
+	virtual bool IsOutputResolutionFixed() const { return false; }
+
+	// Applies OutputFormat and OutputResolutionScale to a pass prepared by this pass
+	void ApplyOutputSettings(FCompUtilsPreparedPass& Pass) const;
+
+	//~ Begin UCompositingElementTransform interface
+	virtual UTexture* ApplyTransform_Implementation(UTexture* Input, UComposurePostProcessingPassProxy* PostProcessProxy, ACameraActor* TargetCamera) override;
+	//~ End UCompositingElementTransform interface
+
+	//~ Begin UCompositingElementPass interface
+	virtual void OnDisabled_Implementation() override;
+	//~ End UCompositingElementPass interface
+
+private:
+	UPROPERTY(Transient)
+	FCompUtilsExecutionCache ExecutionCache;
+};
+
+
+/**
+ * Records consecutive CompUtils passes into a single render graph
+ *
+ * Intermediate outputs are transient render graph textures, so their memory can be aliased and unused work culled.
+ * Only the output of the final pass is materialised as a render target.
+ * As a consequence, intermediate outputs cannot be looked up by name from other passes, only the output of the chain itself.
+ */
+UCLASS(BlueprintType, Blueprintable)
+class COMPOSITIONUTILS_API UCompositionUtilsPassChain : public UCompositingElementTransform, public ICompUtilsPassDependencies
+{
+	GENERATED_BODY()
+
+public:
+	UPROPERTY(EditAnywhere, Instanced, BlueprintReadWrite, Category = "Compositing Pass", meta = (DisplayAfter = "PassName", EditCondition = "bEnabled"))
+	TArray<TObjectPtr<UCompositionUtilsPassBase>> Passes;
+
+public:
+	// Prepares the enabled passes of the chain, each with the output size of the previous one
+	// Returns the output size of the final pass
+	FIntPoint PreparePasses(FIntPoint InputSize, ACameraActor* TargetCamera, FCompUtilsPreparedPasses& OutPasses);
+
+	//~ Begin UCompositingElementTransform interface
+	virtual UTexture* ApplyTransform_Implementation(UTexture* Input, UComposurePostProcessingPassProxy* PostProcessProxy, ACameraActor* TargetCamera) override;
+	//~ End UCompositingElementTransform interface
+
+	//~ Begin UCompositingElementPass interface
+	virtual void OnDisabled_Implementation() override;
+	//~ End UCompositingElementPass interface
+
+	//~ Begin ICompUtilsPassDependencies interface
+	virtual void GetReferencedPassNames(TArray<FName>& OutPassNames) const override;
+	//~ End ICompUtilsPassDependencies interface
+
+private:
+	UPROPERTY(Transient)
+	FCompUtilsExecutionCache ExecutionCache;
+};
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/Interface.h"
+
+#include "CompUtilsPassDependencies.generated.h"
+
+
+class ACompositingElement;
+class UCompositingElementTransform;
+
+UINTERFACE(MinimalAPI, meta = (CannotImplementInterfaceInBlueprint))
+class UCompUtilsPassDependencies : public UInterface
+{
+	GENERATED_BODY()
+};
+
+/**
+ * Describes which results a transform pass reads, so that passes whose outputs nothing reads can be skipped
+ * Transform passes that don't implement this interface are assumed to read their input and every named result before them.
+ */
+class COMPOSITIONUTILS_API ICompUtilsPassDependencies
+{
+	GENERATED_BODY()
+public:
+
+	// Whether the output of the pass depends on its input, rather than only on results looked up by name
+	virtual bool ConsumesInput() const { return true; }
+
+	// Names of the results of earlier passes that the pass looks up, see ICompositingTextureLookupTable
+	virtual void GetReferencedPassNames(TArray<FName>& OutPassNames) const {}
+
+};
+
+
+namespace CompositionUtils
+{
+	// Transform passes of an element in the order they are applied, without copying them like ACompositingElement::GetTransformsList
+	COMPOSITIONUTILS_API TConstArrayView<TObjectPtr<UCompositingElementTransform>> GetTransformPasses(const ACompositingElement* Element);
+
+	// Whether anything reads the output of a transform pass this frame:
+	// the next pass in the chain of its element, a later pass looking it up by name, or the injection of a parent CompUtils capture.
+	// The output of the last pass of an element is always used.
+	// Must be called on the game thread
+	COMPOSITIONUTILS_API bool IsPassOutputUsed(const UCompositingElementTransform* Pass);
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+
+class UTexture;
+
+
+// When the contents of a texture were sampled by their camera, on the FPlatformTime::Seconds clock, and the engine frame they arrived on
+struct FCompUtilsSampleTime
+{
+	double Seconds = 0.0;
+	uint64 Frame = 0;
+};
+
+/**
+ * Tracks the revision of the contents of textures, so that CompUtils passes can skip work when their inputs haven't changed
+ *
+ * Only textures that are known to be written to at a lower rate than the engine renders at are tracked:
+ * persistent outputs of CompUtils passes, media textures, and textures marked by their producers through BumpTextureRevision.
+ * Any other texture must be assumed to change every frame.
+ */
+namespace CompositionUtils
+{
+	// Returns false if the texture isn't tracked
+	// Must be called on the game thread
+	COMPOSITIONUTILS_API bool GetTextureRevision(UTexture* Texture, uint64& OutRevision);
+
+	// Marks new contents of a texture, and starts tracking it if it wasn't already
+	// To be called by producers of textures, e.g. camera plugins, whenever they write a new frame into a texture
+	// Must be called on the game thread
+	COMPOSITIONUTILS_API void BumpTextureRevision(UTexture* Texture);
+
+	// Returns false if the sample time of the texture isn't known
+	// Media textures report the time their latest sample arrived at the media player
+	// Must be called on the game thread
+	COMPOSITIONUTILS_API bool GetTextureSampleTime(UTexture* Texture, FCompUtilsSampleTime& OutSampleTime);
+
+	// Tags the contents of a texture with the time they were sampled at
+	// To be called by producers of textures along with BumpTextureRevision, so that the latency from sample to composite can be measured
+	// Must be called on the game thread
+	COMPOSITIONUTILS_API void SetTextureSampleTime(UTexture* Texture, const FCompUtilsSampleTime& SampleTime);
+
+	// Hands on the sample time of Source to Target, which is derived from it, or clears it if Source has none
+	// Targets from the render target pool are handed to other users once released, so their tag must only hold for the current frame
+	// Must be called on the game thread
+	COMPOSITIONUTILS_API void PropagateTextureSampleTime(UTexture* Source, UTexture* Target, bool bCurrentFrameOnly);
+}
@@ -8,6 +8,17 @@
 #include "ReprojectionCalibration.generated.h"
 
 
+/**
+ * A frame of a reprojection target that is already held in CPU memory
+ */
+struct FCompUtilsCPUFrame
+{
+	// Tightly packed BGRA8 pixels
+	TArray<FColor> Pixels;
+	FIntPoint Size = FIntPoint::ZeroValue;
+};
+
+
 /**
  * Composition Utils: Base class for encapsulating a target for reprojection (either as a source or destination)
  * Implements ICompUtilsCameraInterface, as a reprojection target must expose intrinsic properties of a camera
@@ -20,9 +31,15 @@ public:
 
 	// Interface that allows derived classes to provide their own targets
 	virtual TObjectPtr<UTexture> GetTexture() { return nullptr; }
+
+	// Optionally allows derived classes to provide their latest frame directly from CPU memory, avoiding a GPU round trip
+	// If no frame is available, false is returned and the texture must be read back instead
+	virtual bool GetCPUFrame(FCompUtilsCPUFrame& OutFrame) { return false; }
 };
 
 
+DECLARE_MULTICAST_DELEGATE_OneParam(FOnReprojectionCalibrationChanged, class UReprojectionCalibration*);
+
 /**
  * Composition Utils: Contains calibrated data to enable reprojection from a source camera to a destination camera
  */
@@ -33,6 +50,18 @@ class COMPOSITIONUTILS_API UReprojectionCalibration : public UObject
 public:
 	UReprojectionCalibration();
 
+	// Sets the calibrated nodal offset, and notifies users of the calibration of the change
+	void SetExtrinsicTransform(const FTransform& InTransform);
+
+	// Broadcast whenever the calibrated data changes, so that users can update cached copies of it
+	FOnReprojectionCalibrationChanged OnCalibrationChanged;
+
+	//~ Begin UObject interface
+#if WITH_EDITOR
+	virtual void PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent) override;
+#endif
+	//~ End UObject interface
+
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category="Calibrated Data")
 	FTransform ExtrinsicTransform;
 
@@ -49,6 +78,36 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Calibration", DisplayName = "Checkerboard Size (cm)",
 		meta = (ToolTip = "The side length of each square in the checkerboard, measured in centimetres. E.g. a checkerboard with squares 25mm in side length would be 2.5."))
 	float CheckerboardSize;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Calibration|Detection",
+		meta = (ToolTip = "Detect the checkerboard in a downsampled copy of each feed, then refine the corners at full resolution. Much faster for high resolution feeds."))
+	bool bUseCoarseToFineDetection;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Calibration|Detection", meta = (EditCondition = "bUseCoarseToFineDetection", ClampMin = "2", ClampMax = "8"))
+	int32 CoarseDetectionDownsampleFactor;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Calibration|Detection",
+		meta = (ToolTip = "Find candidate checkerboard corners on the GPU, then only read back and search the region of each feed containing them. Much faster when the checkerboard covers a small part of the frame."))
+	bool bUseCornerPrefilter;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Calibration|Detection", meta = (EditCondition = "bUseCornerPrefilter", ClampMin = "0.0001", ClampMax = "0.25",
+		ToolTip = "Minimum saddle response for a pixel to be a corner candidate. Lower this for low contrast checkerboards."))
+	float CornerPrefilterThreshold;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Calibration|Auto Capture", DisplayName = "Capture Rate (Hz)", meta = (ClampMin = "0.1", ClampMax = "30.0"))
+	float AutoCaptureRate;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Calibration|Auto Capture", DisplayName = "Min Rotation Difference (deg)",
+		meta = (ClampMin = "0.0", ToolTip = "A sample is only accepted if the checkerboard is rotated or moved at least this much relative to every accepted sample."))
+	float AutoCaptureMinRotationDifference;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Calibration|Auto Capture", DisplayName = "Min Translation Difference (cm)",
+		meta = (ClampMin = "0.0", ToolTip = "A sample is only accepted if the checkerboard is rotated or moved at least this much relative to every accepted sample."))
+	float AutoCaptureMinTranslationDifference;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Calibration|Auto Capture", DisplayName = "Max Reprojection Error (px)",
+		meta = (ClampMin = "0.0", ToolTip = "A sample is only accepted if the reprojection error in both feeds is below this."))
+	float AutoCaptureMaxReprojectionError;
 };
 
 
@@ -68,5 +127,11 @@ public:
 
 	//~ Begin UReprojectionCalibrationTarget Interface
 	virtual TObjectPtr<UTexture> GetTexture() override;
+	virtual bool GetCPUFrame(FCompUtilsCPUFrame& OutFrame) override;
 	//~ End UReprojectionCalibrationTarget Interface
+
+private:
+	// Holds on to the most recent video sample of the player, which is registered with the first request for a CPU frame
+	TSharedPtr<class FCompUtilsLatestMediaSampleSink, ESPMode::ThreadSafe> SampleSink;
+	TWeakObjectPtr<class UMediaPlayer> SampleSinkPlayer;
 };
@@ -0,0 +1,230 @@
+#include "CalibrationSession.h"
+
+#include "CompositionUtilsEditor.h"
+#include "Async/MappedFileHandle.h"
+#include "HAL/PlatformFileManager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+
+
+void FCalibrationSession::Reset()
+{
+	SourceCamera = FCompUtilsCameraIntrinsicData();
+	DestinationCamera = FCompUtilsCameraIntrinsicData();
+	Samples.Reset();
+}
+
+bool FCalibrationSession::SaveToFile(const FString& Filename) const
+{
+	uint32 NumPoints = 0;
+	for (const FCalibrationSolver::FSample& Sample : Samples)
+	{
+		NumPoints += Sample.ObjectPoints.Num();
+	}
+
+	const int64 Size = sizeof(FHeader) + Samples.Num() * sizeof(FSampleRecord) + NumPoints * sizeof(FPointRecord);
+	TArray<uint8> Data;
+	Data.SetNumZeroed(Size);
+
+	FHeader* Header = reinterpret_cast<FHeader*>(Data.GetData());
+	Header->Magic = Magic;
+	Header->Version = Version;
+	Header->NumSamples = Samples.Num();
+	Header->NumPoints = NumPoints;
+	Header->Cameras[0] = ToRecord(SourceCamera);
+	Header->Cameras[1] = ToRecord(DestinationCamera);
+
+	FSampleRecord* SampleRecords = reinterpret_cast<FSampleRecord*>(Header + 1);
+	FPointRecord* PointRecords = reinterpret_cast<FPointRecord*>(SampleRecords + Samples.Num());
+
+	uint32 FirstPoint = 0;
+	for (int32 SampleIndex = 0; SampleIndex < Samples.Num(); SampleIndex++)
+	{
+		const FCalibrationSolver::FSample& Sample = Samples[SampleIndex];
+		check(Sample.SourceCorners.Num() == Sample.ObjectPoints.Num() && Sample.DestinationCorners.Num() == Sample.ObjectPoints.Num());
+
+		FSampleRecord& Record = SampleRecords[SampleIndex];
+		Record.FirstPoint = FirstPoint;
+		Record.NumPoints = Sample.ObjectPoints.Num();
+
+		const FQuat BoardRotation = Sample.BoardPose.GetRotation();
+		const FVector BoardTranslation = Sample.BoardPose.GetTranslation();
+		Record.BoardRotation[0] = BoardRotation.X;
+		Record.BoardRotation[1] = BoardRotation.Y;
+		Record.BoardRotation[2] = BoardRotation.Z;
+		Record.BoardRotation[3] = BoardRotation.W;
+		Record.BoardTranslation[0] = BoardTranslation.X;
+		Record.BoardTranslation[1] = BoardTranslation.Y;
+		Record.BoardTranslation[2] = BoardTranslation.Z;
+
+		for (int32 PointIndex = 0; PointIndex < Sample.ObjectPoints.Num(); PointIndex++)
+		{
+			FPointRecord& Point = PointRecords[FirstPoint + PointIndex];
+			Point.ObjectPoint[0] = Sample.ObjectPoints[PointIndex].X;
+			Point.ObjectPoint[1] = Sample.ObjectPoints[PointIndex].Y;
+			Point.ObjectPoint[2] = Sample.ObjectPoints[PointIndex].Z;
+			Point.SourceCorner[0] = Sample.SourceCorners[PointIndex].X;
+			Point.SourceCorner[1] = Sample.SourceCorners[PointIndex].Y;
+			Point.DestinationCorner[0] = Sample.DestinationCorners[PointIndex].X;
+			Point.DestinationCorner[1] = Sample.DestinationCorners[PointIndex].Y;
+		}
+
+		FirstPoint += Sample.ObjectPoints.Num();
+	}
+
+	return FFileHelper::SaveArrayToFile(Data, *Filename);
+}
+
+bool FCalibrationSession::LoadFromFile(const FString& Filename, FCalibrationSession& OutSession)
+{
+	IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+
+	TUniquePtr<IMappedFileHandle> MappedFile(PlatformFile.OpenMapped(*Filename));
+	if (MappedFile.IsValid() && MappedFile->GetFileSize() > 0)
+	{
+		TUniquePtr<IMappedFileRegion> Region(MappedFile->MapRegion(0, MappedFile->GetFileSize()));
+		if (Region.IsValid())
+		{
+			return Parse(Region->GetMappedPtr(), Region->GetMappedSize(), OutSession);
+		}
+	}
+
+	// Not all platforms support memory mapping
+	TArray<uint8> Data;
+	if (!FFileHelper::LoadFileToArray(Data, *Filename))
+	{
+		UE_LOG(LogCompositionUtilsEditor, Error, TEXT("Failed to read calibration session '%s'"), *Filename);
+		return false;
+	}
+
+	return Parse(Data.GetData(), Data.Num(), OutSession);
+}
+
+bool FCalibrationSession::Parse(const uint8* Data, int64 Size, FCalibrationSession& OutSession)
+{
+	if (Size < static_cast<int64>(sizeof(FHeader)))
+	{
+		UE_LOG(LogCompositionUtilsEditor, Error, TEXT("Calibration session is truncated"));
+		return false;
+	}
+
+	const FHeader* Header = reinterpret_cast<const FHeader*>(Data);
+	if (Header->Magic == BYTESWAP_ORDER32(Magic))
+	{
+		UE_LOG(LogCompositionUtilsEditor, Error, TEXT("Calibration session was written on a platform with a different byte order"));
+		return false;
+	}
+	if (Header->Magic != Magic)
+	{
+		UE_LOG(LogCompositionUtilsEditor, Error, TEXT("File is not a calibration session"));
+		return false;
+	}
+	if (Header->Version != Version)
+	{
+		UE_LOG(LogCompositionUtilsEditor, Error, TEXT("Unsupported calibration session version %u (expected %u)"), Header->Version, Version);
+		return false;
+	}
+
+	const int64 ExpectedSize = sizeof(FHeader) + static_cast<int64>(Header->NumSamples) * sizeof(FSampleRecord) + static_cast<int64>(Header->NumPoints) * sizeof(FPointRecord);
+	if (Size < ExpectedSize)
+	{
+		UE_LOG(LogCompositionUtilsEditor, Error, TEXT("Calibration session is truncated"));
+		return false;
+	}
+
+	const FSampleRecord* SampleRecords = reinterpret_cast<const FSampleRecord*>(Header + 1);
+	const FPointRecord* PointRecords = reinterpret_cast<const FPointRecord*>(SampleRecords + Header->NumSamples);
+
+	OutSession.Reset();
+	if (!FromRecord(Header->Cameras[0], OutSession.SourceCamera) || !FromRecord(Header->Cameras[1], OutSession.DestinationCamera))
+	{
+		UE_LOG(LogCompositionUtilsEditor, Error, TEXT("Calibration session has an invalid camera type"));
+		return false;
+	}
+	OutSession.Samples.Reserve(Header->NumSamples);
+
+	for (uint32 SampleIndex = 0; SampleIndex < Header->NumSamples; SampleIndex++)
+	{
+		const FSampleRecord& Record = SampleRecords[SampleIndex];
+		if (static_cast<uint64>(Record.FirstPoint) + Record.NumPoints > Header->NumPoints)
+		{
+			UE_LOG(LogCompositionUtilsEditor, Error, TEXT("Calibration session sample %u references points out of range"), SampleIndex);
+			return false;
+		}
+
+		FCalibrationSolver::FSample& Sample = OutSession.Samples.AddDefaulted_GetRef();
+		Sample.BoardPose = FTransform(
+			FQuat(Record.BoardRotation[0], Record.BoardRotation[1], Record.BoardRotation[2], Record.BoardRotation[3]),
+			FVector(Record.BoardTranslation[0], Record.BoardTranslation[1], Record.BoardTranslation[2]));
+
+		Sample.ObjectPoints.Reserve(Record.NumPoints);
+		Sample.SourceCorners.Reserve(Record.NumPoints);
+		Sample.DestinationCorners.Reserve(Record.NumPoints);
+
+		for (uint32 PointIndex = Record.FirstPoint; PointIndex < Record.FirstPoint + Record.NumPoints; PointIndex++)
+		{
+			const FPointRecord& Point = PointRecords[PointIndex];
+			Sample.ObjectPoints.Emplace(Point.ObjectPoint[0], Point.ObjectPoint[1], Point.ObjectPoint[2]);
+			Sample.SourceCorners.Emplace(Point.SourceCorner[0], Point.SourceCorner[1]);
+			Sample.DestinationCorners.Emplace(Point.DestinationCorner[0], Point.DestinationCorner[1]);
+		}
+	}
+
+	return true;
+}
+
+TSharedRef<FCalibrationSolver, ESPMode::ThreadSafe> FCalibrationSession::CreateSolver() const
+{
+	TSharedRef<FCalibrationSolver, ESPMode::ThreadSafe> Solver = MakeShared<FCalibrationSolver, ESPMode::ThreadSafe>();
+	Solver->SetCameras(SourceCamera, DestinationCamera);
+
+	for (const FCalibrationSolver::FSample& Sample : Samples)
+	{
+		Solver->AddSample(CopyTemp(Sample));
+	}
+
+	return Solver;
+}
+
+FString FCalibrationSession::GetSessionDirectory()
+{
+	return FPaths::ProjectSavedDir() / TEXT("CalibrationSessions");
+}
+
+FCalibrationSession::FCameraRecord FCalibrationSession::ToRecord(const FCompUtilsCameraIntrinsicData& Camera)
+{
+	FCameraRecord Record;
+	FMemory::Memzero(Record);
+
+	Record.FocalLength[0] = Camera.FocalLength.X;
+	Record.FocalLength[1] = Camera.FocalLength.Y;
+	Record.ImageCenter[0] = Camera.ImageCenter.X;
+	Record.ImageCenter[1] = Camera.ImageCenter.Y;
+	Record.Type = static_cast<uint32>(Camera.Type);
+
+	Record.NumDistortionParams = Camera.DistortionParams.Num();
+	for (uint32 i = 0; i < Record.NumDistortionParams; i++)
+	{
+		Record.DistortionParams[i] = Camera.DistortionParams[i];
+	}
+
+	return Record;
+}
+
+bool FCalibrationSession::FromRecord(const FCameraRecord& Record, FCompUtilsCameraIntrinsicData& OutCamera)
+{
+	if (Record.Type > static_cast<uint32>(ECompUtilsCameraType::CameraType_Physical))
+	{
+		return false;
+	}
+
+	OutCamera.FocalLength = FVector2D(Record.FocalLength[0], Record.FocalLength[1]);
+	OutCamera.ImageCenter = FVector2D(Record.ImageCenter[0], Record.ImageCenter[1]);
+	OutCamera.Type = static_cast<ECompUtilsCameraType>(Record.Type);
+
+	const uint32 NumDistortionParams = FMath::Min<uint32>(Record.NumDistortionParams, MaxDistortionParams);
+	OutCamera.DistortionParams.Reset();
+	OutCamera.DistortionParams.Append(Record.DistortionParams, NumDistortionParams);
+
+	return true;
+}
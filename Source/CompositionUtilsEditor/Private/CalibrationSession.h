@@ -0,0 +1,85 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+#include "CompUtilsCameraData.h"
+#include "CalibrationSolver.h"
+
+
+/**
+ * All data collected during a calibration session that is required to re-run the solve offline
+ *
+ * Sessions are stored in a compact binary format made up of fixed size records, such that a file can be memory mapped and read in place:
+ *   FHeader | FSampleRecord[NumSamples] | FPointRecord[NumPoints]
+ * Values are stored in the native byte order of the platform that wrote the file.
+ * Files written with the other byte order are recognized by their byte swapped magic and rejected rather than swapped.
+ */
+struct FCalibrationSession
+{
+	FCompUtilsCameraIntrinsicData SourceCamera;
+	FCompUtilsCameraIntrinsicData DestinationCamera;
+	TArray<FCalibrationSolver::FSample> Samples;
+
+	void Reset();
+
+	bool SaveToFile(const FString& Filename) const;
+	// Maps the file into memory if the platform supports it, otherwise it is read in full
+	static bool LoadFromFile(const FString& Filename, FCalibrationSession& OutSession);
+
+	// Creates a solver populated with all samples of the session
+	TSharedRef<FCalibrationSolver, ESPMode::ThreadSafe> CreateSolver() const;
+
+	// Directory that the calibration editor writes sessions to
+	static FString GetSessionDirectory();
+
+private:
+	static constexpr uint32 Magic = 0x53435543;	// 'CUCS'
+	static constexpr uint32 Version = 1;
+
+	static constexpr int32 MaxDistortionParams = FCompUtilsCameraIntrinsicData::MaxDistortionParams;
+
+	struct FCameraRecord
+	{
+		double FocalLength[2];
+		double ImageCenter[2];
+		uint32 Type;
+		uint32 NumDistortionParams;
+		float DistortionParams[MaxDistortionParams];
+	};
+	static_assert(sizeof(FCameraRecord) == 96, "Calibration session layout must not change without bumping the version");
+
+	struct FHeader
+	{
+		uint32 Magic;
+		uint32 Version;
+		uint32 NumSamples;
+		uint32 NumPoints;
+		FCameraRecord Cameras[2];
+	};
+	static_assert(sizeof(FHeader) == 208, "Calibration session layout must not change without bumping the version");
+
+	struct FSampleRecord
+	{
+		// Index of the first point of this sample in the point records
+		uint32 FirstPoint;
+		uint32 NumPoints;
+		// Pose of the board relative to the source camera, see FCalibrationSolver::FSample::BoardPose
+		double BoardRotation[4];	// Quaternion X, Y, Z, W
+		double BoardTranslation[3];
+	};
+	static_assert(sizeof(FSampleRecord) == 64, "Calibration session layout must not change without bumping the version");
+
+	struct FPointRecord
+	{
+		float ObjectPoint[3];
+		float SourceCorner[2];
+		float DestinationCorner[2];
+	};
+	static_assert(sizeof(FPointRecord) == 28, "Calibration session layout must not change without bumping the version");
+
+	static FCameraRecord ToRecord(const FCompUtilsCameraIntrinsicData& Camera);
+	// Fails if the record holds values that are out of range
+	static bool FromRecord(const FCameraRecord& Record, FCompUtilsCameraIntrinsicData& OutCamera);
+
+	static bool Parse(const uint8* Data, int64 Size, FCalibrationSession& OutSession);
+};
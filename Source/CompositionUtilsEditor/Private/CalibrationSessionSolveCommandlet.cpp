@@ -0,0 +1,140 @@
+#include "CalibrationSessionSolveCommandlet.h"
+
+#include "CompositionUtilsEditor.h"
+#include "Async/ParallelFor.h"
+#include "Misc/Paths.h"
+
+#include "CalibrationSession.h"
+
+
+namespace
+{
+	template<typename T>
+	TArray<T> ParseValueList(const FString& Params, const TCHAR* Name, T DefaultValue)
+	{
+		TArray<T> Values;
+
+		FString ValueList;
+		if (FParse::Value(*Params, Name, ValueList, false))
+		{
+			TArray<FString> Tokens;
+			ValueList.ParseIntoArray(Tokens, TEXT(","));
+			for (const FString& Token : Tokens)
+			{
+				T Value;
+				LexFromString(Value, *Token.TrimStartAndEnd());
+				Values.Add(Value);
+			}
+		}
+
+		if (Values.IsEmpty())
+		{
+			Values.Add(DefaultValue);
+		}
+		return Values;
+	}
+}
+
+
+UCalibrationSessionSolveCommandlet::UCalibrationSessionSolveCommandlet()
+{
+	IsClient = false;
+	IsServer = false;
+	IsEditor = true;
+	LogToConsole = true;
+}
+
+int32 UCalibrationSessionSolveCommandlet::Main(const FString& Params)
+{
+	FString SessionPath;
+	if (!FParse::Value(*Params, TEXT("Session="), SessionPath))
+	{
+		UE_LOG(LogCompositionUtilsEditor, Error, TEXT("Missing -Session=<Path>"));
+		return 1;
+	}
+
+	if (FPaths::IsRelative(SessionPath))
+	{
+		SessionPath = FCalibrationSession::GetSessionDirectory() / SessionPath;
+	}
+
+	FCalibrationSession Session;
+	if (!FCalibrationSession::LoadFromFile(SessionPath, Session))
+		return 1;
+
+	UE_LOG(LogCompositionUtilsEditor, Display, TEXT("Loaded calibration session '%s' with %d samples"), *SessionPath, Session.Samples.Num());
+
+	const FCalibrationSolverSettings Defaults;
+	const TArray<int32> MaxIterations = ParseValueList(Params, TEXT("MaxIterations="), Defaults.MaxIterations);
+	const TArray<double> InitialLambdas = ParseValueList(Params, TEXT("InitialLambda="), Defaults.InitialLambda);
+	const TArray<double> ConvergenceThresholds = ParseValueList(Params, TEXT("ConvergenceThreshold="), Defaults.ConvergenceThreshold);
+
+	// Every combination of the given settings
+	TArray<FCalibrationSolverSettings> Settings;
+	for (int32 Iterations : MaxIterations)
+	{
+		for (double Lambda : InitialLambdas)
+		{
+			for (double Threshold : ConvergenceThresholds)
+			{
+				FCalibrationSolverSettings& Setting = Settings.AddDefaulted_GetRef();
+				Setting.MaxIterations = Iterations;
+				Setting.InitialLambda = Lambda;
+				Setting.ConvergenceThreshold = Threshold;
+			}
+		}
+	}
+
+	// Each solve gets its own solver, as solving warm-starts from and overwrites the previous solution
+	TArray<FCalibrationSolverResult> Results;
+	Results.SetNum(Settings.Num());
+
+	const double StartTime = FPlatformTime::Seconds();
+	ParallelFor(Settings.Num(), [&](int32 Index)
+	{
+		Results[Index] = Session.CreateSolver()->Solve(Settings[Index]);
+	});
+	const double TotalTimeMs = (FPlatformTime::Seconds() - StartTime) * 1000.0;
+
+	int32 BestIndex = INDEX_NONE;
+	for (int32 Index = 0; Index < Settings.Num(); Index++)
+	{
+		const FCalibrationSolverSettings& Setting = Settings[Index];
+		const FCalibrationSolverResult& Result = Results[Index];
+
+		if (!Result.bSuccess)
+		{
+			UE_LOG(LogCompositionUtilsEditor, Display, TEXT("[%d] MaxIterations=%d InitialLambda=%g ConvergenceThreshold=%g: failed"),
+				Index, Setting.MaxIterations, Setting.InitialLambda, Setting.ConvergenceThreshold);
+			continue;
+		}
+
+		UE_LOG(LogCompositionUtilsEditor, Display, TEXT("[%d] MaxIterations=%d InitialLambda=%g ConvergenceThreshold=%g: %d samples, %d iterations, %.2fms, RMS error %.4fpx (source) %.4fpx (destination), %s"),
+			Index, Setting.MaxIterations, Setting.InitialLambda, Setting.ConvergenceThreshold,
+			Result.NumSamples, Result.NumIterations, Result.SolveTimeMs, Result.SourceRMSError, Result.DestinationRMSError,
+			*Result.SourceToDestination.ToHumanReadableString());
+
+		if (!Result.RejectedSamples.IsEmpty())
+		{
+			UE_LOG(LogCompositionUtilsEditor, Warning, TEXT("[%d] Discarded %d of %d samples that could not be initialized"),
+				Index, Result.RejectedSamples.Num(), Session.Samples.Num());
+		}
+
+		const auto TotalError = [](const FCalibrationSolverResult& R) { return R.SourceRMSError + R.DestinationRMSError; };
+		if (BestIndex == INDEX_NONE || TotalError(Result) < TotalError(Results[BestIndex]))
+		{
+			BestIndex = Index;
+		}
+	}
+
+	UE_LOG(LogCompositionUtilsEditor, Display, TEXT("Ran %d solves in %.2fms"), Settings.Num(), TotalTimeMs);
+
+	if (BestIndex == INDEX_NONE)
+	{
+		UE_LOG(LogCompositionUtilsEditor, Error, TEXT("All solves failed"));
+		return 1;
+	}
+
+	UE_LOG(LogCompositionUtilsEditor, Display, TEXT("Lowest error with settings [%d]: %s"), BestIndex, *Results[BestIndex].SourceToDestination.ToString());
+	return 0;
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+
+#include "CalibrationSessionSolveCommandlet.generated.h"
+
+/**
+ * Re-solves a saved calibration session headlessly, once for every combination of the given solver settings.
+ * Solves run in parallel across all cores.
+ *
+ * Usage:
+ *   UnrealEditor-Cmd <Project> -run=CalibrationSessionSolve -Session=<Path> [-MaxIterations=50,100] [-InitialLambda=1e-3,1e-2] [-ConvergenceThreshold=1e-8]
+ * Each setting accepts a comma separated list of values. Relative session paths are resolved against the session directory.
+ */
+UCLASS()
+class UCalibrationSessionSolveCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UCalibrationSessionSolveCommandlet();
+
+	//~ Begin UCommandlet interface
+	virtual int32 Main(const FString& Params) override;
+	//~ End UCommandlet interface
+};
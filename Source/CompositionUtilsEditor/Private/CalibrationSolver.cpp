@@ -0,0 +1,455 @@
+#include "CalibrationSolver.h"
+
+#include "CompositionUtilsEditor.h"
+
+#if WITH_OPENCV
+#include "PreOpenCVHeaders.h"
+#include "opencv2/calib3d.hpp"
+#include "PostOpenCVHeaders.h"
+#endif
+
+
+void FCalibrationSolver::SetCameras(const FCompUtilsCameraIntrinsicData& InSourceCamera, const FCompUtilsCameraIntrinsicData& InDestinationCamera)
+{
+	SourceCamera = InSourceCamera;
+	DestinationCamera = InDestinationCamera;
+}
+
+void FCalibrationSolver::AddSample(FSample&& Sample)
+{
+	Samples.Add(MoveTemp(Sample));
+	SampleIndices.Add(NumAddedSamples++);
+}
+
+
+#if WITH_OPENCV
+namespace
+{
+	cv::Mat GetCameraMatrix(const FCompUtilsCameraIntrinsicData& Camera)
+	{
+		cv::Mat CameraMatrix = cv::Mat::eye(3, 3, CV_64F);
+		CameraMatrix.at<double>(0, 0) = Camera.FocalLength.X;
+		CameraMatrix.at<double>(1, 1) = Camera.FocalLength.Y;
+		CameraMatrix.at<double>(0, 2) = Camera.ImageCenter.X;
+		CameraMatrix.at<double>(1, 2) = Camera.ImageCenter.Y;
+		return CameraMatrix;
+	}
+
+	cv::Mat GetDistortionCoefficients(const FCompUtilsCameraIntrinsicData& Camera)
+	{
+		if (Camera.DistortionParams.IsEmpty())
+		{
+			return cv::Mat();
+		}
+
+		cv::Mat Coefficients(1, Camera.DistortionParams.Num(), CV_64F);
+		for (int32 i = 0; i < Camera.DistortionParams.Num(); i++)
+		{
+			Coefficients.at<double>(0, i) = Camera.DistortionParams[i];
+		}
+		return Coefficients;
+	}
+
+	// Correspondences of a sample converted to OpenCV types
+	struct FSampleData
+	{
+		std::vector<cv::Point3d> ObjectPoints;
+		std::vector<cv::Point2d> SourcePoints;
+		std::vector<cv::Point2d> DestinationPoints;
+	};
+
+	// Parameters are packed as [extrinsic rotation, extrinsic translation, board 0 rotation, board 0 translation, ...]
+	constexpr int32 ParamsPerPose = 6;
+
+	// Normal equations of a sample, which only involve the extrinsic and the board pose of that sample
+	// Together they form a block-arrow JtJ, with the extrinsic along the border and one diagonal block per board
+	struct FSampleNormals
+	{
+		cv::Matx66d ExtrinsicJtJ;	// Extrinsic x extrinsic
+		cv::Matx66d CrossJtJ;		// Extrinsic x board
+		cv::Matx66d BoardJtJ;		// Board x board
+		cv::Vec6d ExtrinsicJtr;
+		cv::Vec6d BoardJtr;
+	};
+
+	// Accumulates the squared reprojection error of a sample in both feeds,
+	// and optionally computes its normal equations with respect to the extrinsic and the board pose of the sample.
+	void EvaluateSample(
+		const FSampleData& Data,
+		const cv::Mat& Params,
+		int32 SampleIndex,
+		const cv::Mat& SourceCameraMatrix, const cv::Mat& SourceDistortion,
+		const cv::Mat& DestinationCameraMatrix, const cv::Mat& DestinationDistortion,
+		FSampleNormals* Normals,
+		double& SourceErrorSq,
+		double& DestinationErrorSq)
+	{
+		const int32 BoardOffset = ParamsPerPose * (SampleIndex + 1);
+
+		const cv::Mat ExtrinsicRotation = Params.rowRange(0, 3);
+		const cv::Mat ExtrinsicTranslation = Params.rowRange(3, 6);
+		const cv::Mat BoardRotation = Params.rowRange(BoardOffset, BoardOffset + 3);
+		const cv::Mat BoardTranslation = Params.rowRange(BoardOffset + 3, BoardOffset + 6);
+
+		// Source camera observes the board directly
+		std::vector<cv::Point2d> SourceProjected;
+		cv::Mat SourceJacobian;
+		cv::projectPoints(Data.ObjectPoints, BoardRotation, BoardTranslation, SourceCameraMatrix, SourceDistortion, SourceProjected, SourceJacobian);
+
+		// Destination camera observes the board through the extrinsic
+		cv::Mat DestRotation, DestTranslation;
+		cv::Mat dR3dR1, dR3dT1, dR3dR2, dR3dT2, dT3dR1, dT3dT1, dT3dR2, dT3dT2;
+		cv::composeRT(BoardRotation, BoardTranslation, ExtrinsicRotation, ExtrinsicTranslation, DestRotation, DestTranslation,
+			dR3dR1, dR3dT1, dR3dR2, dR3dT2, dT3dR1, dT3dT1, dT3dR2, dT3dT2);
+
+		std::vector<cv::Point2d> DestinationProjected;
+		cv::Mat DestinationJacobian;
+		cv::projectPoints(Data.ObjectPoints, DestRotation, DestTranslation, DestinationCameraMatrix, DestinationDistortion, DestinationProjected, DestinationJacobian);
+
+		const int32 NumPoints = static_cast<int32>(Data.ObjectPoints.size());
+
+		cv::Mat Residuals(4 * NumPoints, 1, CV_64F);
+		for (int32 i = 0; i < NumPoints; i++)
+		{
+			const cv::Point2d SourceResidual = SourceProjected[i] - Data.SourcePoints[i];
+			const cv::Point2d DestinationResidual = DestinationProjected[i] - Data.DestinationPoints[i];
+
+			Residuals.at<double>(2 * i) = SourceResidual.x;
+			Residuals.at<double>(2 * i + 1) = SourceResidual.y;
+			Residuals.at<double>(2 * (NumPoints + i)) = DestinationResidual.x;
+			Residuals.at<double>(2 * (NumPoints + i) + 1) = DestinationResidual.y;
+
+			SourceErrorSq += SourceResidual.dot(SourceResidual);
+			DestinationErrorSq += DestinationResidual.dot(DestinationResidual);
+		}
+
+		if (!Normals)
+		{
+			return;
+		}
+
+		// Local jacobian with columns [extrinsic, board pose]
+		cv::Mat J = cv::Mat::zeros(4 * NumPoints, 2 * ParamsPerPose, CV_64F);
+
+		// Source residuals only depend on the board pose
+		SourceJacobian.colRange(0, 6).copyTo(J(cv::Range(0, 2 * NumPoints), cv::Range(6, 12)));
+
+		// Destination residuals depend on both, via the composed pose
+		const cv::Mat dPdR3 = DestinationJacobian.colRange(0, 3);
+		const cv::Mat dPdT3 = DestinationJacobian.colRange(3, 6);
+		const cv::Range DestinationRows(2 * NumPoints, 4 * NumPoints);
+
+		cv::Mat(dPdR3 * dR3dR2 + dPdT3 * dT3dR2).copyTo(J(DestinationRows, cv::Range(0, 3)));
+		cv::Mat(dPdR3 * dR3dT2 + dPdT3 * dT3dT2).copyTo(J(DestinationRows, cv::Range(3, 6)));
+		cv::Mat(dPdR3 * dR3dR1 + dPdT3 * dT3dR1).copyTo(J(DestinationRows, cv::Range(6, 9)));
+		cv::Mat(dPdR3 * dR3dT1 + dPdT3 * dT3dT1).copyTo(J(DestinationRows, cv::Range(9, 12)));
+
+		const cv::Mat LocalJtJ = J.t() * J;
+		const cv::Mat LocalJtr = J.t() * Residuals;
+
+		const cv::Range ExtrinsicRange(0, ParamsPerPose);
+		const cv::Range BoardRange(ParamsPerPose, 2 * ParamsPerPose);
+		Normals->ExtrinsicJtJ = LocalJtJ(ExtrinsicRange, ExtrinsicRange);
+		Normals->CrossJtJ = LocalJtJ(ExtrinsicRange, BoardRange);
+		Normals->BoardJtJ = LocalJtJ(BoardRange, BoardRange);
+		Normals->ExtrinsicJtr = LocalJtr.rowRange(ExtrinsicRange);
+		Normals->BoardJtr = LocalJtr.rowRange(BoardRange);
+	}
+
+	// Adds Levenberg-Marquardt damping to the diagonal of a block
+	cv::Matx66d Damp(const cv::Matx66d& JtJ, double Lambda)
+	{
+		cv::Matx66d Damped = JtJ;
+		for (int32 i = 0; i < ParamsPerPose; i++)
+		{
+			Damped(i, i) += Lambda * FMath::Max(JtJ(i, i), UE_DOUBLE_SMALL_NUMBER);
+		}
+		return Damped;
+	}
+
+	// Solves the damped block-arrow normal equations for the update of all parameters
+	// Each board pose is eliminated through the Schur complement, leaving a 6x6 system in the extrinsic,
+	// so a step costs O(N) in the number of samples rather than the O(N^3) of a dense solve
+	bool SolveNormals(const TArray<FSampleNormals>& Normals, double Lambda, cv::Mat& OutDelta)
+	{
+		cv::Matx66d ExtrinsicJtJ = cv::Matx66d::zeros();
+		cv::Vec6d ExtrinsicJtr = cv::Vec6d::all(0.0);
+		for (const FSampleNormals& Sample : Normals)
+		{
+			ExtrinsicJtJ += Sample.ExtrinsicJtJ;
+			ExtrinsicJtr += Sample.ExtrinsicJtr;
+		}
+
+		cv::Matx66d Reduced = Damp(ExtrinsicJtJ, Lambda);
+		cv::Vec6d ReducedRhs = -ExtrinsicJtr;
+
+		TArray<cv::Matx66d> InverseBoardJtJ;
+		InverseBoardJtJ.SetNumUninitialized(Normals.Num());
+		for (int32 SampleIndex = 0; SampleIndex < Normals.Num(); SampleIndex++)
+		{
+			const FSampleNormals& Sample = Normals[SampleIndex];
+
+			bool bInverted = false;
+			InverseBoardJtJ[SampleIndex] = Damp(Sample.BoardJtJ, Lambda).inv(cv::DECOMP_CHOLESKY, &bInverted);
+			if (!bInverted)
+			{
+				return false;
+			}
+
+			const cv::Matx66d CrossTimesInverse = Sample.CrossJtJ * InverseBoardJtJ[SampleIndex];
+			Reduced -= CrossTimesInverse * Sample.CrossJtJ.t();
+			ReducedRhs += CrossTimesInverse * Sample.BoardJtr;
+		}
+
+		cv::Vec6d ExtrinsicDelta;
+		if (!cv::solve(Reduced, ReducedRhs, ExtrinsicDelta, cv::DECOMP_CHOLESKY))
+		{
+			return false;
+		}
+
+		// Back-substitute the update of each board pose
+		OutDelta.create(ParamsPerPose * (Normals.Num() + 1), 1, CV_64F);
+		for (int32 i = 0; i < ParamsPerPose; i++)
+		{
+			OutDelta.at<double>(i) = ExtrinsicDelta[i];
+		}
+		for (int32 SampleIndex = 0; SampleIndex < Normals.Num(); SampleIndex++)
+		{
+			const FSampleNormals& Sample = Normals[SampleIndex];
+			const cv::Vec6d BoardDelta = InverseBoardJtJ[SampleIndex] * (-Sample.BoardJtr - Sample.CrossJtJ.t() * ExtrinsicDelta);
+
+			const int32 BoardOffset = ParamsPerPose * (SampleIndex + 1);
+			for (int32 i = 0; i < ParamsPerPose; i++)
+			{
+				OutDelta.at<double>(BoardOffset + i) = BoardDelta[i];
+			}
+		}
+
+		return true;
+	}
+}
+#endif
+
+FCalibrationSolverResult FCalibrationSolver::Solve(const FCalibrationSolverSettings& Settings)
+{
+	FCalibrationSolverResult Result;
+
+#if WITH_OPENCV
+	const double StartTime = FPlatformTime::Seconds();
+
+	const cv::Mat SourceCameraMatrix = GetCameraMatrix(SourceCamera);
+	const cv::Mat SourceDistortion = GetDistortionCoefficients(SourceCamera);
+	const cv::Mat DestinationCameraMatrix = GetCameraMatrix(DestinationCamera);
+	const cv::Mat DestinationDistortion = GetDistortionCoefficients(DestinationCamera);
+
+	TArray<FSampleData> SampleData;
+	SampleData.Reserve(Samples.Num());
+	for (const FSample& Sample : Samples)
+	{
+		FSampleData& Data = SampleData.AddDefaulted_GetRef();
+		for (int32 i = 0; i < Sample.ObjectPoints.Num(); i++)
+		{
+			Data.ObjectPoints.emplace_back(Sample.ObjectPoints[i].X, Sample.ObjectPoints[i].Y, Sample.ObjectPoints[i].Z);
+			Data.SourcePoints.emplace_back(Sample.SourceCorners[i].X, Sample.SourceCorners[i].Y);
+			Data.DestinationPoints.emplace_back(Sample.DestinationCorners[i].X, Sample.DestinationCorners[i].Y);
+		}
+	}
+
+	// Initialize poses of samples added since the previous solve
+	// Samples that cannot be initialized are discarded, as they would otherwise fail every solve
+	for (int32 SampleIndex = BoardPoses.Num(); SampleIndex < Samples.Num(); SampleIndex++)
+	{
+		const FSampleData& Data = SampleData[SampleIndex];
+
+		cv::Mat BoardRotation, BoardTranslation;
+		if (!cv::solvePnP(Data.ObjectPoints, Data.SourcePoints, SourceCameraMatrix, SourceDistortion, BoardRotation, BoardTranslation))
+		{
+			UE_LOG(LogCompositionUtilsEditor, Warning, TEXT("Calibration solver: Failed to initialize board pose of sample %d, discarding it."), SampleIndices[SampleIndex]);
+			Result.RejectedSamples.Add(SampleIndices[SampleIndex]);
+			Samples.RemoveAt(SampleIndex);
+			SampleIndices.RemoveAt(SampleIndex);
+			SampleData.RemoveAt(SampleIndex);
+			SampleIndex--;
+			continue;
+		}
+
+		if (!bHasSolution)
+		{
+			// The initial extrinsic comes from the first sample, as seen from both cameras
+			cv::Mat DestBoardRotation, DestBoardTranslation;
+			if (!cv::solvePnP(Data.ObjectPoints, Data.DestinationPoints, DestinationCameraMatrix, DestinationDistortion, DestBoardRotation, DestBoardTranslation))
+			{
+				UE_LOG(LogCompositionUtilsEditor, Warning, TEXT("Calibration solver: Failed to initialize extrinsic from sample %d, discarding it."), SampleIndices[SampleIndex]);
+				Result.RejectedSamples.Add(SampleIndices[SampleIndex]);
+				Samples.RemoveAt(SampleIndex);
+				SampleIndices.RemoveAt(SampleIndex);
+				SampleData.RemoveAt(SampleIndex);
+				SampleIndex--;
+				continue;
+			}
+
+			// Extrinsic = DestBoard * inverse(Board)
+			cv::Mat BoardRotationMatrix;
+			cv::Rodrigues(BoardRotation, BoardRotationMatrix);
+			const cv::Mat InverseRotationMatrix = BoardRotationMatrix.t();
+			const cv::Mat InverseTranslation = -InverseRotationMatrix * BoardTranslation;
+			cv::Mat InverseRotation;
+			cv::Rodrigues(InverseRotationMatrix, InverseRotation);
+
+			cv::Mat ExtrinsicRotation, ExtrinsicTranslation;
+			cv::composeRT(InverseRotation, InverseTranslation, DestBoardRotation, DestBoardTranslation, ExtrinsicRotation, ExtrinsicTranslation);
+
+			for (int32 i = 0; i < 3; i++)
+			{
+				SourceToDestinationPose.Rotation[i] = ExtrinsicRotation.at<double>(i);
+				SourceToDestinationPose.Translation[i] = ExtrinsicTranslation.at<double>(i);
+			}
+			bHasSolution = true;
+		}
+
+		FPose& Pose = BoardPoses.AddDefaulted_GetRef();
+		for (int32 i = 0; i < 3; i++)
+		{
+			Pose.Rotation[i] = BoardRotation.at<double>(i);
+			Pose.Translation[i] = BoardTranslation.at<double>(i);
+		}
+	}
+
+	if (Samples.IsEmpty())
+	{
+		return Result;
+	}
+
+	// Pack parameters
+	const int32 NumParams = ParamsPerPose * (Samples.Num() + 1);
+	cv::Mat Params(NumParams, 1, CV_64F);
+	auto PackPose = [&Params](const FPose& Pose, int32 Offset)
+	{
+		for (int32 i = 0; i < 3; i++)
+		{
+			Params.at<double>(Offset + i) = Pose.Rotation[i];
+			Params.at<double>(Offset + 3 + i) = Pose.Translation[i];
+		}
+	};
+	PackPose(SourceToDestinationPose, 0);
+	for (int32 SampleIndex = 0; SampleIndex < Samples.Num(); SampleIndex++)
+	{
+		PackPose(BoardPoses[SampleIndex], ParamsPerPose * (SampleIndex + 1));
+	}
+
+	double SourceErrorSq = 0.0, DestinationErrorSq = 0.0;
+	auto Evaluate = [&](const cv::Mat& InParams, TArray<FSampleNormals>* Normals) -> double
+	{
+		if (Normals)
+		{
+			Normals->SetNum(SampleData.Num());
+		}
+
+		SourceErrorSq = 0.0;
+		DestinationErrorSq = 0.0;
+		for (int32 SampleIndex = 0; SampleIndex < SampleData.Num(); SampleIndex++)
+		{
+			EvaluateSample(SampleData[SampleIndex], InParams, SampleIndex,
+				SourceCameraMatrix, SourceDistortion, DestinationCameraMatrix, DestinationDistortion,
+				Normals ? &(*Normals)[SampleIndex] : nullptr, SourceErrorSq, DestinationErrorSq);
+		}
+		return SourceErrorSq + DestinationErrorSq;
+	};
+
+	// Levenberg-Marquardt
+	TArray<FSampleNormals> Normals;
+	double Error = Evaluate(Params, &Normals);
+	double Lambda = Settings.InitialLambda;
+
+	for (int32 Iteration = 0; Iteration < Settings.MaxIterations; Iteration++)
+	{
+		Result.NumIterations = Iteration + 1;
+
+		cv::Mat Delta;
+		if (!SolveNormals(Normals, Lambda, Delta))
+		{
+			Lambda *= 10.0;
+			continue;
+		}
+
+		const cv::Mat NewParams = Params + Delta;
+		const double NewError = Evaluate(NewParams, nullptr);
+
+		if (NewError < Error)
+		{
+			const double RelativeDecrease = (Error - NewError) / FMath::Max(Error, UE_DOUBLE_SMALL_NUMBER);
+
+			Params = NewParams;
+			Error = Evaluate(Params, &Normals);
+			Lambda = FMath::Max(Lambda * 0.1, 1e-12);
+
+			if (RelativeDecrease < Settings.ConvergenceThreshold)
+			{
+				break;
+			}
+		}
+		else
+		{
+			Lambda *= 10.0;
+			if (Lambda > 1e12)
+			{
+				// Cannot make any further progress
+				break;
+			}
+		}
+	}
+
+	// Store solution to warm-start the next solve
+	auto UnpackPose = [&Params](FPose& Pose, int32 Offset)
+	{
+		for (int32 i = 0; i < 3; i++)
+		{
+			Pose.Rotation[i] = Params.at<double>(Offset + i);
+			Pose.Translation[i] = Params.at<double>(Offset + 3 + i);
+		}
+	};
+	UnpackPose(SourceToDestinationPose, 0);
+	for (int32 SampleIndex = 0; SampleIndex < Samples.Num(); SampleIndex++)
+	{
+		UnpackPose(BoardPoses[SampleIndex], ParamsPerPose * (SampleIndex + 1));
+	}
+
+	// Make sure error terms correspond to the final parameters
+	Evaluate(Params, nullptr);
+
+	int32 NumPoints = 0;
+	for (const FSample& Sample : Samples)
+	{
+		NumPoints += Sample.ObjectPoints.Num();
+	}
+	Result.SourceRMSError = FMath::Sqrt(SourceErrorSq / FMath::Max(NumPoints, 1));
+	Result.DestinationRMSError = FMath::Sqrt(DestinationErrorSq / FMath::Max(NumPoints, 1));
+
+	// Convert from OpenCV camera space (x right, y down, z forward) to view space (x right, y up, z forward)
+	// and from column vector convention to row vector convention
+	{
+		cv::Mat RotationMatrix;
+		cv::Rodrigues(Params.rowRange(0, 3), RotationMatrix);
+
+		const double Flip[3] = { 1.0, -1.0, 1.0 };
+
+		FMatrix SourceToDestination = FMatrix::Identity;
+		for (int32 Row = 0; Row < 3; Row++)
+		{
+			for (int32 Col = 0; Col < 3; Col++)
+			{
+				SourceToDestination.M[Row][Col] = Flip[Row] * Flip[Col] * RotationMatrix.at<double>(Col, Row);
+			}
+			SourceToDestination.M[3][Row] = Flip[Row] * Params.at<double>(3 + Row);
+		}
+
+		Result.SourceToDestination = FTransform(SourceToDestination);
+	}
+
+	Result.bSuccess = true;
+	Result.NumSamples = Samples.Num();
+	Result.SolveTimeMs = (FPlatformTime::Seconds() - StartTime) * 1000.0;
+#endif
+
+	return Result;
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+#include "CompUtilsCameraData.h"
+
+
+struct FCalibrationSolverSettings
+{
+	int32 MaxIterations = 50;
+
+	// Iteration stops once the relative decrease in squared error falls below this
+	double ConvergenceThreshold = 1e-8;
+
+	// Initial damping of Levenberg-Marquardt
+	double InitialLambda = 1e-3;
+};
+
+struct FCalibrationSolverResult
+{
+	bool bSuccess = false;
+
+	int32 NumSamples = 0;
+	int32 NumIterations = 0;
+
+	// Samples whose poses could not be initialized, which have been discarded from the solver
+	// Indices count the samples in the order they were added to the solver, including discarded ones
+	TArray<int32> RejectedSamples;
+	double SolveTimeMs = 0.0;
+
+	// Root-mean-square reprojection error across all samples (in pixels)
+	double SourceRMSError = 0.0;
+	double DestinationRMSError = 0.0;
+
+	// Transforms points from source view space into destination view space
+	FTransform SourceToDestination = FTransform::Identity;
+};
+
+/**
+ * Jointly refines the source-to-destination extrinsic together with the checkerboard pose of every sample by Levenberg-Marquardt,
+ * minimizing the reprojection error of all collected correspondences in both feeds.
+ *
+ * All samples are kept, so each solve warm-starts from the previous solution and only needs to initialize newly added samples.
+ * Board poses are eliminated from every step through the Schur complement, so a step costs O(N) in the number of samples.
+ * Solving is thread-safe as long as the solver is not modified during a solve.
+ */
+class FCalibrationSolver
+{
+public:
+	struct FSample
+	{
+		TArray<FVector> ObjectPoints;
+		TArray<FVector2f> SourceCorners;
+		TArray<FVector2f> DestinationCorners;
+
+		// Pose of the board relative to the source camera, as detected when the sample was captured
+		// Only kept for reference, the solver initializes and refines its own board poses
+		FTransform BoardPose = FTransform::Identity;
+	};
+
+public:
+	void SetCameras(const FCompUtilsCameraIntrinsicData& InSourceCamera, const FCompUtilsCameraIntrinsicData& InDestinationCamera);
+	void AddSample(FSample&& Sample);
+
+	inline int32 GetNumSamples() const { return Samples.Num(); }
+
+	FCalibrationSolverResult Solve(const FCalibrationSolverSettings& Settings);
+
+private:
+	// Rotation (as Rodrigues vector) followed by translation, in OpenCV camera coordinates
+	struct FPose
+	{
+		double Rotation[3] = { 0.0, 0.0, 0.0 };
+		double Translation[3] = { 0.0, 0.0, 0.0 };
+	};
+
+	FCompUtilsCameraIntrinsicData SourceCamera;
+	FCompUtilsCameraIntrinsicData DestinationCamera;
+
+	TArray<FSample> Samples;
+	// Index of each sample in the order samples were added, see FCalibrationSolverResult::RejectedSamples
+	TArray<int32> SampleIndices;
+	int32 NumAddedSamples = 0;
+
+	// Solution of the previous solve, used to warm-start the next one
+	// Board poses are relative to the source camera
+	FPose SourceToDestinationPose;
+	TArray<FPose> BoardPoses;
+	bool bHasSolution = false;
+};
@@ -1,30 +1,47 @@
 #include "Calibrator.h"
 
 #include "CompositionUtilsEditor.h"
+#include "Async/Async.h"
 #include "MediaTexture.h"
 #include "RenderGraphBuilder.h"
 #include "RenderGraphUtils.h"
+#include "RHIGPUReadback.h"
+#include "ScreenPass.h"
 
+#include "CompUtilsBoxDownsample.h"
+#include "CompUtilsCornerPrefilter.h"
 #include "ReprojectionCalibration.h"
 
 #include "OpenCVHelper.h"
 
+#if WITH_OPENCV
+#include "PreOpenCVHeaders.h"
+#include "opencv2/calib3d.hpp"
+#include "opencv2/imgproc.hpp"
+#include "PostOpenCVHeaders.h"
+#endif
+
 #define LOCTEXT_NAMESPACE "FCompositionUtilsEditorModule"
 
 
 void FCalibrator::RestartCalibration()
 {
+	// Any capture in flight belongs to the previous calibration
+	PendingCapture.Reset();
+
 	NumSamples = 0;
-	WeightSum = 0;
 	SourceErrorSum = 0;
 	DestinationErrorSum = 0;
 
-	AccumulatedRotation = FQuat::Identity;
-	AccumulatedTranslation = FVector::ZeroVector;
+	// A solve in flight will be discarded once it completes
+	Solver.Reset();
+	QueuedSamples.Reset();
+	Session.Reset();
+	AcceptedSamples.Reset();
+	NumSolverSamples = 0;
 
 	CurrentSourceError = 0;
 	CurrentDestinationError = 0;
-	CurrentSampleWeight = 0;
 	CurrentCalibratedTransform.SetIdentity();
 
 	// It is helpful to clear any debug views from previous runs when calibration is restarted
@@ -36,49 +53,69 @@ void FCalibrator::RestartCalibration()
 
 void FCalibrator::ResetTransientResources()
 {
+	PendingCapture.Reset();
+	StopAutoCapture();
+
 	for (auto& Resources : TransientResources)
 	{
 		Resources.ReleaseAll();
 	}
 }
 
-FCalibrator::ECalibrationResult FCalibrator::RunCalibration(
+FCalibrator::ECalibrationResult FCalibrator::BeginCalibration(
 	TObjectPtr<UReprojectionCalibrationTargetBase> Source,
 	TObjectPtr<UReprojectionCalibrationTargetBase> Destination,
 	FIntPoint CheckerboardDimensions,
 	float CheckerboardSize,
-	FTransform& OutSourceToDestination)
+	const FDetectionSettings& DetectionSettings)
 {
+	// Only one run can be in flight at a time
+	check(!IsCalibrating());
+
 	for (auto& Resources : TransientResources)
 	{
 		Resources.bValidDebugView = false;
 	}
 
-	ECalibrationResult Result = RunCalibrationImpl(
+	return BeginCalibrationImpl(
 		Source,
 		Destination,
 		CheckerboardDimensions,
 		CheckerboardSize,
-		OutSourceToDestination);
+		DetectionSettings);
+}
 
-	if (Result != ECalibrationResult::Success)
-	{
-		// To make it less confusing, either show both successful debug images or neither
-		for (auto& Resources : TransientResources)
-		{
-			Resources.bValidDebugView = false;
-		}
-	}
+void FCalibrator::StartAutoCapture(
+	TObjectPtr<UReprojectionCalibrationTargetBase> Source,
+	TObjectPtr<UReprojectionCalibrationTargetBase> Destination,
+	FIntPoint CheckerboardDimensions,
+	float CheckerboardSize,
+	const FDetectionSettings& DetectionSettings,
+	const FAutoCaptureSettings& Settings)
+{
+	bAutoCapture = true;
+	AutoCaptureSource = Source;
+	AutoCaptureDestination = Destination;
+	AutoCaptureCheckerboardDimensions = CheckerboardDimensions;
+	AutoCaptureCheckerboardSize = CheckerboardSize;
+	AutoCaptureDetectionSettings = DetectionSettings;
+	AutoCaptureSettings = Settings;
+	LastAutoCaptureTime = 0.0;
+}
 
-	return Result;
+void FCalibrator::StopAutoCapture()
+{
+	bAutoCapture = false;
+	AutoCaptureSource.Reset();
+	AutoCaptureDestination.Reset();
 }
 
-FCalibrator::ECalibrationResult FCalibrator::RunCalibrationImpl(
+FCalibrator::ECalibrationResult FCalibrator::BeginCalibrationImpl(
 	TObjectPtr<UReprojectionCalibrationTargetBase> Source,
 	TObjectPtr<UReprojectionCalibrationTargetBase> Destination,
 	FIntPoint CheckerboardDimensions,
 	float CheckerboardSize,
-	FTransform& OutSourceToDestination)
+	const FDetectionSettings& DetectionSettings)
 {
 	// Calibration relies on OpenCV to run
 #if WITH_OPENCV
@@ -94,16 +131,151 @@ FCalibrator::ECalibrationResult FCalibrator::RunCalibrationImpl(
 		return ECalibrationResult::Error_MissingSourceOrDestination;
 	}
 
-	FCompUtilsCameraIntrinsicData SourceIntrinsics, DestinationIntrinsics;
-	if (!Source->GetCameraIntrinsicData(SourceIntrinsics) || !Destination->GetCameraIntrinsicData(DestinationIntrinsics))
+	TSharedRef<FPendingCapture, ESPMode::ThreadSafe> Capture = MakeShared<FPendingCapture, ESPMode::ThreadSafe>();
+	Capture->CheckerboardDimensions = CheckerboardDimensions;
+	Capture->CheckerboardSize = CheckerboardSize;
+	Capture->DownsampleFactor = FMath::Max(DetectionSettings.DownsampleFactor, 1);
+	Capture->bUseCornerPrefilter = DetectionSettings.bUseCornerPrefilter;
+	Capture->CornerPrefilterSettings = DetectionSettings.CornerPrefilterSettings;
+
+	if (!Source->GetCameraIntrinsicData(Capture->Intrinsics[Resources_Source]) || !Destination->GetCameraIntrinsicData(Capture->Intrinsics[Resources_Destination]))
 	{
 		return ECalibrationResult::Error_MissingIntrinsics;
 	}
 
+	TStaticArray<UReprojectionCalibrationTargetBase*, Resources_Count> Targets;
+	Targets[Resources_Source] = Source;
+	Targets[Resources_Destination] = Destination;
+
+	// Feeds that are already in CPU memory skip the upload, draw and readback entirely
+	TStaticArray<TObjectPtr<UTexture>, Resources_Count> Textures;
+	bool bNeedsReadback = false;
+	for (int32 Index = 0; Index < Resources_Count; Index++)
+	{
+		FCompUtilsCPUFrame Frame;
+		if (Targets[Index]->GetCPUFrame(Frame))
+		{
+			Capture->ImageData[Index] = MoveTemp(Frame.Pixels);
+			Capture->ImageSizes[Index] = Frame.Size;
+			Capture->FrameSizes[Index] = Frame.Size;
+			Textures[Index] = nullptr;
+		}
+		else
+		{
+			Textures[Index] = Targets[Index]->GetTexture();
+			bNeedsReadback = true;
+		}
+	}
+
+	if (bNeedsReadback)
+	{
+		EnqueueReadbacks(Textures, Capture);
+	}
+	else
+	{
+		Capture->bReadbackComplete = true;
+	}
+	PendingCapture = Capture;
+
+	return ECalibrationResult::Success;
+#else
+	// Calibration can never succeed without OpenCV
+	return ECalibrationResult::Error_NoOpenCV;
+#endif
+}
+
+void FCalibrator::Tick(float DeltaTime)
+{
+	if (IsSolving() && SolveResult.IsReady())
+	{
+		FinishSolve();
+	}
+
+	if (bAutoCapture && !PendingCapture.IsValid())
+	{
+		const double CurrentTime = FPlatformTime::Seconds();
+		if (CurrentTime - LastAutoCaptureTime >= 1.0 / FMath::Max(AutoCaptureSettings.CaptureRate, UE_KINDA_SMALL_NUMBER))
+		{
+			LastAutoCaptureTime = CurrentTime;
+
+			// Debug views are deliberately left alone between auto captures, so that they don't flicker
+			ECalibrationResult Result = BeginCalibrationImpl(
+				AutoCaptureSource.Get(),
+				AutoCaptureDestination.Get(),
+				AutoCaptureCheckerboardDimensions,
+				AutoCaptureCheckerboardSize,
+				AutoCaptureDetectionSettings);
+
+			if (Result == ECalibrationResult::Success)
+			{
+				PendingCapture->bAutoCapture = true;
+			}
+			else
+			{
+				// Errors before capture are not transient, so would repeat every capture
+				StopAutoCapture();
+				OnCalibrationCompleteDelegate.ExecuteIfBound(Result);
+			}
+		}
+	}
+
+	if (!PendingCapture.IsValid())
+		return;
+
+	if (!PendingCapture->bReadbackComplete)
+	{
+		// Don't queue up more than one poll at a time
+		if (!PendingCapture->bPollInFlight)
+		{
+			PendingCapture->bPollInFlight = true;
+			PollReadbacks(PendingCapture.ToSharedRef());
+		}
+		return;
+	}
+
+	if (!PendingCapture->bFeedTasksLaunched)
+	{
+		LaunchFeedTasks(PendingCapture.ToSharedRef());
+		return;
+	}
+
+	for (const auto& FeedResult : PendingCapture->FeedResults)
+	{
+		if (!FeedResult.IsReady())
+			return;
+	}
+
+	TSharedPtr<FPendingCapture, ESPMode::ThreadSafe> Capture = MoveTemp(PendingCapture);
+	CompleteCalibration(FinishCalibration(*Capture));
+}
+
+TStatId FCalibrator::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(FCalibrator, STATGROUP_Tickables);
+}
+
+FText FCalibrator::GetStatusText() const
+{
+	if (!PendingCapture.IsValid())
+	{
+		return bAutoCapture ? LOCTEXT("CalibratorStatusAutoCapture", "Auto capturing...") : LOCTEXT("CalibratorStatusIdle", "Idle");
+	}
+	if (!PendingCapture->bReadbackComplete)
+	{
+		return LOCTEXT("CalibratorStatusReadback", "Capturing feeds...");
+	}
+	return LOCTEXT("CalibratorStatusDetecting", "Detecting checkerboard...");
+}
+
+void FCalibrator::LaunchFeedTasks(const TSharedRef<FPendingCapture, ESPMode::ThreadSafe>& Capture)
+{
+	const FIntPoint CheckerboardDimensions = Capture->CheckerboardDimensions;
+	const float CheckerboardSize = Capture->CheckerboardSize;
+
 	// Build object space points (this is done every run in case checkerboard has changed)
 	// TODO: Notes on coordinate space
-	TArray<FVector> ObjectPoints;
-	ObjectPoints.Reserve(CheckerboardDimensions.X * CheckerboardDimensions.Y);
+	TArray<FVector>& ObjectPoints = Capture->ObjectPoints;
+	ObjectPoints.Reset(CheckerboardDimensions.X * CheckerboardDimensions.Y);
 	for (int32 Y = 0; Y < CheckerboardDimensions.Y; Y++)
 	{
 		for (int32 X = 0; X < CheckerboardDimensions.X; X++)
@@ -112,82 +284,462 @@ FCalibrator::ECalibrationResult FCalibrator::RunCalibrationImpl(
 		}
 	}
 
-	// First, find checkerboard corners for the current pair of images
-	TArray<FVector2f> SourceCorners, DestinationCorners;
-	ECalibrationResult Result = FindCheckerboardCorners(CheckerboardDimensions, Source->GetTexture(), TransientResources[Resources_Source], SourceCorners);
-	if (Result != ECalibrationResult::Success)
+	// Source and destination are independent, so process them in parallel
+	// The tasks hold a reference to the capture, so it stays alive even if calibration is restarted in the meantime
+	for (int32 Index = 0; Index < Resources_Count; Index++)
+	{
+		Capture->FeedResults[Index] = Async(EAsyncExecution::ThreadPool,
+		[Capture, Index]
+		{
+			// Each task only touches the data of its own feed
+			if (Capture->DownsampleFactor > 1 && Capture->CoarseImageData[Index].IsEmpty())
+			{
+				DownsampleImage(
+					Capture->ImageData[Index],
+					Capture->ImageSizes[Index],
+					Capture->DownsampleFactor,
+					Capture->CoarseImageData[Index],
+					Capture->CoarseImageSizes[Index]);
+			}
+
+			return DetectAndSolve(*Capture, Index);
+		});
+	}
+
+	Capture->bFeedTasksLaunched = true;
+}
+
+FCalibrator::FFeedResult FCalibrator::DetectAndSolve(
+	const FPendingCapture& Capture,
+	int32 Index)
+{
+	FFeedResult FeedResult;
+
+#if WITH_OPENCV
+	const TArray<FVector>& ObjectPoints = Capture.ObjectPoints;
+	const FCompUtilsCameraIntrinsicData& Intrinsics = Capture.Intrinsics[Index];
+
+	if (Capture.ImageData[Index].Num() != Capture.ImageSizes[Index].X * Capture.ImageSizes[Index].Y)
+	{
+		FeedResult.Result = ECalibrationResult::Error_ReadTextureFailure;
+		return FeedResult;
+	}
+
+	if (!FindCheckerboardCorners(Capture, Index, FeedResult.Corners))
+	{
+		FeedResult.Result = ECalibrationResult::Error_IdentifyCheckerboardFailure;
+		return FeedResult;
+	}
+
+	// Corners must be relative to the full frame to match the intrinsics
+	const FVector2f ImageOffset{ Capture.ImageOffsets[Index] };
+	for (FVector2f& Corner : FeedResult.Corners)
+	{
+		Corner += ImageOffset;
+	}
+
+	if (FeedResult.Corners.Num() != ObjectPoints.Num())
+	{
+		FeedResult.Result = ECalibrationResult::Error_PointCountMismatch;
+		return FeedResult;
+	}
+
+	// With checkerboard corners found, attempt to solve for the pose of the camera
+	if (!SolveCameraPose(ObjectPoints, FeedResult.Corners, Intrinsics, FeedResult.CameraPose))
 	{
-		return Result;
+		FeedResult.Result = ECalibrationResult::Error_SolvePoseFailure;
+		return FeedResult;
 	}
 
-	Result = FindCheckerboardCorners(CheckerboardDimensions, Destination->GetTexture(), TransientResources[Resources_Destination], DestinationCorners);
-	if (Result != ECalibrationResult::Success)
+	FeedResult.ReprojectionError = FOpenCVHelper::ComputeReprojectionError(ObjectPoints, FeedResult.Corners, Intrinsics.FocalLength, Intrinsics.ImageCenter, FeedResult.CameraPose);
+#else
+	FeedResult.Result = ECalibrationResult::Error_NoOpenCV;
+#endif
+
+	return FeedResult;
+}
+
+bool FCalibrator::SolveCameraPose(
+	const TArray<FVector>& ObjectPoints,
+	const TArray<FVector2f>& ImagePoints,
+	const FCompUtilsCameraIntrinsicData& Intrinsics,
+	FTransform& OutCameraPose)
+{
+#if WITH_OPENCV
+	if (ObjectPoints.Num() != ImagePoints.Num())
 	{
-		return Result;
+		return false;
 	}
 
-	if (SourceCorners.Num() != ObjectPoints.Num() || DestinationCorners.Num() != ObjectPoints.Num())
+	std::vector<cv::Point3f> Points3d;
+	std::vector<cv::Point2f> Points2d;
+	Points3d.reserve(ObjectPoints.Num());
+	Points2d.reserve(ImagePoints.Num());
+	for (int32 Index = 0; Index < ObjectPoints.Num(); Index++)
 	{
-		return ECalibrationResult::Error_PointCountMismatch;
+		Points3d.emplace_back(ObjectPoints[Index].X, ObjectPoints[Index].Y, ObjectPoints[Index].Z);
+		Points2d.emplace_back(ImagePoints[Index].X, ImagePoints[Index].Y);
 	}
 
-	// With checkerboard corners found, attempt to solve for the pose of each camera
-	FTransform SourceCameraPose, DestinationCameraPose;
+	cv::Mat CameraMatrix = cv::Mat::eye(3, 3, CV_64F);
+	CameraMatrix.at<double>(0, 0) = Intrinsics.FocalLength.X;
+	CameraMatrix.at<double>(1, 1) = Intrinsics.FocalLength.Y;
+	CameraMatrix.at<double>(0, 2) = Intrinsics.ImageCenter.X;
+	CameraMatrix.at<double>(1, 2) = Intrinsics.ImageCenter.Y;
+
+	// Wraps the distortion parameters without copying, an empty matrix means no distortion
+	cv::Mat DistortionCoefficients;
+	if (!Intrinsics.DistortionParams.IsEmpty())
+	{
+		DistortionCoefficients = cv::Mat(1, Intrinsics.DistortionParams.Num(), CV_32F, const_cast<float*>(Intrinsics.DistortionParams.GetData()));
+	}
 
-	if (!FOpenCVHelper::SolvePnP(
-		ObjectPoints,
-		SourceCorners,
-		SourceIntrinsics.FocalLength,
-		SourceIntrinsics.ImageCenter,
-		SourceIntrinsics.DistortionParams,
-		SourceCameraPose))
+	cv::Mat RotationVector;
+	cv::Mat TranslationVector;
+	if (!cv::solvePnP(Points3d, Points2d, CameraMatrix, DistortionCoefficients, RotationVector, TranslationVector))
 	{
-		return ECalibrationResult::Error_SolvePoseFailure;
+		return false;
 	}
 
-	if (!FOpenCVHelper::SolvePnP(
-		ObjectPoints,
-		DestinationCorners,
-		DestinationIntrinsics.FocalLength, 
-		DestinationIntrinsics.ImageCenter, 
-		DestinationIntrinsics.DistortionParams,
-		DestinationCameraPose))
+	// solvePnP gives the pose of the board relative to the camera, the camera pose is its inverse
+	cv::Mat BoardRotation;
+	cv::Rodrigues(RotationVector, BoardRotation);
+	const cv::Mat CameraRotation = BoardRotation.t();
+	const cv::Mat CameraTranslation = -CameraRotation * TranslationVector;
+
+	FMatrix PoseMatrix = FMatrix::Identity;
+	for (int32 Column = 0; Column < 3; Column++)
 	{
-		return ECalibrationResult::Error_SolvePoseFailure;
+		PoseMatrix.SetColumn(Column, FVector(CameraRotation.at<double>(Column, 0), CameraRotation.at<double>(Column, 1), CameraRotation.at<double>(Column, 2)));
 	}
+	PoseMatrix.M[3][0] = CameraTranslation.at<double>(0);
+	PoseMatrix.M[3][1] = CameraTranslation.at<double>(1);
+	PoseMatrix.M[3][2] = CameraTranslation.at<double>(2);
+
+	// Same conventions as FOpenCVHelper::SolvePnP
+	OutCameraPose.SetFromMatrix(PoseMatrix);
+	FOpenCVHelper::ConvertOpenCVToUnreal(OutCameraPose);
+	return true;
+#else
+	return false;
+#endif
+}
 
-	// Find the transform to get from Source to Destination
-	FQuat SourceToDestinationRotation = SourceCameraPose.GetRotation() * DestinationCameraPose.GetRotation().Inverse();
-	FVector SourceToDestinationTranslation = SourceCameraPose.GetTranslation() - DestinationCameraPose.GetTranslation();
+void FCalibrator::DownsampleImage(
+	const TArray<FColor>& ImageData,
+	FIntPoint ImageSize,
+	int32 DownsampleFactor,
+	TArray<FColor>& OutImageData,
+	FIntPoint& OutImageSize)
+{
+#if WITH_OPENCV
+	OutImageSize = FIntPoint::DivideAndRoundUp(ImageSize, DownsampleFactor);
+	OutImageData.SetNumUninitialized(OutImageSize.X * OutImageSize.Y);
 
-	// Weight and accumulate output transform
-	CurrentSourceError = FOpenCVHelper::ComputeReprojectionError(ObjectPoints, SourceCorners, SourceIntrinsics.FocalLength, SourceIntrinsics.ImageCenter, SourceCameraPose);
-	CurrentDestinationError = FOpenCVHelper::ComputeReprojectionError(ObjectPoints, DestinationCorners, DestinationIntrinsics.FocalLength, DestinationIntrinsics.ImageCenter, DestinationCameraPose);
+	// Wraps the image data without copying
+	const cv::Mat Image(ImageSize.Y, ImageSize.X, CV_8UC4, const_cast<FColor*>(ImageData.GetData()));
+	cv::Mat CoarseImage(OutImageSize.Y, OutImageSize.X, CV_8UC4, OutImageData.GetData());
 
-	// Error should never be 0 in reality
-	double Weight = 1.0 / FMath::Max(UE_KINDA_SMALL_NUMBER, CurrentSourceError + CurrentDestinationError);
-	WeightSum += Weight;
-	// Normalize weight across samples
-	CurrentSampleWeight = Weight / WeightSum;
+	cv::resize(Image, CoarseImage, CoarseImage.size(), 0.0, 0.0, cv::INTER_AREA);
+#endif
+}
 
-	AccumulatedRotation = FQuat::Slerp(AccumulatedRotation, SourceToDestinationRotation, CurrentSampleWeight);
-	AccumulatedTranslation = FMath::Lerp(AccumulatedTranslation, SourceToDestinationTranslation, CurrentSampleWeight);
+bool FCalibrator::FindCheckerboardCorners(
+	const FPendingCapture& Capture,
+	int32 Index,
+	TArray<FVector2f>& OutCorners)
+{
+#if WITH_OPENCV
+	const double StartTime = FPlatformTime::Seconds();
+
+	const TArray<FColor>& CoarseImageData = Capture.CoarseImageData[Index];
+	const FIntPoint CoarseImageSize = Capture.CoarseImageSizes[Index];
+
+	if (Capture.DownsampleFactor > 1
+		&& CoarseImageData.Num() == CoarseImageSize.X * CoarseImageSize.Y
+		&& FOpenCVHelper::IdentifyCheckerboard(CoarseImageData, CoarseImageSize, Capture.CheckerboardDimensions, OutCorners))
+	{
+		// Scale corners up to full resolution, taking into account that pixel centres are at half-integer coordinates
+		const FVector2f Scale{
+			static_cast<float>(Capture.ImageSizes[Index].X) / static_cast<float>(CoarseImageSize.X),
+			static_cast<float>(Capture.ImageSizes[Index].Y) / static_cast<float>(CoarseImageSize.Y)
+		};
+		for (FVector2f& Corner : OutCorners)
+		{
+			Corner = (Corner + 0.5f) * Scale - 0.5f;
+		}
+
+		// Corners found in the coarse image are accurate to around a coarse pixel, so search a couple of coarse pixels around them
+		const int32 SearchRadius = 2 * Capture.DownsampleFactor;
+		if (RefineCorners(Capture.ImageData[Index], Capture.ImageSizes[Index], SearchRadius, OutCorners))
+		{
+			UE_LOG(LogCompositionUtilsEditor, Verbose, TEXT("Coarse-to-fine checkerboard detection took %.2fms"), (FPlatformTime::Seconds() - StartTime) * 1000.0);
+			return true;
+		}
+	}
+
+	// Fall back to searching the entire full resolution image
+	OutCorners.Reset();
+	const bool bFound = FOpenCVHelper::IdentifyCheckerboard(Capture.ImageData[Index], Capture.ImageSizes[Index], Capture.CheckerboardDimensions, OutCorners);
+
+	UE_LOG(LogCompositionUtilsEditor, Verbose, TEXT("Full resolution checkerboard detection took %.2fms"), (FPlatformTime::Seconds() - StartTime) * 1000.0);
+	return bFound;
+#else
+	return false;
+#endif
+}
+
+bool FCalibrator::RefineCorners(
+	const TArray<FColor>& ImageData,
+	FIntPoint ImageSize,
+	int32 SearchRadius,
+	TArray<FVector2f>& InOutCorners)
+{
+#if WITH_OPENCV
+	// Wraps the image data without copying
+	const cv::Mat Image(ImageSize.Y, ImageSize.X, CV_8UC4, const_cast<FColor*>(ImageData.GetData()));
+
+	// Only the pixels in a window around each corner are converted to greyscale
+	// cornerSubPix samples a search window around the current estimate, which may drift by up to the search radius while iterating,
+	// so the crop covers both, plus a pixel of gradients at the edges and a pixel for bilinear sampling
+	// Corners that drift further are rejected, as their search window would sample the replicated border of the crop
+	const int32 MaxDrift = SearchRadius;
+	const int32 WindowRadius = SearchRadius + MaxDrift + 2;
+	const cv::TermCriteria Criteria(cv::TermCriteria::EPS + cv::TermCriteria::COUNT, 30, 0.01);
+
+	cv::Mat GreyWindow;
+	std::vector<cv::Point2f> WindowCorner(1);
+
+	for (FVector2f& Corner : InOutCorners)
+	{
+		const int32 CentreX = FMath::RoundToInt32(Corner.X);
+		const int32 CentreY = FMath::RoundToInt32(Corner.Y);
+
+		const cv::Rect Window = cv::Rect(CentreX - WindowRadius, CentreY - WindowRadius, 2 * WindowRadius + 1, 2 * WindowRadius + 1)
+			& cv::Rect(0, 0, ImageSize.X, ImageSize.Y);
+		if (Window.width < 2 * WindowRadius + 1 || Window.height < 2 * WindowRadius + 1)
+		{
+			// Corner is too close to the edge of the image to be refined reliably
+			return false;
+		}
+
+		cv::cvtColor(Image(Window), GreyWindow, cv::COLOR_BGRA2GRAY);
+
+		WindowCorner[0] = cv::Point2f(Corner.X - Window.x, Corner.Y - Window.y);
+		cv::cornerSubPix(GreyWindow, WindowCorner, cv::Size(SearchRadius, SearchRadius), cv::Size(-1, -1), Criteria);
+
+		const FVector2f RefinedCorner{ WindowCorner[0].x + Window.x, WindowCorner[0].y + Window.y };
+		if (FMath::Abs(RefinedCorner.X - Corner.X) > MaxDrift || FMath::Abs(RefinedCorner.Y - Corner.Y) > MaxDrift)
+		{
+			return false;
+		}
+
+		Corner = RefinedCorner;
+	}
+
+	return true;
+#else
+	return false;
+#endif
+}
+
+FCalibrator::ECalibrationResult FCalibrator::FinishCalibration(FPendingCapture& Capture)
+{
+	check(IsInGameThread());
+
+	const FFeedResult& Source = Capture.FeedResults[Resources_Source].Get();
+	const FFeedResult& Destination = Capture.FeedResults[Resources_Destination].Get();
+
+	// Report errors in the same order as they would be encountered processing serially
+	if (Source.Result == ECalibrationResult::Error_IdentifyCheckerboardFailure || Destination.Result == ECalibrationResult::Error_IdentifyCheckerboardFailure)
+	{
+		return ECalibrationResult::Error_IdentifyCheckerboardFailure;
+	}
+	if (Source.Result != ECalibrationResult::Success)
+	{
+		return Source.Result;
+	}
+	if (Destination.Result != ECalibrationResult::Success)
+	{
+		return Destination.Result;
+	}
+
+	// Debug views are textures, so must be updated on the game thread
+	for (int32 Index = 0; Index < Resources_Count; Index++)
+	{
+		ECalibrationResult Result = UpdateDebugView(
+			Capture.CheckerboardDimensions,
+			Capture.ImageData[Index],
+			Capture.ImageSizes[Index],
+			Capture.ImageOffsets[Index],
+			Capture.FrameSizes[Index],
+			Capture.FeedResults[Index].Get().Corners,
+			TransientResources[Index]);
+		if (Result != ECalibrationResult::Success)
+		{
+			return Result;
+		}
+	}
+
+	const FTransform& SourceCameraPose = Source.CameraPose;
+
+	if (Capture.bAutoCapture)
+	{
+		const float MaxError = AutoCaptureSettings.MaxReprojectionError;
+		if (Source.ReprojectionError > MaxError || Destination.ReprojectionError > MaxError)
+		{
+			return ECalibrationResult::Rejected_ErrorTooHigh;
+		}
+
+		if (!IsNovelPose(SourceCameraPose))
+		{
+			return ECalibrationResult::Rejected_PoseTooSimilar;
+		}
+	}
+
+	// Per-sample errors give feedback on the quality of each capture
+	CurrentSourceError = Source.ReprojectionError;
+	CurrentDestinationError = Destination.ReprojectionError;
+
+	// Samples are added to the solver in the order they are accepted
+	FAcceptedSample& AcceptedSample = AcceptedSamples.AddDefaulted_GetRef();
+	AcceptedSample.SolverIndex = NumSolverSamples++;
+	AcceptedSample.BoardPose = SourceCameraPose;
+	AcceptedSample.SourceError = CurrentSourceError;
+	AcceptedSample.DestinationError = CurrentDestinationError;
 
 	NumSamples++;
 	SourceErrorSum += CurrentSourceError;
 	DestinationErrorSum += CurrentDestinationError;
 
-	CurrentCalibratedTransform.SetIdentity();
-	CurrentCalibratedTransform.SetRotation(AccumulatedRotation);
-	CurrentCalibratedTransform.SetTranslation(AccumulatedTranslation);
+	// Keep the correspondences so that the extrinsic can be solved jointly across all samples
+	FCalibrationSolver::FSample& Sample = QueuedSamples.AddDefaulted_GetRef();
+	Sample.ObjectPoints = Capture.ObjectPoints;
+	Sample.SourceCorners = Source.Corners;
+	Sample.DestinationCorners = Destination.Corners;
+	Sample.BoardPose = SourceCameraPose;
+
+	SolverSourceCamera = Capture.Intrinsics[Resources_Source];
+	SolverDestinationCamera = Capture.Intrinsics[Resources_Destination];
+
+	Session.SourceCamera = SolverSourceCamera;
+	Session.DestinationCamera = SolverDestinationCamera;
+	Session.Samples.Add(Sample);
 
-	OutSourceToDestination = CurrentCalibratedTransform;
+	KickSolve();
 
 	return ECalibrationResult::Success;
-#else
-	// Calibration can never succeed without OpenCV
-	return ECalibrationResult::Error_NoOpenCV;
-#endif
+}
+
+void FCalibrator::KickSolve()
+{
+	if (IsSolving() || QueuedSamples.IsEmpty())
+		return;
+
+	if (!Solver.IsValid())
+	{
+		Solver = MakeShared<FCalibrationSolver, ESPMode::ThreadSafe>();
+	}
+
+	Solver->SetCameras(SolverSourceCamera, SolverDestinationCamera);
+	for (FCalibrationSolver::FSample& Sample : QueuedSamples)
+	{
+		Solver->AddSample(MoveTemp(Sample));
+	}
+	QueuedSamples.Reset();
+
+	SolvingSolver = Solver;
+	SolveResult = Async(EAsyncExecution::ThreadPool,
+	[Solver = Solver, Settings = SolverSettings]
+	{
+		return Solver->Solve(Settings);
+	});
+}
+
+void FCalibrator::FinishSolve()
+{
+	check(IsInGameThread());
+
+	const FCalibrationSolverResult Result = SolveResult.Get();
+	SolveResult = TFuture<FCalibrationSolverResult>();
+
+	// Results from before a restart are discarded
+	const bool bCurrentSolver = SolvingSolver == Solver;
+	SolvingSolver.Reset();
+
+	if (bCurrentSolver)
+	{
+		RemoveRejectedSamples(Result.RejectedSamples);
+
+		if (Result.bSuccess)
+		{
+			CurrentCalibratedTransform = Result.SourceToDestination;
+			OnSolveCompleteDelegate.ExecuteIfBound(Result);
+		}
+
+		UE_LOG(LogCompositionUtilsEditor, Verbose, TEXT("Calibration solve over %d samples %s after %d iterations in %.2fms"),
+			Result.NumSamples, Result.bSuccess ? TEXT("succeeded") : TEXT("failed"), Result.NumIterations, Result.SolveTimeMs);
+	}
+
+	// Samples may have been accepted while solving
+	KickSolve();
+}
+
+void FCalibrator::RemoveRejectedSamples(const TArray<int32>& RejectedSamples)
+{
+	if (RejectedSamples.IsEmpty())
+		return;
+
+	// Samples discarded by the solver no longer count towards the calibration, nor are they saved with the session
+	for (int32 Index = AcceptedSamples.Num() - 1; Index >= 0; Index--)
+	{
+		const FAcceptedSample& AcceptedSample = AcceptedSamples[Index];
+		if (!RejectedSamples.Contains(AcceptedSample.SolverIndex))
+			continue;
+
+		NumSamples--;
+		SourceErrorSum -= AcceptedSample.SourceError;
+		DestinationErrorSum -= AcceptedSample.DestinationError;
+
+		AcceptedSamples.RemoveAt(Index);
+		Session.Samples.RemoveAt(Index);
+	}
+
+	UE_LOG(LogCompositionUtilsEditor, Warning, TEXT("Calibration solver discarded %d samples, %d samples remain"), RejectedSamples.Num(), NumSamples);
+	OnSamplesRejectedDelegate.ExecuteIfBound(RejectedSamples.Num());
+}
+
+bool FCalibrator::IsNovelPose(const FTransform& BoardPose) const
+{
+	const double MinAngle = FMath::DegreesToRadians(AutoCaptureSettings.MinRotationDifference);
+	const double MinDistance = AutoCaptureSettings.MinTranslationDifference;
+
+	for (const FAcceptedSample& AcceptedSample : AcceptedSamples)
+	{
+		const FTransform& AcceptedPose = AcceptedSample.BoardPose;
+		const bool bRotationSimilar = BoardPose.GetRotation().AngularDistance(AcceptedPose.GetRotation()) < MinAngle;
+		const bool bTranslationSimilar = FVector::Dist(BoardPose.GetTranslation(), AcceptedPose.GetTranslation()) < MinDistance;
+		if (bRotationSimilar && bTranslationSimilar)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+void FCalibrator::CompleteCalibration(ECalibrationResult Result)
+{
+	// Rejected samples still found the board, so their debug views are valid
+	if (Result != ECalibrationResult::Success && !IsRejection(Result))
+	{
+		// To make it less confusing, either show both successful debug images or neither
+		for (auto& Resources : TransientResources)
+		{
+			Resources.bValidDebugView = false;
+		}
+	}
+
+	OnCalibrationCompleteDelegate.ExecuteIfBound(Result);
 }
 
 TObjectPtr<UTexture> FCalibrator::GetCalibratedSourceDebugView() const
@@ -211,37 +763,26 @@ TObjectPtr<UTexture> FCalibrator::GetDebugView(const FTransientResources& Resour
 }
 
 
-FCalibrator::ECalibrationResult FCalibrator::FindCheckerboardCorners(
+FCalibrator::ECalibrationResult FCalibrator::UpdateDebugView(
 	FIntPoint CheckerboardDimensions,
-	TObjectPtr<UTexture> InTexture, 
-	FTransientResources& Resources, 
-	TArray<FVector2f>& OutCorners)
+	const TArray<FColor>& ImageData,
+	FIntPoint ImageSize,
+	FIntPoint ImageOffset,
+	FIntPoint FrameSize,
+	const TArray<FVector2f>& Corners,
+	FTransientResources& Resources)
 {
-	// Copying to an intermediate texture handles format conversion and allows us to use UTextureRenderTarget2D's API here
-	CopyToIntermediate(InTexture, Resources.Intermediate);
-
-	TArray<FColor> ImageData;
-	if (!Resources.Intermediate->GameThread_GetRenderTargetResource()->ReadPixels(ImageData))
-	{
-		return ECalibrationResult::Error_ReadTextureFailure;
-	}
-
-	FIntPoint SourceImageSize{
-		static_cast<int32>(InTexture->GetSurfaceWidth()),
-		static_cast<int32>(InTexture->GetSurfaceHeight())
-	};
-
-	if (!FOpenCVHelper::IdentifyCheckerboard(ImageData, SourceImageSize, CheckerboardDimensions, OutCorners))
-	{
-		return ECalibrationResult::Error_IdentifyCheckerboardFailure;
-	}
-
+#if WITH_OPENCV
+	// Feeds taken from CPU memory may differ in size from the texture, so the debug view is recreated on any size change
 	if (!Resources.DebugView
 	 || !Resources.DebugView->GetPlatformData()
-	 ||  Resources.DebugView->GetPlatformData()->Mips.IsEmpty())
+	 ||  Resources.DebugView->GetPlatformData()->Mips.IsEmpty()
+	 ||  Resources.DebugView->GetSizeX() != FrameSize.X
+	 ||  Resources.DebugView->GetSizeY() != FrameSize.Y)
 	{
+		// Image data is always BGRA8, matching the intermediates
 		Resources.DebugView.Reset(
-			UTexture2D::CreateTransient(SourceImageSize.X, SourceImageSize.Y, Resources.Intermediate->GetFormat(), NAME_None, {})
+			UTexture2D::CreateTransient(FrameSize.X, FrameSize.Y, PF_B8G8R8A8, NAME_None, {})
 		);
 		Resources.DebugView->SRGB = false;
 	}
@@ -249,16 +790,26 @@ FCalibrator::ECalibrationResult FCalibrator::FindCheckerboardCorners(
 	{
 		auto& Mip = Resources.DebugView->GetPlatformData()->Mips[0];
 
-		TConstArrayView64<uint8> ImageDataView(reinterpret_cast<uint8*>(ImageData.GetData()), ImageData.Num() * ImageData.GetTypeSize());
-
-		void* DestImageData = Mip.BulkData.Lock(LOCK_READ_WRITE);
-		FMemory::Memcpy(DestImageData, ImageDataView.GetData(), ImageDataView.NumBytes());
+		FColor* DestImageData = static_cast<FColor*>(Mip.BulkData.Lock(LOCK_READ_WRITE));
+		if (ImageSize == FrameSize)
+		{
+			FMemory::Memcpy(DestImageData, ImageData.GetData(), ImageData.Num() * ImageData.GetTypeSize());
+		}
+		else
+		{
+			// Only part of the frame was read back, the rest is left black
+			FMemory::Memzero(DestImageData, FrameSize.X * FrameSize.Y * sizeof(FColor));
+			for (int32 Y = 0; Y < ImageSize.Y; Y++)
+			{
+				FMemory::Memcpy(&DestImageData[(ImageOffset.Y + Y) * FrameSize.X + ImageOffset.X], &ImageData[Y * ImageSize.X], ImageSize.X * sizeof(FColor));
+			}
+		}
 		Mip.BulkData.Unlock();
 
 		Resources.DebugView->UpdateResource();
 	}
 
-	if (!FOpenCVHelper::DrawCheckerboardCorners(OutCorners, CheckerboardDimensions, Resources.DebugView.Get()))
+	if (!FOpenCVHelper::DrawCheckerboardCorners(Corners, CheckerboardDimensions, Resources.DebugView.Get()))
 	{
 		return ECalibrationResult::Error_DrawCheckerboardFailure;
 	}
@@ -266,44 +817,237 @@ FCalibrator::ECalibrationResult FCalibrator::FindCheckerboardCorners(
 	Resources.bValidDebugView = true;
 
 	return ECalibrationResult::Success;
+#else
+	return ECalibrationResult::Error_NoOpenCV;
+#endif
 }
 
-void FCalibrator::CopyToIntermediate(TObjectPtr<UTexture> InTexture, TStrongObjectPtr<UTextureRenderTarget2D>& IntermediateTexture)
+void FCalibrator::EnqueueReadbacks(
+	const TStaticArray<TObjectPtr<UTexture>, Resources_Count>& InTextures,
+	const TSharedRef<FPendingCapture, ESPMode::ThreadSafe>& Capture)
 {
-	if (!IntermediateTexture)
+	TStaticArray<FTextureResource*, Resources_Count> SourceResources;
+	TStaticArray<FTextureResource*, Resources_Count> IntermediateResources;
+	TStaticArray<FTextureResource*, Resources_Count> CoarseIntermediateResources;
+
+	const bool bCoarseToFine = Capture->DownsampleFactor > 1;
+
+	for (int32 Index = 0; Index < Resources_Count; Index++)
 	{
-		IntermediateTexture.Reset(CreateRenderTargetFrom(InTexture, false));
-	}
+		SourceResources[Index] = nullptr;
+		IntermediateResources[Index] = nullptr;
+		CoarseIntermediateResources[Index] = nullptr;
+
+		if (!InTextures[Index])
+			continue;
 
-	FTextureResource* SourceResource = InTexture->GetResource();
-	FTextureResource* IntermediateResource = IntermediateTexture->GameThread_GetRenderTargetResource();
+		TStrongObjectPtr<UTextureRenderTarget2D>& Intermediate = TransientResources[Index].Intermediate;
+		if (!Intermediate)
+		{
+			Intermediate.Reset(CreateRenderTargetFrom(InTextures[Index], false));
+		}
+
+		SourceResources[Index] = InTextures[Index]->GetResource();
+		IntermediateResources[Index] = Intermediate->GameThread_GetRenderTargetResource();
+
+		Capture->ImageSizes[Index] = FIntPoint{ static_cast<int32>(Intermediate->SizeX), static_cast<int32>(Intermediate->SizeY) };
+		Capture->FrameSizes[Index] = Capture->ImageSizes[Index];
+
+		if (Capture->bUseCornerPrefilter)
+		{
+			// The feed itself is read back later, and downsampled on the CPU if required, as its region is not known yet
+			Capture->BoundsReadbacks[Index] = MakeUnique<FRHIGPUBufferReadback>(TEXT("Calibrator.BoundsReadback"));
+			continue;
+		}
+
+		Capture->Readbacks[Index] = MakeUnique<FRHIGPUTextureReadback>(TEXT("Calibrator.Readback"));
+
+		if (bCoarseToFine)
+		{
+			// Downsample factor can be changed between runs, so the coarse intermediate may need to be resized
+			TStrongObjectPtr<UTextureRenderTarget2D>& CoarseIntermediate = TransientResources[Index].CoarseIntermediate;
+			const FIntPoint CoarseSize = FIntPoint::DivideAndRoundUp(Capture->ImageSizes[Index], Capture->DownsampleFactor);
+			if (!CoarseIntermediate || CoarseIntermediate->SizeX != CoarseSize.X || CoarseIntermediate->SizeY != CoarseSize.Y)
+			{
+				CoarseIntermediate.Reset(CreateRenderTargetFrom(InTextures[Index], false, Capture->DownsampleFactor));
+			}
+
+			CoarseIntermediateResources[Index] = CoarseIntermediate->GameThread_GetRenderTargetResource();
+
+			Capture->CoarseImageSizes[Index] = CoarseSize;
+			Capture->CoarseReadbacks[Index] = MakeUnique<FRHIGPUTextureReadback>(TEXT("Calibrator.CoarseReadback"));
+		}
+	}
 
-	// Copy source and destination data into respective render targets
+	// Copy source and destination data into respective render targets, and from there into readbacks
+	// Copying to an intermediate texture handles format conversion
 	ENQUEUE_RENDER_COMMAND(CopyTextureData)(
-		[SourceResource, IntermediateResource](FRHICommandListImmediate& RHICommandList)
+		[SourceResources, IntermediateResources, CoarseIntermediateResources, Capture](FRHICommandListImmediate& RHICommandList)
 		{
 			FRDGBuilder GraphBuilder(RHICommandList);
 			FGlobalShaderMap* ShaderMap = GetGlobalShaderMap(GMaxRHIFeatureLevel);
 
-			TRefCountPtr<IPooledRenderTarget> InputRT = CreateRenderTarget(SourceResource->GetTextureRHI(), TEXT("Calibrator.CopyToIntermediate.Input"));
-			TRefCountPtr<IPooledRenderTarget> OutputRT = CreateRenderTarget(IntermediateResource->GetTextureRHI(), TEXT("Calibrator.CopyToIntermediate.Output"));
+			for (int32 Index = 0; Index < Resources_Count; Index++)
+			{
+				if (!SourceResources[Index])
+					continue;
+
+				TRefCountPtr<IPooledRenderTarget> InputRT = CreateRenderTarget(SourceResources[Index]->GetTextureRHI(), TEXT("Calibrator.CopyToIntermediate.Input"));
+				TRefCountPtr<IPooledRenderTarget> OutputRT = CreateRenderTarget(IntermediateResources[Index]->GetTextureRHI(), TEXT("Calibrator.CopyToIntermediate.Output"));
+
+				// Set up RDG resources
+				FRDGTextureRef InputTexture = GraphBuilder.RegisterExternalTexture(InputRT);
+				FRDGTextureRef OutputTexture = GraphBuilder.RegisterExternalTexture(OutputRT);
+
+				AddDrawTexturePass(
+					GraphBuilder,
+					ShaderMap,
+					InputTexture,
+					OutputTexture,
+					{});
+
+				if (Capture->BoundsReadbacks[Index])
+				{
+					FRDGBufferRef BoundsBuffer = CompositionUtils::AddCornerPrefilterPasses(GraphBuilder, OutputTexture, Capture->CornerPrefilterSettings);
+					AddEnqueueCopyPass(GraphBuilder, Capture->BoundsReadbacks[Index].Get(), BoundsBuffer, CompositionUtils::CornerPrefilterBoundsSize);
 
-			// Set up RDG resources
-			FRDGTextureRef InputTexture = GraphBuilder.RegisterExternalTexture(InputRT);
-			FRDGTextureRef OutputTexture = GraphBuilder.RegisterExternalTexture(OutputRT);
+					// The intermediate persists, so can be read back from once the bounds are known
+					Capture->PrefilteredTextures[Index] = IntermediateResources[Index]->GetTextureRHI();
+					continue;
+				}
 
-			AddDrawTexturePass(
-				GraphBuilder,
-				ShaderMap,
-				InputTexture,
-				OutputTexture,
-				{});
+				AddEnqueueCopyPass(GraphBuilder, Capture->Readbacks[Index].Get(), OutputTexture);
+
+				if (CoarseIntermediateResources[Index])
+				{
+					TRefCountPtr<IPooledRenderTarget> CoarseOutputRT = CreateRenderTarget(CoarseIntermediateResources[Index]->GetTextureRHI(), TEXT("Calibrator.Downsample.Output"));
+					FRDGTextureRef CoarseOutputTexture = GraphBuilder.RegisterExternalTexture(CoarseOutputRT);
+
+					// Box filter of the full resolution intermediate, so that the coarse image matches the one DownsampleImage produces on the CPU
+					CompositionUtils::AddBoxDownsamplePass(GraphBuilder, OutputTexture, CoarseOutputTexture, Capture->DownsampleFactor);
+
+					AddEnqueueCopyPass(GraphBuilder, Capture->CoarseReadbacks[Index].Get(), CoarseOutputTexture);
+				}
+			}
 
 			GraphBuilder.Execute();
 		});
 }
 
-UTextureRenderTarget2D* FCalibrator::CreateRenderTargetFrom(TObjectPtr<UTexture> InTexture, bool bClearRenderTarget)
+void FCalibrator::PollReadbacks(const TSharedRef<FPendingCapture, ESPMode::ThreadSafe>& Capture)
+{
+	ENQUEUE_RENDER_COMMAND(PollCalibratorReadbacks)(
+		[Capture](FRHICommandListImmediate& RHICommandList)
+		{
+			ON_SCOPE_EXIT
+			{
+				Capture->bPollInFlight = false;
+			};
+
+			for (int32 Index = 0; Index < Resources_Count; Index++)
+			{
+				if (Capture->BoundsReadbacks[Index] && Capture->BoundsReadbacks[Index]->IsReady())
+				{
+					EnqueueCroppedReadback(RHICommandList, *Capture, Index);
+				}
+			}
+
+			for (int32 Index = 0; Index < Resources_Count; Index++)
+			{
+				if (Capture->BoundsReadbacks[Index])
+					return;
+				if (Capture->Readbacks[Index] && !Capture->Readbacks[Index]->IsReady())
+					return;
+				if (Capture->CoarseReadbacks[Index] && !Capture->CoarseReadbacks[Index]->IsReady())
+					return;
+			}
+
+			// Both feeds have arrived, copy them out so they can be consumed on the game thread
+			for (int32 Index = 0; Index < Resources_Count; Index++)
+			{
+				if (!Capture->Readbacks[Index])
+					continue;
+
+				CopyFromReadback(*Capture->Readbacks[Index], Capture->ImageSizes[Index], Capture->ImageData[Index]);
+
+				if (Capture->CoarseReadbacks[Index])
+				{
+					CopyFromReadback(*Capture->CoarseReadbacks[Index], Capture->CoarseImageSizes[Index], Capture->CoarseImageData[Index]);
+				}
+			}
+
+			Capture->bReadbackComplete = true;
+		});
+}
+
+void FCalibrator::EnqueueCroppedReadback(FRHICommandListImmediate& RHICommandList, FPendingCapture& Capture, int32 Index)
+{
+	check(IsInRenderingThread());
+
+	FIntRect Bounds;
+	const void* BoundsData = Capture.BoundsReadbacks[Index]->Lock(CompositionUtils::CornerPrefilterBoundsSize);
+	const bool bFoundCandidates = BoundsData && CompositionUtils::DecodeCornerPrefilterBounds(BoundsData, Bounds);
+	Capture.BoundsReadbacks[Index]->Unlock();
+	Capture.BoundsReadbacks[Index].Reset();
+
+	const FIntRect Frame{ FIntPoint::ZeroValue, Capture.FrameSizes[Index] };
+
+	// Without candidates the board may still be found with a more permissive search, so the whole frame is read back
+	FIntRect Region = Frame;
+	if (bFoundCandidates)
+	{
+		// Candidates only cover the inner corners, so pad by more than a square to include the outer squares and the border of the board
+		// The board may be rotated, so the larger of the square size estimates is used for both axes
+		const FIntPoint InnerSquares = (Capture.CheckerboardDimensions - FIntPoint(1, 1)).ComponentMax(FIntPoint(1, 1));
+		const int32 SquareSize = FMath::Max(
+			FMath::DivideAndRoundUp(Bounds.Width(), InnerSquares.X),
+			FMath::DivideAndRoundUp(Bounds.Height(), InnerSquares.Y));
+		const FIntPoint Margin{ 2 * SquareSize + 16 };
+
+		Region = FIntRect(Bounds.Min - Margin, Bounds.Max + Margin);
+		Region.Clip(Frame);
+	}
+
+	Capture.ImageOffsets[Index] = Region.Min;
+	Capture.ImageSizes[Index] = Region.Size();
+	Capture.Readbacks[Index] = MakeUnique<FRHIGPUTextureReadback>(TEXT("Calibrator.CroppedReadback"));
+
+	FRDGBuilder GraphBuilder(RHICommandList);
+
+	TRefCountPtr<IPooledRenderTarget> InputRT = CreateRenderTarget(Capture.PrefilteredTextures[Index], TEXT("Calibrator.CroppedReadback.Input"));
+	FRDGTextureRef InputTexture = GraphBuilder.RegisterExternalTexture(InputRT);
+
+	AddEnqueueCopyPass(GraphBuilder, Capture.Readbacks[Index].Get(), InputTexture, FResolveRect(Region.Min.X, Region.Min.Y, Region.Max.X, Region.Max.Y));
+
+	GraphBuilder.Execute();
+
+	Capture.PrefilteredTextures[Index].SafeRelease();
+}
+
+void FCalibrator::CopyFromReadback(FRHIGPUTextureReadback& Readback, FIntPoint Size, TArray<FColor>& OutImageData)
+{
+	check(IsInRenderingThread());
+
+	OutImageData.SetNumUninitialized(Size.X * Size.Y);
+
+	int32 RowPitchInPixels = 0;
+	const FColor* ReadbackData = static_cast<const FColor*>(Readback.Lock(RowPitchInPixels));
+	if (ReadbackData)
+	{
+		for (int32 Y = 0; Y < Size.Y; Y++)
+		{
+			FMemory::Memcpy(&OutImageData[Y * Size.X], ReadbackData + Y * RowPitchInPixels, Size.X * sizeof(FColor));
+		}
+	}
+	else
+	{
+		// Leaving no data will be reported as a read failure
+		OutImageData.Reset();
+	}
+	Readback.Unlock();
+}
+
+UTextureRenderTarget2D* FCalibrator::CreateRenderTargetFrom(TObjectPtr<UTexture> InTexture, bool bClearRenderTarget, int32 DownsampleFactor)
 {
 	if (!InTexture)
 		return nullptr;
@@ -315,6 +1059,10 @@ UTextureRenderTarget2D* FCalibrator::CreateRenderTargetFrom(TObjectPtr<UTexture>
 		// Fallback to default format for media textures
 		bLinearGamma = false;
 	}
+
+	const FIntPoint Size = FIntPoint::DivideAndRoundUp(
+		FIntPoint{ static_cast<int32>(InTexture->GetSurfaceWidth()), static_cast<int32>(InTexture->GetSurfaceHeight()) },
+		FMath::Max(DownsampleFactor, 1));
 	
 	UTextureRenderTarget2D* OutTexture = NewObject<UTextureRenderTarget2D>(GetTransientPackage());
 	check(OutTexture);
@@ -322,7 +1070,7 @@ UTextureRenderTarget2D* FCalibrator::CreateRenderTargetFrom(TObjectPtr<UTexture>
 	OutTexture->ClearColor = FLinearColor::Black;
 	OutTexture->bAutoGenerateMips = false;
 	OutTexture->bCanCreateUAV = false;
-	OutTexture->InitCustomFormat(InTexture->GetSurfaceWidth(), InTexture->GetSurfaceHeight(), PF_B8G8R8A8, bLinearGamma);
+	OutTexture->InitCustomFormat(Size.X, Size.Y, PF_B8G8R8A8, bLinearGamma);
 	OutTexture->UpdateResourceImmediate(bClearRenderTarget);
 
 	return OutTexture;
@@ -353,6 +1101,10 @@ FText FCalibrator::GetErrorTextForResult(ECalibrationResult Result)
 		return LOCTEXT("CalibrationResultDrawCheckerboardFailure", "Internal error: Failed to draw debug checkerboard.");
 	case ECalibrationResult::Error_SolvePoseFailure:
 		return LOCTEXT("CalibrationResultSolvePoseFailure", "Failed to solve for camera pose. Please retry.");
+	case ECalibrationResult::Rejected_ErrorTooHigh:
+		return LOCTEXT("CalibrationResultRejectedErrorTooHigh", "Sample rejected as reprojection error was too high.");
+	case ECalibrationResult::Rejected_PoseTooSimilar:
+		return LOCTEXT("CalibrationResultRejectedPoseTooSimilar", "Sample rejected as checkerboard pose was too similar to an existing sample.");
 	}
 
 	checkNoEntry();
@@ -1,21 +1,73 @@
 #pragma once
 
 #include "CoreMinimal.h"
+#include "Async/Future.h"
 #include "Engine/TextureRenderTarget2D.h"
+#include "TickableEditorObject.h"
 
+#include "CompUtilsCameraData.h"
+#include "CompUtilsCornerPrefilter.h"
+#include "CalibrationSession.h"
+#include "CalibrationSolver.h"
+
+class FRHIGPUBufferReadback;
+class FRHIGPUTextureReadback;
 class UReprojectionCalibration;
 class UReprojectionCalibrationTargetBase;
 
 /**
  * Contains utilities and owns transient resources required to perform calibration
+ * Calibration is asynchronous: texture data is read back from the GPU without stalling, and is consumed on a later tick once it arrives
  */
-class FCalibrator
+class FCalibrator : public FTickableEditorObject
 {
+public:
+	enum class ECalibrationResult
+	{
+		Success = 0,
+		Error_NoOpenCV,
+		Error_InvalidParams,
+		Error_MissingSourceOrDestination,
+		Error_MissingIntrinsics,
+		Error_ReadTextureFailure,
+		Error_IdentifyCheckerboardFailure,
+		Error_PointCountMismatch,
+		Error_DrawCheckerboardFailure,
+		Error_SolvePoseFailure,
+		Rejected_ErrorTooHigh,
+		Rejected_PoseTooSimilar
+	};
+
+	// Criteria for automatically capturing and accepting samples
+	struct FAutoCaptureSettings
+	{
+		// Captures per second
+		float CaptureRate = 4.0f;
+		// A sample is only accepted if the board pose differs from every accepted sample by at least one of these
+		float MinRotationDifference = 10.0f;		// Degrees
+		float MinTranslationDifference = 10.0f;		// cm
+		// A sample is only accepted if the reprojection error of both feeds is below this (in pixels)
+		float MaxReprojectionError = 1.0f;
+	};
+
+	// Options for detecting the checkerboard in each feed
+	struct FDetectionSettings
+	{
+		// Factor the feeds are downsampled by for coarse detection, or 1 to detect at full resolution only
+		int32 DownsampleFactor = 1;
+		// Only read back and search the region of each feed that contains X-corner candidates
+		bool bUseCornerPrefilter = false;
+		FCompUtilsCornerPrefilterSettings CornerPrefilterSettings;
+	};
+
+private:
 	// Transient resources required for calibration
 	struct FTransientResources
 	{
 		// Render targets used to easily read back texture data to CPU
 		TStrongObjectPtr<UTextureRenderTarget2D> Intermediate;
+		// Downsampled copy of the feed used for coarse checkerboard detection
+		TStrongObjectPtr<UTextureRenderTarget2D> CoarseIntermediate;
 		// Debug texture visualizes corners to give feedback to user
 		TStrongObjectPtr<UTexture2D> DebugView;
 		bool bValidDebugView = false;
@@ -23,6 +75,7 @@ class FCalibrator
 		void ReleaseAll()
 		{
 			Intermediate.Reset();
+			CoarseIntermediate.Reset();
 			DebugView.Reset();
 			bValidDebugView = false;
 		}
@@ -35,21 +88,63 @@ class FCalibrator
 		Resources_Count
 	};
 
-public:
-	enum class ECalibrationResult
+	// The result of processing a single feed, produced off the game thread
+	struct FFeedResult
 	{
-		Success = 0,
-		Error_NoOpenCV,
-		Error_InvalidParams,
-		Error_MissingSourceOrDestination,
-		Error_MissingIntrinsics,
-		Error_ReadTextureFailure,
-		Error_IdentifyCheckerboardFailure,
-		Error_PointCountMismatch,
-		Error_DrawCheckerboardFailure,
-		Error_SolvePoseFailure
+		ECalibrationResult Result = ECalibrationResult::Success;
+		TArray<FVector2f> Corners;
+		FTransform CameraPose;
+		double ReprojectionError = 0.0;
+	};
+
+	// A capture that has been requested but not yet processed
+	// Shared with the render thread, which fills out the image data once the readbacks have completed
+	struct FPendingCapture
+	{
+		TStaticArray<TUniquePtr<FRHIGPUTextureReadback>, Resources_Count> Readbacks;
+		TStaticArray<TArray<FColor>, Resources_Count> ImageData;
+		TStaticArray<FIntPoint, Resources_Count> ImageSizes;
+		TStaticArray<FCompUtilsCameraIntrinsicData, Resources_Count> Intrinsics;
+
+		// Only used for coarse-to-fine detection
+		TStaticArray<TUniquePtr<FRHIGPUTextureReadback>, Resources_Count> CoarseReadbacks;
+		TStaticArray<TArray<FColor>, Resources_Count> CoarseImageData;
+		TStaticArray<FIntPoint, Resources_Count> CoarseImageSizes;
+
+		// Only used with the corner prefilter
+		// The feed is read back once the bounds of its corner candidates have arrived, and only within those bounds
+		TStaticArray<TUniquePtr<FRHIGPUBufferReadback>, Resources_Count> BoundsReadbacks;
+		TStaticArray<FTextureRHIRef, Resources_Count> PrefilteredTextures;
+
+		// Image data may only cover part of the feed, in which case corners are offset back into the full frame
+		TStaticArray<FIntPoint, Resources_Count> ImageOffsets{ InPlace, FIntPoint::ZeroValue };
+		TStaticArray<FIntPoint, Resources_Count> FrameSizes;
+
+		FIntPoint CheckerboardDimensions;
+		float CheckerboardSize = 0.0f;
+		// Factor the feeds are downsampled by for coarse detection, or 1 to detect at full resolution only
+		int32 DownsampleFactor = 1;
+		bool bUseCornerPrefilter = false;
+		FCompUtilsCornerPrefilterSettings CornerPrefilterSettings;
+		// Auto captured samples must pass the auto capture acceptance criteria
+		bool bAutoCapture = false;
+
+		// Set while a render command is polling the readbacks
+		std::atomic<bool> bPollInFlight = false;
+		// Set by the render thread once ImageData has been filled
+		std::atomic<bool> bReadbackComplete = false;
+
+		// Checkerboard detection and pose estimation for each feed, run on background tasks
+		TArray<FVector> ObjectPoints;
+		TStaticArray<TFuture<FFeedResult>, Resources_Count> FeedResults;
+		bool bFeedTasksLaunched = false;
 	};
 
+public:
+	DECLARE_DELEGATE_OneParam(FOnCalibrationComplete, ECalibrationResult)
+	DECLARE_DELEGATE_OneParam(FOnSolveComplete, const FCalibrationSolverResult&)
+	DECLARE_DELEGATE_OneParam(FOnSamplesRejected, int32)
+
 public:
 	// Resets state to do with the calibration process, but doesn't free transient resources.
 	// Use this restart progressive calibration
@@ -58,14 +153,43 @@ public:
 	// Use this only when the texture sizes of the input feeds change.
 	void ResetTransientResources();
 
-	ECalibrationResult RunCalibration(
+	// Begins a single run of calibration.
+	// If the run could be started, OnCalibrationComplete will be executed once it has finished.
+	// Otherwise, the error is returned immediately.
+	ECalibrationResult BeginCalibration(
 		TObjectPtr<UReprojectionCalibrationTargetBase> Source,
 		TObjectPtr<UReprojectionCalibrationTargetBase> Destination,
 		FIntPoint CheckerboardDimensions,
 		float CheckerboardSize,
-		FTransform& OutSourceToDestination
+		const FDetectionSettings& DetectionSettings
 	);
 
+	// Continuously captures and processes samples, accepting only those that meet the auto capture criteria
+	// Results of each sample are reported through OnCalibrationComplete
+	void StartAutoCapture(
+		TObjectPtr<UReprojectionCalibrationTargetBase> Source,
+		TObjectPtr<UReprojectionCalibrationTargetBase> Destination,
+		FIntPoint CheckerboardDimensions,
+		float CheckerboardSize,
+		const FDetectionSettings& DetectionSettings,
+		const FAutoCaptureSettings& Settings
+	);
+	void StopAutoCapture();
+
+	static bool IsRejection(ECalibrationResult Result) { return Result == ECalibrationResult::Rejected_ErrorTooHigh || Result == ECalibrationResult::Rejected_PoseTooSimilar; }
+
+	inline bool IsCalibrating() const { return PendingCapture.IsValid(); }
+	inline bool IsAutoCapturing() const { return bAutoCapture; }
+	inline bool IsSolving() const { return SolveResult.IsValid(); }
+	// Describes the stage that the capture in flight has reached
+	FText GetStatusText() const;
+	// Executed once each sample has been processed
+	inline FOnCalibrationComplete& OnCalibrationComplete() { return OnCalibrationCompleteDelegate; }
+	// Executed each time the extrinsic has been re-solved with newly accepted samples
+	inline FOnSolveComplete& OnSolveComplete() { return OnSolveCompleteDelegate; }
+	// Executed with the number of accepted samples that the solver has discarded, which are removed from the calibration and session
+	inline FOnSamplesRejected& OnSamplesRejected() { return OnSamplesRejectedDelegate; }
+
 	TObjectPtr<UTexture> GetCalibratedSourceDebugView() const;
 	TObjectPtr<UTexture> GetCalibratedDestinationDebugView() const;
 
@@ -75,49 +199,162 @@ public:
 
 	inline double GetCurrentSourceError() const { return CurrentSourceError; }
 	inline double GetCurrentDestError() const { return CurrentDestinationError; }
-	inline double GetCurrentSampleWeight() const { return CurrentSampleWeight; }
 	inline const FTransform& GetCurrentCalibratedTransform() const { return CurrentCalibratedTransform; }
+	// All samples accepted since calibration was last restarted
+	inline const FCalibrationSession& GetSession() const { return Session; }
 
 	static FText GetErrorTextForResult(ECalibrationResult Result);
 
+	//~ Begin FTickableEditorObject interface
+	virtual void Tick(float DeltaTime) override;
+	virtual bool IsTickable() const override { return IsCalibrating() || IsAutoCapturing() || IsSolving(); }
+	virtual TStatId GetStatId() const override;
+	//~ End FTickableEditorObject interface
+
 private:
-	ECalibrationResult RunCalibrationImpl(
+	ECalibrationResult BeginCalibrationImpl(
 		TObjectPtr<UReprojectionCalibrationTargetBase> Source,
 		TObjectPtr<UReprojectionCalibrationTargetBase> Destination,
 		FIntPoint CheckerboardDimensions,
 		float CheckerboardSize,
-		FTransform& OutSourceToDestination
+		const FDetectionSettings& DetectionSettings
 	);
 
+	// Launches detection of both feeds on background tasks once image data has arrived
+	static void LaunchFeedTasks(const TSharedRef<FPendingCapture, ESPMode::ThreadSafe>& Capture);
+	// Merges the results of both feeds into the progressive calibration on the game thread
+	ECalibrationResult FinishCalibration(FPendingCapture& Capture);
+	void CompleteCalibration(ECalibrationResult Result);
+	// Checks if a board pose differs sufficiently from those of all accepted samples
+	bool IsNovelPose(const FTransform& BoardPose) const;
+
+	// Re-solves the extrinsic on a background task if there are new samples and no solve is already in flight
+	void KickSolve();
+	void FinishSolve();
+	void RemoveRejectedSamples(const TArray<int32>& RejectedSamples);
+
 	static TObjectPtr<UTexture> GetDebugView(const FTransientResources& Resources);
 
-	static ECalibrationResult FindCheckerboardCorners(
-		FIntPoint CheckerboardDimensions,
-		TObjectPtr<UTexture> InTexture,
-		FTransientResources& Resources,
+	// Finds checkerboard corners and solves for the pose of the camera that captured the image
+	// Safe to call from any thread
+	static FFeedResult DetectAndSolve(
+		const FPendingCapture& Capture,
+		int32 Index
+	);
+
+	// Solves for the pose of the camera that sees ObjectPoints at ImagePoints, like FOpenCVHelper::SolvePnP
+	// Wraps the distortion parameters of the intrinsics in place, rather than copying them into the TArray<float> SolvePnP takes
+	static bool SolveCameraPose(
+		const TArray<FVector>& ObjectPoints,
+		const TArray<FVector2f>& ImagePoints,
+		const FCompUtilsCameraIntrinsicData& Intrinsics,
+		FTransform& OutCameraPose
+	);
+
+	// Box filters an image down to 1/DownsampleFactor of its size, for feeds that were not downsampled on the GPU
+	static void DownsampleImage(
+		const TArray<FColor>& ImageData,
+		FIntPoint ImageSize,
+		int32 DownsampleFactor,
+		TArray<FColor>& OutImageData,
+		FIntPoint& OutImageSize
+	);
+
+	// Detects the checkerboard in the coarse image, then refines the corners in small windows of the full resolution image
+	// Falls back to detecting in the full resolution image if the board cannot be found in the coarse image
+	static bool FindCheckerboardCorners(
+		const FPendingCapture& Capture,
+		int32 Index,
 		TArray<FVector2f>& OutCorners
 	);
-	static void CopyToIntermediate(TObjectPtr<UTexture> InTexture, TStrongObjectPtr<UTextureRenderTarget2D>& IntermediateTexture);
+	static bool RefineCorners(
+		const TArray<FColor>& ImageData,
+		FIntPoint ImageSize,
+		int32 SearchRadius,
+		TArray<FVector2f>& InOutCorners
+	);
+
+	static ECalibrationResult UpdateDebugView(
+		FIntPoint CheckerboardDimensions,
+		const TArray<FColor>& ImageData,
+		FIntPoint ImageSize,
+		FIntPoint ImageOffset,
+		FIntPoint FrameSize,
+		const TArray<FVector2f>& Corners,
+		FTransientResources& Resources
+	);
+
+	// Copies feeds into their intermediates and enqueues readbacks, such that they are read back in the same frame
+	// Feeds with a null texture are skipped
+	void EnqueueReadbacks(
+		const TStaticArray<TObjectPtr<UTexture>, Resources_Count>& InTextures,
+		const TSharedRef<FPendingCapture, ESPMode::ThreadSafe>& Capture
+	);
+	// Checks on the render thread if the readbacks have completed
+	static void PollReadbacks(const TSharedRef<FPendingCapture, ESPMode::ThreadSafe>& Capture);
+	// Reads back the region of a prefiltered feed that contains its corner candidates, padded to cover the whole board
+	// Must be called on the render thread once the bounds readback is ready
+	static void EnqueueCroppedReadback(FRHICommandListImmediate& RHICommandList, FPendingCapture& Capture, int32 Index);
 
 	// Helper to create an intermediate render target to hold data form InTexture
-	static UTextureRenderTarget2D* CreateRenderTargetFrom(TObjectPtr<UTexture> InTexture, bool bClearRenderTarget);
+	static UTextureRenderTarget2D* CreateRenderTargetFrom(TObjectPtr<UTexture> InTexture, bool bClearRenderTarget, int32 DownsampleFactor = 1);
+	static void CopyFromReadback(FRHIGPUTextureReadback& Readback, FIntPoint Size, TArray<FColor>& OutImageData);
 
 private:
 	// Transient resources are stored as members to avoid re-allocation every run
 	TStaticArray<FTransientResources, Resources_Count> TransientResources;
 
+	TSharedPtr<FPendingCapture, ESPMode::ThreadSafe> PendingCapture;
+	FOnCalibrationComplete OnCalibrationCompleteDelegate;
+
+	// Auto capture state
+	bool bAutoCapture = false;
+	TWeakObjectPtr<UReprojectionCalibrationTargetBase> AutoCaptureSource;
+	TWeakObjectPtr<UReprojectionCalibrationTargetBase> AutoCaptureDestination;
+	FIntPoint AutoCaptureCheckerboardDimensions;
+	float AutoCaptureCheckerboardSize = 0.0f;
+	FDetectionSettings AutoCaptureDetectionSettings;
+	FAutoCaptureSettings AutoCaptureSettings;
+	double LastAutoCaptureTime = 0.0;
+
 	// State for progressive calibration - where the calibration is refined over multiple runs
 	int32 NumSamples = 0;
-	double WeightSum = 0;
 	double SourceErrorSum = 0;
 	double DestinationErrorSum = 0;
 
-	FQuat AccumulatedRotation = FQuat::Identity;
-	FVector AccumulatedTranslation = FVector::ZeroVector;
+	// Only accessed by the background task while a solve is in flight
+	// Replaced rather than reset on restart, so that a solve in flight can still complete safely
+	TSharedPtr<FCalibrationSolver, ESPMode::ThreadSafe> Solver;
+	TSharedPtr<FCalibrationSolver, ESPMode::ThreadSafe> SolvingSolver;
+	TFuture<FCalibrationSolverResult> SolveResult;
+	FCalibrationSolverSettings SolverSettings;
+	FOnSolveComplete OnSolveCompleteDelegate;
+	FOnSamplesRejected OnSamplesRejectedDelegate;
+
+	// Accepted samples waiting to be added to the solver
+	TArray<FCalibrationSolver::FSample> QueuedSamples;
+	FCompUtilsCameraIntrinsicData SolverSourceCamera;
+	FCompUtilsCameraIntrinsicData SolverDestinationCamera;
+
+	// Copy of every accepted sample, so that the session can be saved and re-solved offline
+	FCalibrationSession Session;
+
+	struct FAcceptedSample
+	{
+		// Index of the sample in the order it was added to the solver, see FCalibrationSolverResult::RejectedSamples
+		int32 SolverIndex = INDEX_NONE;
+		// Pose of the board relative to the source camera
+		FTransform BoardPose;
+		double SourceError = 0;
+		double DestinationError = 0;
+	};
+
+	// Accepted samples, in the same order as the samples of the session
+	TArray<FAcceptedSample> AcceptedSamples;
+	int32 NumSolverSamples = 0;
 
 	// The properties of the most recent calibration run
 	double CurrentSourceError = 0;
 	double CurrentDestinationError = 0;
-	double CurrentSampleWeight = 0;
 	FTransform CurrentCalibratedTransform = FTransform::Identity;
 };
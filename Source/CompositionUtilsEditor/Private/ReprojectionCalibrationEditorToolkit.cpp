@@ -1,6 +1,7 @@
 #include "ReprojectionCalibrationEditorToolkit.h"
 
 #include "CompositionUtilsEditor.h"
+#include "Misc/Paths.h"
 #include "Widgets/SReprojectionCalibrationControls.h"
 #include "Widgets/SReprojectionCalibrationViewer.h"
 #include "Widgets/Layout/SScaleBox.h"
@@ -17,6 +18,9 @@ void FReprojectionCalibrationEditorToolkit::InitEditor(const TArray<UObject*>& I
 {
 	Asset = Cast<UReprojectionCalibration>(InObjects[0]);
 	CalibratorImpl = MakeUnique<FCalibrator>();
+	CalibratorImpl->OnCalibrationComplete().BindSP(this, &FReprojectionCalibrationEditorToolkit::OnCalibrationComplete);
+	CalibratorImpl->OnSolveComplete().BindSP(this, &FReprojectionCalibrationEditorToolkit::OnSolveComplete);
+	CalibratorImpl->OnSamplesRejected().BindSP(this, &FReprojectionCalibrationEditorToolkit::OnSamplesRejected);
 
 	ReprojectionCalibrationViewers[Viewer_Feed] = SNew(SReprojectionCalibrationViewer)
 		.SourceTexture(this, &FReprojectionCalibrationEditorToolkit::GetFeedSource)
@@ -35,6 +39,16 @@ void FReprojectionCalibrationEditorToolkit::InitEditor(const TArray<UObject*>& I
 		.GetAvgSourceErrorText_Lambda(
 			[this](){ return FText::AsNumber(this->CalibratorImpl->GetAvgDestError()); }
 		)
+		.GetStatusText_Lambda(
+			[this](){ return this->CalibratorImpl->GetStatusText(); }
+		)
+		.IsCapturing_Lambda(
+			[this](){ return this->CalibratorImpl->IsCalibrating(); }
+		)
+		.IsAutoCapturing_Lambda(
+			[this](){ return this->CalibratorImpl->IsAutoCapturing(); }
+		)
+		.OnAutoCaptureClicked(this, &FReprojectionCalibrationEditorToolkit::ToggleAutoCapture)
 		.OnCaptureClicked(this, &FReprojectionCalibrationEditorToolkit::RunCalibration)
 		.OnRestartClicked(this, &FReprojectionCalibrationEditorToolkit::RestartCalibration)
 		.OnResetClicked(this, &FReprojectionCalibrationEditorToolkit::ResetCalibration);
@@ -194,35 +208,114 @@ void FReprojectionCalibrationEditorToolkit::RunCalibration()
 	if (!Asset)
 		return;
 
-	FTransform OutTransform;
-	FCalibrator::ECalibrationResult Result = CalibratorImpl->RunCalibration(
+	// Ignore requests while a previous capture is still being processed
+	if (CalibratorImpl->IsCalibrating())
+		return;
+
+	FCalibrator::ECalibrationResult Result = CalibratorImpl->BeginCalibration(
 		Asset->Source,
 		Asset->Destination,
 		Asset->CheckerboardDimensions,
 		Asset->CheckerboardSize,
-		OutTransform);
+		GetDetectionSettings());
 
-	if (Result == FCalibrator::ECalibrationResult::Success)
+	if (Result != FCalibrator::ECalibrationResult::Success)
 	{
-		ReprojectionCalibrationViewers[Viewer_CalibrationImage]->InvalidateBrushes();
+		ReprojectionCalibrationControls->AddErrorToLog(FCalibrator::GetErrorTextForResult(Result));
+	}
+}
+
+void FReprojectionCalibrationEditorToolkit::OnCalibrationComplete(FCalibrator::ECalibrationResult Result)
+{
+	if (!Asset)
+		return;
 
-		Asset->ExtrinsicTransform = OutTransform;
-		(void)Asset->MarkPackageDirty();
+	// Debug views may have changed regardless of the outcome
+	ReprojectionCalibrationViewers[Viewer_CalibrationImage]->InvalidateBrushes();
 
+	if (Result == FCalibrator::ECalibrationResult::Success)
+	{
+		// The calibrated transform is updated once the sample has been included in a solve
 		ReprojectionCalibrationControls->AddSuccessToLog(
 			CalibratorImpl->GetNumSamples(),
 			CalibratorImpl->GetCurrentSourceError(),
-			CalibratorImpl->GetCurrentDestError(),
-			CalibratorImpl->GetCurrentCalibratedTransform(),
-			CalibratorImpl->GetCurrentSampleWeight()
+			CalibratorImpl->GetCurrentDestError()
 		);
 	}
+	else if (CalibratorImpl->IsAutoCapturing())
+	{
+		// Most auto captured samples are expected to fail or be rejected, which would flood the log
+		UE_LOG(LogCompositionUtilsEditor, Verbose, TEXT("Auto capture sample discarded: %s"), *FCalibrator::GetErrorTextForResult(Result).ToString());
+	}
 	else
 	{
 		ReprojectionCalibrationControls->AddErrorToLog(FCalibrator::GetErrorTextForResult(Result));
 	}
 }
 
+void FReprojectionCalibrationEditorToolkit::OnSolveComplete(const FCalibrationSolverResult& Result)
+{
+	if (!Asset)
+		return;
+
+	Asset->SetExtrinsicTransform(Result.SourceToDestination);
+	(void)Asset->MarkPackageDirty();
+
+	ReprojectionCalibrationControls->AddSolveToLog(
+		Result.NumSamples,
+		Result.SourceRMSError,
+		Result.DestinationRMSError,
+		Result.SourceToDestination,
+		Result.SolveTimeMs
+	);
+
+	SaveSession();
+}
+
+void FReprojectionCalibrationEditorToolkit::OnSamplesRejected(int32 NumRejected)
+{
+	ReprojectionCalibrationControls->AddErrorToLog(FText::Format(
+		LOCTEXT("CalibrationSamplesRejected", "The solver could not initialize {0} {0}|plural(one=sample,other=samples) and discarded {0}|plural(one=it,other=them)."),
+		NumRejected));
+}
+
+void FReprojectionCalibrationEditorToolkit::ToggleAutoCapture()
+{
+	if (!Asset)
+		return;
+
+	if (CalibratorImpl->IsAutoCapturing())
+	{
+		CalibratorImpl->StopAutoCapture();
+		return;
+	}
+
+	FCalibrator::FAutoCaptureSettings Settings;
+	Settings.CaptureRate = Asset->AutoCaptureRate;
+	Settings.MinRotationDifference = Asset->AutoCaptureMinRotationDifference;
+	Settings.MinTranslationDifference = Asset->AutoCaptureMinTranslationDifference;
+	Settings.MaxReprojectionError = Asset->AutoCaptureMaxReprojectionError;
+
+	CalibratorImpl->StartAutoCapture(
+		Asset->Source,
+		Asset->Destination,
+		Asset->CheckerboardDimensions,
+		Asset->CheckerboardSize,
+		GetDetectionSettings(),
+		Settings);
+}
+
+FCalibrator::FDetectionSettings FReprojectionCalibrationEditorToolkit::GetDetectionSettings() const
+{
+	check(Asset);
+
+	FCalibrator::FDetectionSettings Settings;
+	Settings.DownsampleFactor = Asset->bUseCoarseToFineDetection ? Asset->CoarseDetectionDownsampleFactor : 1;
+	Settings.bUseCornerPrefilter = Asset->bUseCornerPrefilter;
+	Settings.CornerPrefilterSettings.ResponseThreshold = Asset->CornerPrefilterThreshold;
+	return Settings;
+}
+
 void FReprojectionCalibrationEditorToolkit::RestartCalibration()
 {
 	if (!Asset)
@@ -241,10 +334,28 @@ void FReprojectionCalibrationEditorToolkit::ResetCalibration()
 
 	RestartCalibration();
 
-	Asset->ExtrinsicTransform = FTransform::Identity;
+	Asset->SetExtrinsicTransform(FTransform::Identity);
 	(void)Asset->MarkPackageDirty();
 }
 
+void FReprojectionCalibrationEditorToolkit::SaveSession() const
+{
+	const FCalibrationSession& Session = CalibratorImpl->GetSession();
+	if (!Asset || Session.Samples.IsEmpty())
+		return;
+
+	// Overwritten as samples are added, so the file always holds the whole session
+	const FString Filename = FCalibrationSession::GetSessionDirectory() / Asset->GetName() + TEXT(".cucs");
+	if (Session.SaveToFile(Filename))
+	{
+		UE_LOG(LogCompositionUtilsEditor, Verbose, TEXT("Saved calibration session with %d samples to '%s'"), Session.Samples.Num(), *Filename);
+	}
+	else
+	{
+		UE_LOG(LogCompositionUtilsEditor, Warning, TEXT("Failed to save calibration session to '%s'"), *Filename);
+	}
+}
+
 void FReprojectionCalibrationEditorToolkit::OnPropertiesFinishedChangingCallback(const FPropertyChangedEvent& Event) const
 {
 	FName PropertyName = Event.GetPropertyName();
@@ -33,9 +33,15 @@ private:
 	TObjectPtr<UTexture> GetCalibrationImageSource() const;
 	TObjectPtr<UTexture> GetCalibrationImageDestination() const;
 
-	void RunCalibration();		// Performs a single run of calibration, and accumulates with previous runs if any.
+	void RunCalibration();		// Begins a single run of calibration, which accumulates with previous runs if any once complete.
+	void OnCalibrationComplete(FCalibrator::ECalibrationResult Result);
+	void OnSolveComplete(const FCalibrationSolverResult& Result);
+	void OnSamplesRejected(int32 NumRejected);
+	void ToggleAutoCapture();	// Starts or stops continuously capturing samples
+	FCalibrator::FDetectionSettings GetDetectionSettings() const;
 	void RestartCalibration();	// Restarts progressive calibration but does not clear data
 	void ResetCalibration();	// Restarts calibration AND ALSO clears all calibrated data
+	void SaveSession() const;	// Writes all accepted samples to disk so that they can be re-solved offline
 
 	void OnPropertiesFinishedChangingCallback(const FPropertyChangedEvent& Event) const;
 
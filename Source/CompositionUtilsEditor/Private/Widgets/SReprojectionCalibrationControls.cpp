@@ -6,12 +6,16 @@
 void SReprojectionCalibrationControls::Construct(const FArguments& InArgs)
 {
 	OnCaptureClicked = InArgs._OnCaptureClicked;
+	OnAutoCaptureClicked = InArgs._OnAutoCaptureClicked;
 	OnRestartClicked = InArgs._OnRestartClicked;
 	OnResetClicked = InArgs._OnResetClicked;
 
 	NumSamplesText = InArgs._GetNumRunsText;
 	AvgSourceErrorText = InArgs._GetAvgSourceErrorText;
 	AvgDestErrorText = InArgs._GetAvgDestErrorText;
+	StatusText = InArgs._GetStatusText;
+	IsCapturing = InArgs._IsCapturing;
+	IsAutoCapturing = InArgs._IsAutoCapturing;
 
 	ChildSlot
 	[
@@ -38,6 +42,11 @@ void SReprojectionCalibrationControls::Construct(const FArguments& InArgs)
 					.Text(LOCTEXT("CaptureImage", "Capture Image"))
 					.HAlign(HAlign_Center)
 					.ContentPadding(10.0f)
+					.IsEnabled_Lambda([this]()
+					{
+						// Only one capture can be processed at a time
+						return !this->IsCapturing.Get(false) && !this->IsAutoCapturing.Get(false);
+					})
 					.OnClicked_Lambda([this]()
 					{
 						this->OnCaptureClicked.ExecuteIfBound();
@@ -50,6 +59,28 @@ void SReprojectionCalibrationControls::Construct(const FArguments& InArgs)
 				.VAlign(VAlign_Center)
 				.FillHeight(1.0f)
 				.Padding(10.0f)
+				[
+					SNew(SButton)
+					.Text_Lambda([this]()
+					{
+						return this->IsAutoCapturing.Get(false)
+							? LOCTEXT("StopAutoCapture", "Stop Auto Capture")
+							: LOCTEXT("StartAutoCapture", "Start Auto Capture");
+					})
+					.HAlign(HAlign_Center)
+					.ContentPadding(10.0f)
+					.OnClicked_Lambda([this]()
+					{
+						this->OnAutoCaptureClicked.ExecuteIfBound();
+						return FReply::Handled();
+					})
+					.ButtonStyle(FAppStyle::Get(), "EditorUtilityButton")
+				]
+				+ SVerticalBox::Slot()
+				.HAlign(HAlign_Fill)
+				.VAlign(VAlign_Center)
+				.FillHeight(1.0f)
+				.Padding(10.0f)
 				[
 					SNew(SButton)
 					.Text(LOCTEXT("RestartCalibration", "Restart Calibration"))
@@ -136,6 +167,22 @@ void SReprojectionCalibrationControls::Construct(const FArguments& InArgs)
 				SNew(STextBlock)
 					.Text(AvgDestErrorText)
 			]
+			+ SGridPanel::Slot(0, 3)
+			.HAlign(HAlign_Left)
+			.VAlign(VAlign_Fill)
+			.Padding(10.0f)
+			[
+				SNew(STextBlock)
+					.Text(LOCTEXT("StatusLabel", "Status:"))
+			]
+			+ SGridPanel::Slot(1, 3)
+			.HAlign(HAlign_Right)
+			.VAlign(VAlign_Fill)
+			.Padding(10.0f)
+			[
+				SNew(STextBlock)
+					.Text(StatusText)
+			]
 		]
 		+ SHorizontalBox::Slot()
 		.HAlign(HAlign_Fill)
@@ -148,11 +195,8 @@ void SReprojectionCalibrationControls::Construct(const FArguments& InArgs)
 	];
 }
 
-void SReprojectionCalibrationControls::AddSuccessToLog(int32 SampleIndex, double SourceError, double DestError, const FTransform& CalibratedTransform, double Weight) const
+void SReprojectionCalibrationControls::AddSuccessToLog(int32 SampleIndex, double SourceError, double DestError) const
 {
-	FVector Translation = CalibratedTransform.GetTranslation();
-	FVector Rotation = CalibratedTransform.GetRotation().Euler();
-
 	FNumberFormattingOptions Options;
 	Options
 		.SetMaximumFractionalDigits(2);
@@ -163,17 +207,40 @@ void SReprojectionCalibrationControls::AddSuccessToLog(int32 SampleIndex, double
 			"Calibration sample {0} succeeded:\n"
 			"	Error (Source): {1}\n"
 			"	Error (Destination): {2}\n"
-			"	Translation: ({3}, {4}, {5})\n"
-			"	Rotation: ({6}, {7}, {8})\n"
-			"	Weight: {9}\n"
 			),
 			FText::AsNumber(SampleIndex, &Options),
 			FText::AsNumber(SourceError, &Options),
-			FText::AsNumber(DestError, &Options),
+			FText::AsNumber(DestError, &Options)
+			))
+	);
+}
+
+void SReprojectionCalibrationControls::AddSolveToLog(int32 NumSamples, double SourceRMSError, double DestRMSError, const FTransform& CalibratedTransform, double SolveTimeMs) const
+{
+	FVector Translation = CalibratedTransform.GetTranslation();
+	FVector Rotation = CalibratedTransform.GetRotation().Euler();
+
+	FNumberFormattingOptions Options;
+	Options
+		.SetMaximumFractionalDigits(2);
+
+	AddToLog(
+		SNew(STextBlock)
+		.Text(FText::Format(LOCTEXT("SolveFormat",
+			"Solved over {0} samples in {1}ms:\n"
+			"	RMS Error (Source): {2}\n"
+			"	RMS Error (Destination): {3}\n"
+			"	Translation: ({4}, {5}, {6})\n"
+			"	Rotation: ({7}, {8}, {9})\n"
+			),
+			FText::AsNumber(NumSamples, &Options),
+			FText::AsNumber(SolveTimeMs, &Options),
+			FText::AsNumber(SourceRMSError, &Options),
+			FText::AsNumber(DestRMSError, &Options),
 			FText::AsNumber(Translation.X, &Options), FText::AsNumber(Translation.Y, &Options), FText::AsNumber(Translation.Z, &Options),
-			FText::AsNumber(Rotation.X, &Options), FText::AsNumber(Rotation.Y, &Options), FText::AsNumber(Rotation.Z, &Options),
-			FText::AsNumber(Weight, &Options)
+			FText::AsNumber(Rotation.X, &Options), FText::AsNumber(Rotation.Y, &Options), FText::AsNumber(Rotation.Z, &Options)
 			))
+		.ColorAndOpacity(FColor::Green)
 	);
 }
 
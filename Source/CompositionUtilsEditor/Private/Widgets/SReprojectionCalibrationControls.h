@@ -16,15 +16,20 @@ public:
 		SLATE_ATTRIBUTE(FText, GetNumRunsText)
 		SLATE_ATTRIBUTE(FText, GetAvgSourceErrorText)
 		SLATE_ATTRIBUTE(FText, GetAvgDestErrorText)
+		SLATE_ATTRIBUTE(FText, GetStatusText)
+		SLATE_ATTRIBUTE(bool, IsCapturing)
+		SLATE_ATTRIBUTE(bool, IsAutoCapturing)
 
 		SLATE_EVENT(FReprojectionCalibrationButtonClicked, OnCaptureClicked)
+		SLATE_EVENT(FReprojectionCalibrationButtonClicked, OnAutoCaptureClicked)
 		SLATE_EVENT(FReprojectionCalibrationButtonClicked, OnRestartClicked)
 		SLATE_EVENT(FReprojectionCalibrationButtonClicked, OnResetClicked)
 	SLATE_END_ARGS()
 
 	void Construct(const FArguments& InArgs);
 
-	void AddSuccessToLog(int32 SampleIndex, double SourceError, double DestError, const FTransform& CalibratedTransform, double Weight) const;
+	void AddSuccessToLog(int32 SampleIndex, double SourceError, double DestError) const;
+	void AddSolveToLog(int32 NumSamples, double SourceRMSError, double DestRMSError, const FTransform& CalibratedTransform, double SolveTimeMs) const;
 	void AddErrorToLog(const FText& ErrorText) const;
 	void AddToLog(const TSharedPtr<SWidget>& Widget) const;
 	void ClearLog() const;
@@ -33,8 +38,12 @@ private:
 	TAttribute<FText> NumSamplesText;
 	TAttribute<FText> AvgSourceErrorText;
 	TAttribute<FText> AvgDestErrorText;
+	TAttribute<FText> StatusText;
+	TAttribute<bool> IsCapturing;
+	TAttribute<bool> IsAutoCapturing;
 
 	FReprojectionCalibrationButtonClicked OnCaptureClicked;
+	FReprojectionCalibrationButtonClicked OnAutoCaptureClicked;
 	FReprojectionCalibrationButtonClicked OnRestartClicked;
 	FReprojectionCalibrationButtonClicked OnResetClicked;
 